@@ -167,10 +167,12 @@ public:
     ovrHmd_BeginFrame(hmd, frameIndex);
     glEnable(GL_DEPTH_TEST);
 
+    LodSelector::instance().beginFrame();
     for (int i = 0; i < 2; ++i) {
       ovrEyeType eye = hmd->EyeRenderOrder[i];
 
       const ovrRecti & vp = textures[eye].Header.RenderViewport;
+      LodSelector::instance().beginEye(vp.Size.h);
       eyeFramebuffers[eye]->Bind();
       oglplus::Context::Viewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
       Stacks::projection().top() = eyeProjections[eye];
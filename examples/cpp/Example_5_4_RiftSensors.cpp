@@ -75,9 +75,11 @@ public:
 
     ovrHmd_BeginFrame(hmd, getFrame());
     MatrixStack & mv = Stacks::modelview();
+    LodSelector::instance().beginFrame();
     for (int i = 0; i < ovrEye_Count; ++i) {
       ovrEyeType eye = hmd->EyeRenderOrder[i];
       PerEyeArg & eyeArgs = eyes[eye];
+      LodSelector::instance().beginEye(eyeTextures[eye].Header.RenderViewport.Size.h);
       Stacks::projection().top() = eyeArgs.projection;
 
       eyeArgs.framebuffer->Bind();
@@ -0,0 +1,51 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+#ifdef HAVE_OPENCV
+#include <opencv2/opencv.hpp>
+#include "CaptureFrames.h"
+
+const size_t CaptureFrames::RING_SIZE = 3;
+
+static bool isShared(const cv::Mat & mat) {
+#if CV_MAJOR_VERSION >= 3
+  return mat.u && mat.u->refcount > 1;
+#else
+  return mat.refcount && *mat.refcount > 1;
+#endif
+}
+
+CaptureFrames::CaptureFrames() : ring(RING_SIZE) {
+}
+
+const cv::Mat & CaptureFrames::convert(const cv::Mat & raw) {
+  cv::Mat & image = ring[next];
+  next = (next + 1) % RING_SIZE;
+  if (isShared(image)) {
+    image = cv::Mat();
+  }
+  // A no-op once the slot has the right size
+  image.create(raw.rows, raw.cols, CV_8UC4);
+  // Flipped for GL and expanded to RGBA in a single pass
+  ImageKernels::bgrToRgba(raw.data, raw.step, image.data, image.step,
+    raw.cols, raw.rows, true);
+  return image;
+}
+#endif
@@ -0,0 +1,45 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Converts captured BGR frames into the flipped RGBA images the renderer
+ * uploads, writing into a small ring of images that is only allocated
+ * again when the capture size changes.
+ *
+ * The renderer keeps the last image handed to it while it uploads, and
+ * the handoff keeps the last one set, so a slot is only reused once
+ * nothing but the ring refers to it.  A slot still in use is replaced by
+ * a fresh image, which only happens when the renderer falls behind.
+ *
+ * Needs OpenCV, so include it after <opencv2/opencv.hpp>.
+ */
+class CaptureFrames {
+public:
+  static const size_t RING_SIZE;
+
+  CaptureFrames();
+
+  // The converted frame, valid until the next RING_SIZE calls
+  const cv::Mat & convert(const cv::Mat & raw);
+
+private:
+  std::vector<cv::Mat> ring;
+  size_t next{ 0 };
+};
@@ -29,6 +29,10 @@
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <list>
 #include <map>
@@ -40,6 +44,7 @@
 #include <stack>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 
 #include <GL/glew.h>
@@ -105,8 +110,17 @@ public:
   }
 };
 
+#include "ResourceView.h"
 #include "Platform.h"
+#include "ResourceArchive.h"
+#include "DecodedCache.h"
+#include "Logging.h"
+#include "Profiler.h"
+#include "ThreadPlacement.h"
+#include "ImageKernels.h"
 #include "Utils.h"
+#include "FrameTimeline.h"
+#include "FrameStatistics.h"
 
 #include "rendering/Lights.h"
 #include "rendering/MatrixStack.h"
@@ -117,9 +131,21 @@ public:
 
 #include "opengl/Constants.h"
 #include "opengl/Textures.h"
+#include "opengl/TextureResidency.h"
+#include "opengl/Ktx.h"
+#include "opengl/ShaderPreprocessor.h"
 #include "opengl/Shaders.h"
+#include "opengl/FrameUniforms.h"
 #include "opengl/Framebuffer.h"
+#include "opengl/Mesh.h"
+#include "opengl/MeshOptimizer.h"
+#include "opengl/MeshSimplifier.h"
+#include "opengl/LodSelector.h"
 #include "opengl/GlUtils.h"
+#include "opengl/TextureAtlas.h"
+#include "opengl/GpuTimer.h"
+#include "opengl/TextureStreamer.h"
+#include "opengl/AssetLoader.h"
 
 #include "glfw/GlfwUtils.h"
 #include "glfw/GlfwApp.h"
@@ -0,0 +1,292 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+const uint32_t DecodedCache::VERSION;
+const char DecodedCache::MAGIC[8] = { 'O', 'R', 'I', 'A', 'D', 'E', 'C', 0 };
+const uint64_t DecodedCache::DEFAULT_MAX_BYTES = 512ULL * 1024 * 1024;
+
+namespace {
+  struct CacheFile {
+    std::string path;
+    uint64_t size;
+    int64_t modified;
+  };
+
+  // The entries in the cache directory, leaving out files being written
+  std::vector<CacheFile> listEntries(const std::string & directory) {
+    std::vector<CacheFile> result;
+#ifdef OS_WIN
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((directory + "\\*.bin").c_str(), &data);
+    if (INVALID_HANDLE_VALUE == find) {
+      return result;
+    }
+    do {
+      CacheFile file;
+      file.path = directory + "/" + data.cFileName;
+      file.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+      file.modified = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+      result.push_back(file);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR * dir = opendir(directory.c_str());
+    if (!dir) {
+      return result;
+    }
+    while (struct dirent * entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (!Platform::hasExtension(name, ".bin")) {
+        continue;
+      }
+      CacheFile file;
+      file.path = directory + "/" + name;
+      struct stat info;
+      if (0 != stat(file.path.c_str(), &info)) {
+        continue;
+      }
+      file.size = (uint64_t)info.st_size;
+      // Entries written within the same second still need ordering
+#if defined(OS_OSX)
+      file.modified = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+      file.modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+      result.push_back(file);
+    }
+    closedir(dir);
+#endif
+    return result;
+  }
+}
+
+static unsigned processId() {
+#ifdef OS_WIN
+  return (unsigned)GetCurrentProcessId();
+#else
+  return (unsigned)getpid();
+#endif
+}
+
+static std::string defaultDirectory() {
+#if defined(OS_WIN)
+  const char * base = getenv("LOCALAPPDATA");
+  return base ? std::string(base) + "\\oria\\cache" : std::string();
+#elif defined(OS_OSX)
+  const char * home = getenv("HOME");
+  return home ? std::string(home) + "/Library/Caches/oria" : std::string();
+#else
+  const char * xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg) {
+    return std::string(xdg) + "/oria";
+  }
+  const char * home = getenv("HOME");
+  return home ? std::string(home) + "/.cache/oria" : std::string();
+#endif
+}
+
+DecodedCache & DecodedCache::instance() {
+  static DecodedCache INSTANCE;
+  static std::once_flag once;
+  std::call_once(once, [] {
+    const char * env = getenv("ORIA_DECODED_CACHE");
+    if (env && 0 == strcmp(env, "0")) {
+      INSTANCE.enabled = false;
+    } else {
+      INSTANCE.directory = (env && *env) ? env : defaultDirectory();
+      INSTANCE.enabled = !INSTANCE.directory.empty();
+    }
+    const char * megabytes = getenv("ORIA_DECODED_CACHE_MB");
+    if (megabytes && *megabytes) {
+      INSTANCE.maxBytes = (uint64_t)atoll(megabytes) * 1024 * 1024;
+    }
+  });
+  return INSTANCE;
+}
+
+uint64_t DecodedCache::key(const ResourceView & source, const std::string & options) {
+  uint64_t result = ResourceArchive::hash(source.data(), source.size());
+  result ^= ResourceArchive::hash(options.data(), options.size()) * 1099511628211ULL;
+  return result;
+}
+
+void DecodedCache::setDirectory(const std::string & newDirectory) {
+  std::lock_guard<std::mutex> guard(mutex);
+  directory = newDirectory;
+  directoryCreated = false;
+  usageKnown = false;
+}
+
+std::string DecodedCache::pathFor(uint64_t key) const {
+  return directory + "/" + Platform::format("%016" PRIx64 ".bin", key);
+}
+
+bool DecodedCache::createDirectory() {
+  if (directoryCreated) {
+    return true;
+  }
+  // Create each missing component in turn
+  for (size_t i = 1; i <= directory.size(); ++i) {
+    if (i != directory.size() && directory[i] != '/' && directory[i] != '\\') {
+      continue;
+    }
+    std::string component = directory.substr(0, i);
+#ifdef OS_WIN
+    if (!CreateDirectoryA(component.c_str(), NULL) && ERROR_ALREADY_EXISTS != GetLastError()) {
+      return false;
+    }
+#else
+    if (0 != mkdir(component.c_str(), 0755) && EEXIST != errno) {
+      return false;
+    }
+#endif
+  }
+  directoryCreated = true;
+  return true;
+}
+
+ResourceView DecodedCache::find(uint64_t key) {
+  if (!enabled) {
+    return ResourceView();
+  }
+  std::string path;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    path = pathFor(key);
+  }
+  ResourceView file = ResourceView::mapFile(path);
+  const FileHeader * header = reinterpret_cast<const FileHeader *>(file.data());
+  if (file.size() < sizeof(FileHeader) || memcmp(header->magic, MAGIC, sizeof(MAGIC)) ||
+      VERSION != header->version || key != header->key ||
+      header->size != file.size() - sizeof(FileHeader)) {
+    ++misses;
+    return ResourceView();
+  }
+  ++hits;
+  // The modification time doubles as the last use, for eviction
+#ifdef OS_WIN
+  _utime(path.c_str(), nullptr);
+#else
+  utime(path.c_str(), nullptr);
+#endif
+  return file.subView(sizeof(FileHeader));
+}
+
+void DecodedCache::store(uint64_t key, std::initializer_list<ResourceView> parts) {
+  if (!enabled) {
+    return;
+  }
+  PROFILE_ZONE("DecodedCache::store");
+  std::lock_guard<std::mutex> guard(mutex);
+  if (!createDirectory()) {
+    SAY_ERR("Unable to create the decoded cache directory %s, disabling it", directory.c_str());
+    enabled = false;
+    return;
+  }
+
+  FileHeader header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.reserved = 0;
+  header.key = key;
+  header.size = 0;
+  for (const ResourceView & part : parts) {
+    header.size += part.size();
+  }
+
+  std::string path = pathFor(key);
+  // Unique per process and thread, in case two processes fill the same
+  // entry.  Thread ids alone repeat across processes.
+  std::string temporary = path + Platform::format(".%x.%" PRIx64 ".tmp", processId(),
+    (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const ResourceView & part : parts) {
+      out.write(part.chars(), part.size());
+    }
+    if (!out) {
+      SAY_ERR("Failed to write decoded cache entry %s", temporary.c_str());
+      out.close();
+      remove(temporary.c_str());
+      return;
+    }
+  }
+#ifdef OS_WIN
+  // Windows won't rename over an existing file
+  remove(path.c_str());
+#endif
+  if (0 != rename(temporary.c_str(), path.c_str())) {
+    remove(temporary.c_str());
+    return;
+  }
+
+  if (!usageKnown) {
+    usedBytes = 0;
+    for (const CacheFile & file : listEntries(directory)) {
+      usedBytes += file.size;
+    }
+    usageKnown = true;
+  } else {
+    // Replacing an entry over-counts, which only brings eviction forward
+    usedBytes += sizeof(FileHeader) + header.size;
+  }
+  if (usedBytes > maxBytes) {
+    evict();
+  }
+}
+
+// Must be called with the mutex held
+void DecodedCache::evict() {
+  PROFILE_ZONE("DecodedCache::evict");
+  std::vector<CacheFile> files = listEntries(directory);
+  std::sort(files.begin(), files.end(), [](const CacheFile & a, const CacheFile & b) {
+    return a.modified < b.modified;
+  });
+  usedBytes = 0;
+  for (const CacheFile & file : files) {
+    usedBytes += file.size;
+  }
+  // Evicting down to below the budget leaves room for a while, so the
+  // directory isn't listed again on every store
+  uint64_t target = maxBytes / 4 * 3;
+  size_t evicted = 0;
+  for (const CacheFile & file : files) {
+    if (usedBytes <= target) {
+      break;
+    }
+    // Files still mapped elsewhere can't be removed on Windows, and stay
+    if (0 == remove(file.path.c_str())) {
+      usedBytes -= file.size;
+      ++evicted;
+    }
+  }
+  SAY("Evicted %d decoded cache entries, %d MB remain", (int)evicted, (int)(usedBytes >> 20));
+}
@@ -0,0 +1,112 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * An on-disk cache of decoded resources, so that PNG images and CTM meshes
+ * are only decompressed, and shader programs only compiled, the first time
+ * a machine sees them.
+ *
+ * Blobs are keyed by a hash of the source bytes and a string describing the
+ * decoding options, so an edited resource or a different option simply
+ * misses.  Each blob is its own file in the cache directory, written to a
+ * temporary name and renamed into place so a crash can't leave a torn
+ * entry behind.  Hits are memory mapped.
+ *
+ * The directory defaults to the per-user cache location of the platform.
+ * The ORIA_DECODED_CACHE environment variable overrides it, and setting it
+ * to 0 disables the cache.  Every failure is logged and treated as a miss:
+ * the cache only ever saves time.
+ *
+ * Every source or option change adds entries, so the cache is held to a
+ * byte budget, ORIA_DECODED_CACHE_MB megabytes if set.  Hits refresh the
+ * modification time of their file, and once a store takes the cache over
+ * budget the least recently used files are deleted until it is back to
+ * three quarters of it.
+ */
+class DecodedCache {
+public:
+  static const uint32_t VERSION = 1;
+  static const char MAGIC[8];
+  static const uint64_t DEFAULT_MAX_BYTES;
+
+  static DecodedCache & instance();
+  static uint64_t key(const ResourceView & source, const std::string & options);
+
+  bool isEnabled() const {
+    return enabled;
+  }
+
+  void setEnabled(bool enable) {
+    enabled = enable;
+  }
+
+  const std::string & getDirectory() const {
+    return directory;
+  }
+
+  void setDirectory(const std::string & directory);
+
+  uint64_t getMaxBytes() const {
+    return maxBytes;
+  }
+
+  void setMaxBytes(uint64_t bytes) {
+    maxBytes = bytes;
+  }
+
+  // The blob stored for a key, or an empty view on a miss
+  ResourceView find(uint64_t key);
+  // Stores the concatenation of the parts as the blob for a key
+  void store(uint64_t key, std::initializer_list<ResourceView> parts);
+
+  size_t getHits() const {
+    return hits;
+  }
+
+  size_t getMisses() const {
+    return misses;
+  }
+
+private:
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t size;
+  };
+
+  DecodedCache() {}
+  std::string pathFor(uint64_t key) const;
+  bool createDirectory();
+  void evict();
+
+  std::atomic<bool> enabled{ true };
+  std::string directory;
+  std::atomic<size_t> hits{ 0 };
+  std::atomic<size_t> misses{ 0 };
+  std::atomic<uint64_t> maxBytes{ DEFAULT_MAX_BYTES };
+  std::mutex mutex;
+  bool directoryCreated{ false };
+  // Bytes in the directory, counted on the first store and then kept up
+  // to date, so that not every store has to list the directory
+  uint64_t usedBytes{ 0 };
+  bool usageKnown{ false };
+};
@@ -0,0 +1,163 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+const size_t FrameStatistics::HISTORY_SIZE;
+const size_t FrameStatistics::BUCKET_COUNT;
+const float FrameStatistics::DROPPED_FRAME_FACTOR = 1.5f;
+
+FrameStatistics::FrameStatistics() {
+  memset(histogram, 0, sizeof(histogram));
+  memset(history, 0, sizeof(history));
+}
+
+size_t FrameStatistics::bucketIndex(uint64_t micros) {
+  if (micros < 4) {
+    return (size_t)micros;
+  }
+  size_t octave = 0;
+  for (uint64_t v = micros; v > 1; v >>= 1) {
+    ++octave;
+  }
+  size_t sub = (size_t)((micros >> (octave - 2)) & 3);
+  return std::min(BUCKET_COUNT - 1, 4 + (octave - 2) * 4 + sub);
+}
+
+uint64_t FrameStatistics::bucketLowerBound(size_t bucket) {
+  if (bucket < 4) {
+    return bucket;
+  }
+  size_t octave = (bucket - 4) / 4 + 2;
+  uint64_t sub = (bucket - 4) % 4;
+  return (4 + sub) << (octave - 2);
+}
+
+uint64_t FrameStatistics::bucketUpperBound(size_t bucket) {
+  return bucketLowerBound(bucket + 1);
+}
+
+void FrameStatistics::reset() {
+  memset(histogram, 0, sizeof(histogram));
+  windowStart = last;
+  count = 0;
+  total = 0;
+  max = 0;
+}
+
+void FrameStatistics::increment() {
+  increment(Platform::elapsedNanos());
+}
+
+void FrameStatistics::increment(int64_t nanos) {
+  if (!started) {
+    started = true;
+    windowStart = last = nanos;
+    return;
+  }
+
+  int64_t interval = nanos - last;
+  last = nanos;
+  history[historyHead] = interval;
+  historyHead = (historyHead + 1) % HISTORY_SIZE;
+  historyCount = std::min(historyCount + 1, HISTORY_SIZE);
+
+  ++histogram[bucketIndex((uint64_t)(interval / 1000))];
+  ++count;
+  total += interval;
+  max = std::max(max, interval);
+}
+
+float FrameStatistics::elapsed() const {
+  return (float)((double)(last - windowStart) / 1e9);
+}
+
+float FrameStatistics::getRate() const {
+  float seconds = elapsed();
+  if (0.0f == seconds) {
+    return NAN;
+  }
+  return (float)count / seconds;
+}
+
+float FrameStatistics::getMean() const {
+  if (!count) {
+    return 0.0f;
+  }
+  return (float)((double)total / (double)count / 1e9);
+}
+
+float FrameStatistics::getMax() const {
+  return (float)((double)max / 1e9);
+}
+
+uint64_t FrameStatistics::percentileMicros(float percentile) const {
+  if (!count) {
+    return 0;
+  }
+  size_t target = (size_t)std::ceil(std::min(1.0f, std::max(0.0f, percentile)) * count);
+  target = std::max<size_t>(target, 1);
+  size_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += histogram[i];
+    if (seen >= target) {
+      // Report the middle of the bucket, but never more than the worst sample
+      uint64_t middle = (bucketLowerBound(i) + bucketUpperBound(i)) / 2;
+      return std::min(middle, (uint64_t)(max / 1000));
+    }
+  }
+  return (uint64_t)(max / 1000);
+}
+
+float FrameStatistics::getPercentile(float percentile) const {
+  return (float)percentileMicros(percentile) / 1e6f;
+}
+
+size_t FrameStatistics::getDroppedFrames() const {
+  uint64_t threshold = (uint64_t)(percentileMicros(0.5f) * DROPPED_FRAME_FACTOR);
+  if (!threshold) {
+    return 0;
+  }
+  size_t result = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    if (bucketLowerBound(i) >= threshold) {
+      result += histogram[i];
+    }
+  }
+  return result;
+}
+
+size_t FrameStatistics::getHistory(float * out, size_t maxCount) const {
+  size_t result = std::min(maxCount, historyCount);
+  size_t start = (historyHead + HISTORY_SIZE - result) % HISTORY_SIZE;
+  for (size_t i = 0; i < result; ++i) {
+    out[i] = (float)((double)history[(start + i) % HISTORY_SIZE] / 1e9);
+  }
+  return result;
+}
+
+std::string FrameStatistics::describe() const {
+  return Platform::format("%0.2f/s p50 %0.2fms p90 %0.2fms p99 %0.2fms max %0.2fms dropped %d",
+    getRate(),
+    getPercentile(0.5f) * 1000.0f,
+    getPercentile(0.9f) * 1000.0f,
+    getPercentile(0.99f) * 1000.0f,
+    getMax() * 1000.0f,
+    (int)getDroppedFrames());
+}
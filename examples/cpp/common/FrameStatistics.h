@@ -0,0 +1,85 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Fixed memory frame (or capture) interval statistics.  Intervals between
+ * successive calls to increment() are kept in a small ring buffer and in a
+ * log bucketed histogram, which allows reporting percentiles, the worst
+ * interval and a count of dropped frames without allocating.
+ *
+ * Not thread safe, callers sharing an instance across threads must lock.
+ */
+class FrameStatistics {
+public:
+  static const size_t HISTORY_SIZE = 256;
+  // 4 exact buckets for intervals under 4us, then 4 buckets per octave
+  static const size_t BUCKET_COUNT = 128;
+  // An interval this much longer than the median counts as a dropped frame
+  static const float DROPPED_FRAME_FACTOR;
+
+  FrameStatistics();
+
+  // Start a new reporting window.  The time of the last event is kept so
+  // the interval spanning the reset is still recorded.
+  void reset();
+  // Record an event at the current time
+  void increment();
+  // Record an event at the given time from Platform::elapsedNanos()
+  void increment(int64_t nanos);
+
+  // Seconds spanned by the current window
+  float elapsed() const;
+  // Events per second in the current window
+  float getRate() const;
+  // Number of intervals recorded in the current window
+  size_t getCount() const {
+    return count;
+  }
+
+  // Interval statistics for the current window, in seconds
+  float getMean() const;
+  float getMax() const;
+  float getPercentile(float percentile) const;
+  size_t getDroppedFrames() const;
+
+  // The most recent intervals in seconds, oldest first, regardless of resets
+  size_t getHistory(float * out, size_t maxCount) const;
+
+  std::string describe() const;
+
+private:
+  static size_t bucketIndex(uint64_t micros);
+  static uint64_t bucketLowerBound(size_t bucket);
+  static uint64_t bucketUpperBound(size_t bucket);
+  uint64_t percentileMicros(float percentile) const;
+
+  uint32_t histogram[BUCKET_COUNT];
+  int64_t history[HISTORY_SIZE];
+  size_t historyCount{ 0 };
+  size_t historyHead{ 0 };
+
+  bool started{ false };
+  int64_t windowStart{ 0 };
+  int64_t last{ 0 };
+  size_t count{ 0 };
+  int64_t total{ 0 };
+  int64_t max{ 0 };
+};
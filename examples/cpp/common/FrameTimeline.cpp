@@ -0,0 +1,100 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+int64_t FrameTimeline::Frame::phaseDuration(const char * name) const {
+  int64_t result = 0;
+  for (size_t i = 0; i < phaseCount; ++i) {
+    if (0 == strcmp(phases[i].name, name)) {
+      result += phases[i].duration();
+    }
+  }
+  return result;
+}
+
+void FrameTimeline::beginFrame(unsigned int index) {
+  if (frameOpen) {
+    endFrame();
+  }
+  current.index = index;
+  current.start = Platform::elapsedNanos();
+  current.end = current.start;
+  current.phaseCount = 0;
+  depth = 0;
+  frameOpen = true;
+}
+
+void FrameTimeline::endFrame() {
+  if (!frameOpen) {
+    return;
+  }
+  current.end = Platform::elapsedNanos();
+  // Close out any phases left open, so the report stays consistent
+  for (size_t i = 0; i < current.phaseCount; ++i) {
+    if (0 == current.phases[i].end) {
+      current.phases[i].end = current.end;
+    }
+  }
+  last = current;
+  frameOpen = false;
+}
+
+size_t FrameTimeline::beginPhase(const char * name) {
+  if (!frameOpen || current.phaseCount >= MAX_PHASES) {
+    return INVALID_PHASE;
+  }
+  size_t result = current.phaseCount++;
+  Phase & phase = current.phases[result];
+  phase.name = name;
+  phase.depth = depth++;
+  phase.start = Platform::elapsedNanos();
+  phase.end = 0;
+  return result;
+}
+
+void FrameTimeline::endPhase(size_t phase) {
+  if (!frameOpen || phase >= current.phaseCount) {
+    return;
+  }
+  current.phases[phase].end = Platform::elapsedNanos();
+  --depth;
+}
+
+std::string FrameTimeline::describe() const {
+  std::stringstream result;
+  result.precision(3);
+  result << std::fixed;
+  result << "Frame " << last.index << " " << ((double)last.duration() / 1e6) << "ms";
+  int lastDepth = 0;
+  for (size_t i = 0; i < last.phaseCount; ++i) {
+    const Phase & phase = last.phases[i];
+    for (; lastDepth < phase.depth; ++lastDepth) {
+      result << " [";
+    }
+    for (; lastDepth > phase.depth; --lastDepth) {
+      result << " ]";
+    }
+    result << " " << phase.name << " " << ((double)phase.duration() / 1e6);
+  }
+  for (; lastDepth > 0; --lastDepth) {
+    result << " ]";
+  }
+  return result.str();
+}
@@ -0,0 +1,99 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Records named, nested phases of a single frame against the monotonic
+ * nanosecond clock.  The most recently completed frame is kept so that it
+ * can be inspected or reported while the next one is being recorded.
+ *
+ * Phase names are stored as pointers, so they must be string literals or
+ * otherwise outlive the timeline.  A timeline must only be stamped from a
+ * single thread.
+ */
+class FrameTimeline {
+public:
+  static const size_t MAX_PHASES = 32;
+  static const size_t INVALID_PHASE = (size_t)-1;
+
+  struct Phase {
+    const char * name{ nullptr };
+    int depth{ 0 };
+    int64_t start{ 0 };
+    int64_t end{ 0 };
+
+    int64_t duration() const {
+      return end - start;
+    }
+  };
+
+  struct Frame {
+    unsigned int index{ 0 };
+    int64_t start{ 0 };
+    int64_t end{ 0 };
+    size_t phaseCount{ 0 };
+    Phase phases[MAX_PHASES];
+
+    int64_t duration() const {
+      return end - start;
+    }
+
+    // Total time spent in all phases with the given name, in nanoseconds
+    int64_t phaseDuration(const char * name) const;
+  };
+
+  // Phases also show up as zones in the trace while the Profiler is recording
+  class Scope {
+    FrameTimeline & timeline;
+    size_t phase;
+    Profiler::Zone zone;
+
+  public:
+    Scope(FrameTimeline & timeline, const char * name)
+      : timeline(timeline), phase(timeline.beginPhase(name)), zone(name) {
+    }
+
+    ~Scope() {
+      timeline.endPhase(phase);
+    }
+  };
+
+  void beginFrame(unsigned int index);
+  void endFrame();
+  size_t beginPhase(const char * name);
+  void endPhase(size_t phase);
+
+  bool inFrame() const {
+    return frameOpen;
+  }
+
+  const Frame & getLastFrame() const {
+    return last;
+  }
+
+  // A single line breakdown of the last completed frame, in milliseconds
+  std::string describe() const;
+
+private:
+  Frame current;
+  Frame last;
+  bool frameOpen{ false };
+  int depth{ 0 };
+};
@@ -0,0 +1,394 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit instructions the target allows, so the wider
+// kernels are compiled for their level and only called once it's detected
+#if defined(KERNELS_X86) && defined(__GNUC__)
+#define KERNEL_TARGET(name) __attribute__((target(name)))
+#else
+#define KERNEL_TARGET(name)
+#endif
+
+namespace {
+  // One row at a time, the strides and flipping are handled by the callers
+  typedef void(*SwapRows)(uint8_t * a, uint8_t * b, size_t bytes);
+  typedef void(*Expand)(const uint8_t * src, uint8_t * dst, size_t width, bool swapRedBlue);
+  typedef void(*Swizzle)(const uint8_t * src, uint8_t * dst, size_t width);
+
+  struct Kernels {
+    SwapRows swapRows;
+    Expand expand;
+    Swizzle swizzle;
+  };
+
+  void swapRowsScalar(uint8_t * a, uint8_t * b, size_t bytes) {
+    std::swap_ranges(a, a + bytes, b);
+  }
+
+  void expandScalar(const uint8_t * src, uint8_t * dst, size_t width, bool swapRedBlue) {
+    int r = swapRedBlue ? 2 : 0, b = 2 - r;
+    for (size_t x = 0; x < width; ++x, src += 3, dst += 4) {
+      dst[0] = src[r];
+      dst[1] = src[1];
+      dst[2] = src[b];
+      dst[3] = 255;
+    }
+  }
+
+  void swizzleScalar(const uint8_t * src, uint8_t * dst, size_t width) {
+    for (size_t x = 0; x < width; ++x, src += 4, dst += 4) {
+      dst[0] = src[2];
+      dst[1] = src[1];
+      dst[2] = src[0];
+      dst[3] = src[3];
+    }
+  }
+
+#ifdef KERNELS_X86
+  KERNEL_TARGET("sse2")
+  void swapRowsSse2(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+      _mm_storeu_si128((__m128i *)(a + i), vb);
+      _mm_storeu_si128((__m128i *)(b + i), va);
+    }
+    swapRowsScalar(a + i, b + i, bytes - i);
+  }
+
+  // Red and blue trade places in every 32 bit pixel
+  KERNEL_TARGET("sse2")
+  void swizzleSse2(const uint8_t * src, uint8_t * dst, size_t width) {
+    const __m128i GREEN_ALPHA = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i LOW = _mm_set1_epi32(0x000000FF);
+    size_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4));
+      __m128i ga = _mm_and_si128(v, GREEN_ALPHA);
+      __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), LOW);
+      __m128i b = _mm_slli_epi32(_mm_and_si128(v, LOW), 16);
+      _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_or_si128(ga, _mm_or_si128(r, b)));
+    }
+    swizzleScalar(src + x * 4, dst + x * 4, width - x);
+  }
+
+  // Spreads the first four three byte pixels of each 16 bytes into four
+  // byte pixels, with a zero alpha for the caller to fill in
+  static const int8_t EXPAND_RGB[16] = { 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 };
+  static const int8_t EXPAND_BGR[16] = { 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 };
+  static const int8_t SWIZZLE_BGRA[16] = { 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+
+  KERNEL_TARGET("ssse3")
+  void expandSsse3(const uint8_t * src, uint8_t * dst, size_t width, bool swapRedBlue) {
+    const __m128i mask = _mm_loadu_si128((const __m128i *)(swapRedBlue ? EXPAND_BGR : EXPAND_RGB));
+    const __m128i ALPHA = _mm_set1_epi32((int)0xFF000000);
+    size_t x = 0;
+    // 16 pixels from three loads, realigned so each holds four pixels
+    for (; x + 16 <= width; x += 16) {
+      const uint8_t * in = src + x * 3;
+      uint8_t * out = dst + x * 4;
+      __m128i a = _mm_loadu_si128((const __m128i *)in);
+      __m128i b = _mm_loadu_si128((const __m128i *)(in + 16));
+      __m128i c = _mm_loadu_si128((const __m128i *)(in + 32));
+      __m128i p0 = a;
+      __m128i p1 = _mm_alignr_epi8(b, a, 12);
+      __m128i p2 = _mm_alignr_epi8(c, b, 8);
+      __m128i p3 = _mm_srli_si128(c, 4);
+      _mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_shuffle_epi8(p0, mask), ALPHA));
+      _mm_storeu_si128((__m128i *)(out + 16), _mm_or_si128(_mm_shuffle_epi8(p1, mask), ALPHA));
+      _mm_storeu_si128((__m128i *)(out + 32), _mm_or_si128(_mm_shuffle_epi8(p2, mask), ALPHA));
+      _mm_storeu_si128((__m128i *)(out + 48), _mm_or_si128(_mm_shuffle_epi8(p3, mask), ALPHA));
+    }
+    expandScalar(src + x * 3, dst + x * 4, width - x, swapRedBlue);
+  }
+
+  KERNEL_TARGET("ssse3")
+  void swizzleSsse3(const uint8_t * src, uint8_t * dst, size_t width) {
+    const __m128i mask = _mm_loadu_si128((const __m128i *)SWIZZLE_BGRA);
+    size_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4));
+      _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_shuffle_epi8(v, mask));
+    }
+    swizzleScalar(src + x * 4, dst + x * 4, width - x);
+  }
+
+  KERNEL_TARGET("avx2")
+  void swapRowsAvx2(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+      _mm256_storeu_si256((__m256i *)(a + i), vb);
+      _mm256_storeu_si256((__m256i *)(b + i), va);
+    }
+    swapRowsSse2(a + i, b + i, bytes - i);
+  }
+
+  KERNEL_TARGET("avx2")
+  void expandAvx2(const uint8_t * src, uint8_t * dst, size_t width, bool swapRedBlue) {
+    const __m256i mask = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)(swapRedBlue ? EXPAND_BGR : EXPAND_RGB)));
+    const __m256i ALPHA = _mm256_set1_epi32((int)0xFF000000);
+    size_t x = 0;
+    // Eight pixels per shuffle, four in each 128 bit lane.  Each load pair
+    // reads 4 bytes past its 24, so the last one stays clear of the end.
+    for (; x + 8 * 4 + 2 <= width; x += 8 * 4) {
+      for (int i = 0; i < 4; ++i) {
+        const uint8_t * in = src + (x + i * 8) * 3;
+        __m256i v = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+          _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+        v = _mm256_or_si256(_mm256_shuffle_epi8(v, mask), ALPHA);
+        _mm256_storeu_si256((__m256i *)(dst + (x + i * 8) * 4), v);
+      }
+    }
+    expandSsse3(src + x * 3, dst + x * 4, width - x, swapRedBlue);
+  }
+
+  KERNEL_TARGET("avx2")
+  void swizzleAvx2(const uint8_t * src, uint8_t * dst, size_t width) {
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)SWIZZLE_BGRA));
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+      _mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_shuffle_epi8(v, mask));
+    }
+    swizzleSsse3(src + x * 4, dst + x * 4, width - x);
+  }
+
+  bool x86Supports(ImageKernels::Level level) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = 0 != (info[3] & (1 << 26));
+    bool ssse3 = 0 != (info[2] & (1 << 9));
+    bool ymmEnabled = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (6 == (_xgetbv(0) & 6));
+    __cpuidex(info, 7, 0);
+    bool avx2 = ymmEnabled && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    bool sse2 = 0 != __builtin_cpu_supports("sse2");
+    bool ssse3 = 0 != __builtin_cpu_supports("ssse3");
+    bool avx2 = 0 != __builtin_cpu_supports("avx2");
+#endif
+    switch (level) {
+    case ImageKernels::SSE2:
+      return sse2;
+    case ImageKernels::SSSE3:
+      return sse2 && ssse3;
+    case ImageKernels::AVX2:
+      return sse2 && ssse3 && avx2;
+    default:
+      return false;
+    }
+  }
+#endif
+
+#ifdef KERNELS_NEON
+  void swapRowsNeon(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+      uint8x16_t va = vld1q_u8(a + i);
+      uint8x16_t vb = vld1q_u8(b + i);
+      vst1q_u8(a + i, vb);
+      vst1q_u8(b + i, va);
+    }
+    swapRowsScalar(a + i, b + i, bytes - i);
+  }
+
+  void expandNeon(const uint8_t * src, uint8_t * dst, size_t width, bool swapRedBlue) {
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+      uint8x16x3_t in = vld3q_u8(src + x * 3);
+      uint8x16x4_t out;
+      out.val[0] = in.val[swapRedBlue ? 2 : 0];
+      out.val[1] = in.val[1];
+      out.val[2] = in.val[swapRedBlue ? 0 : 2];
+      out.val[3] = vdupq_n_u8(255);
+      vst4q_u8(dst + x * 4, out);
+    }
+    expandScalar(src + x * 3, dst + x * 4, width - x, swapRedBlue);
+  }
+
+  void swizzleNeon(const uint8_t * src, uint8_t * dst, size_t width) {
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+      uint8x16x4_t v = vld4q_u8(src + x * 4);
+      uint8x16_t red = v.val[2];
+      v.val[2] = v.val[0];
+      v.val[0] = red;
+      vst4q_u8(dst + x * 4, v);
+    }
+    swizzleScalar(src + x * 4, dst + x * 4, width - x);
+  }
+#endif
+
+  Kernels kernelsFor(ImageKernels::Level level) {
+    switch (level) {
+#ifdef KERNELS_X86
+    case ImageKernels::SSE2:
+      return { swapRowsSse2, expandScalar, swizzleSse2 };
+    case ImageKernels::SSSE3:
+      return { swapRowsSse2, expandSsse3, swizzleSsse3 };
+    case ImageKernels::AVX2:
+      return { swapRowsAvx2, expandAvx2, swizzleAvx2 };
+#endif
+#ifdef KERNELS_NEON
+    case ImageKernels::NEON:
+      return { swapRowsNeon, expandNeon, swizzleNeon };
+#endif
+    default:
+      return { swapRowsScalar, expandScalar, swizzleScalar };
+    }
+  }
+
+  ImageKernels::Level bestLevel() {
+    for (int level = ImageKernels::LEVEL_COUNT - 1; level > ImageKernels::SCALAR; --level) {
+      if (ImageKernels::isSupported((ImageKernels::Level)level)) {
+        return (ImageKernels::Level)level;
+      }
+    }
+    return ImageKernels::SCALAR;
+  }
+
+  struct Selected {
+    ImageKernels::Level level;
+    Kernels kernels;
+
+    Selected() : level(bestLevel()), kernels(kernelsFor(level)) {
+    }
+  };
+
+  Selected & selected() {
+    static Selected INSTANCE;
+    return INSTANCE;
+  }
+
+  template <typename F>
+  void forEachRow(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+      size_t height, bool flip, F rowKernel) {
+    for (size_t y = 0; y < height; ++y) {
+      size_t dstRow = flip ? height - 1 - y : y;
+      rowKernel(src + y * srcStride, dst + dstRow * dstStride);
+    }
+  }
+}
+
+const char * ImageKernels::levelName(Level level) {
+  static const char * NAMES[LEVEL_COUNT] = { "scalar", "sse2", "ssse3", "avx2", "neon" };
+  return level < LEVEL_COUNT ? NAMES[level] : "unknown";
+}
+
+bool ImageKernels::isSupported(Level level) {
+  switch (level) {
+  case SCALAR:
+    return true;
+#ifdef KERNELS_X86
+  case SSE2:
+  case SSSE3:
+  case AVX2:
+    return x86Supports(level);
+#endif
+#ifdef KERNELS_NEON
+  case NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+ImageKernels::Level ImageKernels::getLevel() {
+  return selected().level;
+}
+
+void ImageKernels::setLevel(Level level) {
+  if (isSupported(level)) {
+    selected().level = level;
+    selected().kernels = kernelsFor(level);
+  }
+}
+
+void ImageKernels::flipRows(uint8_t * pixels, size_t stride, size_t rowBytes, size_t rows) {
+  SwapRows swapRows = selected().kernels.swapRows;
+  for (size_t top = 0, bottom = rows - 1; rows && top < bottom; ++top, --bottom) {
+    swapRows(pixels + top * stride, pixels + bottom * stride, rowBytes);
+  }
+}
+
+void ImageKernels::bgrToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip) {
+  Expand expand = selected().kernels.expand;
+  forEachRow(src, srcStride, dst, dstStride, height, flip, [&](const uint8_t * in, uint8_t * out) {
+    expand(in, out, width, true);
+  });
+}
+
+void ImageKernels::rgbToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip) {
+  Expand expand = selected().kernels.expand;
+  forEachRow(src, srcStride, dst, dstStride, height, flip, [&](const uint8_t * in, uint8_t * out) {
+    expand(in, out, width, false);
+  });
+}
+
+void ImageKernels::bgraToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip) {
+  Swizzle swizzle = selected().kernels.swizzle;
+  forEachRow(src, srcStride, dst, dstStride, height, flip, [&](const uint8_t * in, uint8_t * out) {
+    swizzle(in, out, width);
+  });
+}
+
+// The C library's copies and fills are already vectorized, what matters is
+// doing them once per row rather than per pixel
+void ImageKernels::blit(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t rowBytes, size_t rows) {
+  if (srcStride == rowBytes && dstStride == rowBytes) {
+    memcpy(dst, src, rowBytes * rows);
+    return;
+  }
+  for (size_t y = 0; y < rows; ++y) {
+    memcpy(dst + y * dstStride, src + y * srcStride, rowBytes);
+  }
+}
+
+void ImageKernels::fill(uint8_t * dst, size_t dstStride, size_t rowBytes, size_t rows, uint8_t value) {
+  if (dstStride == rowBytes) {
+    memset(dst, value, rowBytes * rows);
+    return;
+  }
+  for (size_t y = 0; y < rows; ++y) {
+    memset(dst + y * dstStride, value, rowBytes);
+  }
+}
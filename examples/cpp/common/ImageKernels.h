@@ -0,0 +1,66 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Per pixel kernels for the image work on the loading and capture paths,
+ * with SSE2, SSSE3 and AVX2 versions on x86, NEON on ARM and a scalar
+ * fallback.  The best level the CPU supports is picked on first use.
+ *
+ * Images are rows of tightly packed 8 bit channels, with a stride in bytes
+ * between the starts of rows.  Source and destination must not overlap,
+ * except for flipRows, which works in place.
+ */
+class ImageKernels {
+public:
+  enum Level {
+    SCALAR,
+    SSE2,
+    SSSE3,
+    AVX2,
+    NEON,
+    LEVEL_COUNT
+  };
+
+  static const char * levelName(Level level);
+  static bool isSupported(Level level);
+  static Level getLevel();
+  // Only for comparing the levels, don't call while kernels are running on
+  // other threads.  Unsupported levels are ignored.
+  static void setLevel(Level level);
+
+  // Reverses the order of the rows, which is how OpenCV and most image
+  // formats differ from GL
+  static void flipRows(uint8_t * pixels, size_t stride, size_t rowBytes, size_t rows);
+
+  // Three channel to four channel with opaque alpha, swapping red and blue
+  // in the BGR versions.  With flip the destination rows are written bottom
+  // up, so decoding and flipping take a single pass.
+  static void bgrToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip = false);
+  static void rgbToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip = false);
+  static void bgraToRgba(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t width, size_t height, bool flip = false);
+
+  // Copies a sub-rectangle, rowBytes wide, between images of any stride
+  static void blit(const uint8_t * src, size_t srcStride, uint8_t * dst, size_t dstStride,
+    size_t rowBytes, size_t rows);
+  static void fill(uint8_t * dst, size_t dstStride, size_t rowBytes, size_t rows, uint8_t value);
+};
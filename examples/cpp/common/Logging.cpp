@@ -0,0 +1,393 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+#ifdef OS_WIN
+#pragma warning (disable : 4996)
+#include <Windows.h>
+#define snprintf _snprintf
+#endif
+
+const size_t Logger::PAYLOAD_SIZE;
+const size_t Logger::RING_SIZE;
+
+// Single producer (the owning thread), single consumer (whoever holds the
+// drain mutex).  Rings outlive their threads, so a thread that exits with
+// messages still queued doesn't lose them.  Once drained, the ring of an
+// exited thread is handed to the next thread that logs.
+struct Logger::Ring {
+  std::atomic<size_t> head{ 0 };
+  std::atomic<size_t> tail{ 0 };
+  std::atomic<bool> retired{ false };
+  Entry entries[RING_SIZE];
+};
+
+#ifdef HAVE_THREAD_LOCAL_OBJECTS
+// Set once the thread's ring is retired.  Plain data, so it can still be
+// read by logging from thread local destructors that run after the owner's.
+static THREAD_LOCAL bool THREAD_EXITED = false;
+
+namespace {
+  // Retires the thread's ring when the thread exits
+  struct RingOwner {
+    Logger::Ring * ring{ nullptr };
+    ~RingOwner() {
+      THREAD_EXITED = true;
+      if (ring) {
+        ring->retired.store(true, std::memory_order_release);
+        ring = nullptr;
+      }
+    }
+  };
+}
+
+static thread_local RingOwner THREAD_RING;
+#else
+// Without thread local destructors a thread's exit goes unnoticed, and its
+// ring is never reused
+struct RingPointer {
+  Logger::Ring * ring;
+};
+
+static THREAD_LOCAL RingPointer THREAD_RING = { nullptr };
+#endif
+static const int DRAIN_INTERVAL_MS = 5;
+
+Logger & Logger::instance() {
+  // Deliberately leaked, so that logging keeps working during static
+  // destruction.  The drain thread is stopped by an atexit handler, after
+  // which all logging is synchronous.
+  static Logger * INSTANCE = nullptr;
+  static std::once_flag once;
+  std::call_once(once, [] {
+    INSTANCE = new Logger();
+    INSTANCE->start();
+    atexit([] {
+      INSTANCE->shutdown();
+    });
+  });
+  return *INSTANCE;
+}
+
+Logger::Logger() {
+}
+
+void Logger::start() {
+  running = true;
+  drainThread = std::thread([&] {
+    ThreadPlacement::apply(ThreadPlacement::WORKER);
+    drainLoop();
+  });
+}
+
+void Logger::shutdown() {
+  if (running.exchange(false)) {
+    wake.notify_all();
+    drainThread.join();
+  }
+  setSynchronous(true);
+}
+
+void Logger::drainLoop() {
+  while (running) {
+    {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+      wake.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS));
+    }
+    std::lock_guard<std::mutex> guard(drainMutex);
+    if (drain()) {
+      flushOutput();
+    }
+  }
+}
+
+void Logger::flush() {
+  std::lock_guard<std::mutex> guard(drainMutex);
+  drain();
+  flushOutput();
+}
+
+void Logger::setOutputFile(const std::string & path) {
+  std::lock_guard<std::mutex> guard(drainMutex);
+  drain();
+  flushOutput();
+  file.reset();
+  if (!path.empty()) {
+    file = std::unique_ptr<std::ofstream>(new std::ofstream(path.c_str(), std::ios::out | std::ios::app));
+    if (!file->is_open()) {
+      file.reset();
+      write(STDERR, "Unable to open log file " + path);
+    }
+  }
+}
+
+void Logger::setSynchronous(bool synchronous) {
+  if (synchronous) {
+    // Anything already queued has to come out before the next direct write
+    flush();
+  }
+  this->synchronous = synchronous;
+}
+
+Logger::Ring * Logger::threadRing() {
+#ifdef HAVE_THREAD_LOCAL_OBJECTS
+  // The ring may already belong to another thread, and the owner can't be
+  // constructed again
+  if (THREAD_EXITED) {
+    return nullptr;
+  }
+#endif
+  if (!THREAD_RING.ring) {
+    std::lock_guard<std::mutex> guard(ringsMutex);
+    for (auto & ring : rings) {
+      // Messages still queued keep their ring until the drain thread is
+      // done with them
+      if (ring->retired.load(std::memory_order_acquire) &&
+          ring->tail.load(std::memory_order_acquire) == ring->head.load(std::memory_order_relaxed)) {
+        ring->retired.store(false, std::memory_order_relaxed);
+        THREAD_RING.ring = ring.get();
+        break;
+      }
+    }
+    if (!THREAD_RING.ring) {
+      rings.push_back(std::unique_ptr<Ring>(new Ring()));
+      THREAD_RING.ring = rings.back().get();
+    }
+  }
+  return THREAD_RING.ring;
+}
+
+Logger::Entry * Logger::acquire(Ring & ring) {
+  size_t head = ring.head.load(std::memory_order_relaxed);
+  size_t tail = ring.tail.load(std::memory_order_acquire);
+  if (head - tail >= RING_SIZE) {
+    return nullptr;
+  }
+  return &ring.entries[head % RING_SIZE];
+}
+
+void Logger::commit(Ring & ring) {
+  size_t head = ring.head.load(std::memory_order_relaxed) + 1;
+  ring.head.store(head, std::memory_order_release);
+  // Bursts shouldn't have to wait out the drain interval before being dropped
+  if (head - ring.tail.load(std::memory_order_relaxed) == RING_SIZE / 2) {
+    wake.notify_one();
+  }
+}
+
+// Must be called with the drain mutex held
+bool Logger::drain() {
+  typedef std::pair<int64_t, std::pair<Stream, std::string>> Message;
+  std::vector<Message> messages;
+  std::vector<Ring *> snapshot;
+  {
+    std::lock_guard<std::mutex> guard(ringsMutex);
+    for (auto & ring : rings) {
+      snapshot.push_back(ring.get());
+    }
+  }
+
+  for (Ring * ring : snapshot) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t head = ring->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      Entry & entry = ring->entries[tail % RING_SIZE];
+      std::string text;
+      if (entry.preformatted) {
+        text.swap(*entry.preformatted);
+        delete entry.preformatted;
+        entry.preformatted = nullptr;
+      } else {
+        text = formatEntry(entry);
+      }
+      messages.push_back(Message(entry.time, std::make_pair(entry.stream, std::string())));
+      messages.back().second.second.swap(text);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+
+  size_t droppedNow = dropped;
+  if (droppedNow != reportedDropped) {
+    messages.push_back(Message(Platform::elapsedNanos(), std::make_pair(STDERR,
+      Platform::format("Logger dropped %d messages", (int)(droppedNow - reportedDropped)))));
+    reportedDropped = droppedNow;
+  }
+
+  if (messages.empty()) {
+    return false;
+  }
+
+  std::stable_sort(messages.begin(), messages.end(), [](const Message & a, const Message & b) {
+    return a.first < b.first;
+  });
+  for (const Message & message : messages) {
+    write(message.second.first, message.second.second);
+  }
+  return true;
+}
+
+void Logger::write(Stream stream, const std::string & text) {
+#ifdef OS_WIN
+  OutputDebugStringA(text.c_str());
+  OutputDebugStringA("\n");
+#endif
+  if (file) {
+    *file << text << '\n';
+  } else {
+    (stream == STDERR ? std::cerr : std::cout) << text << '\n';
+  }
+}
+
+void Logger::writeNow(Stream stream, const std::string & text) {
+  std::lock_guard<std::mutex> guard(drainMutex);
+  drain();
+  write(stream, text);
+  flushOutput();
+}
+
+void Logger::flushOutput() {
+  if (file) {
+    file->flush();
+  }
+  std::cout.flush();
+  std::cerr.flush();
+}
+
+bool Logger::Encoder::putString(const char * str) {
+  size_t size = strlen(str) + 1;
+  if (size > (size_t)(end - cur)) {
+    return false;
+  }
+  memcpy(cur, str, size);
+  cur += size;
+  return true;
+}
+
+bool Logger::Encoder::put(char tag, const void * value, size_t size) {
+  if (size + 1 > (size_t)(end - cur)) {
+    return false;
+  }
+  *cur++ = tag;
+  if (size) {
+    memcpy(cur, value, size);
+    cur += size;
+  }
+  return true;
+}
+
+template <typename T>
+static void appendFormatted(std::string & out, const std::string & spec, T value) {
+  char buffer[256];
+  int size = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+  if (size < 0) {
+    return;
+  }
+  if ((size_t)size < sizeof(buffer)) {
+    out.append(buffer, size);
+    return;
+  }
+  std::vector<char> large(size + 1);
+  snprintf(&large[0], large.size(), spec.c_str(), value);
+  out.append(&large[0], size);
+}
+
+// Replays the captured printf call one conversion at a time.  Length
+// modifiers in the format are ignored, since integers were widened to 64
+// bits and floats to double when they were captured.
+std::string Logger::formatEntry(const Entry & entry) {
+  const char * format = entry.payload;
+  const char * args = format + strlen(format) + 1;
+  const char * const end = entry.payload + PAYLOAD_SIZE;
+  std::string result;
+
+  const char * cur = format;
+  while (*cur) {
+    if (*cur != '%') {
+      const char * next = strchr(cur, '%');
+      if (!next) {
+        next = cur + strlen(cur);
+      }
+      result.append(cur, next - cur);
+      cur = next;
+      continue;
+    }
+
+    if (cur[1] == '%') {
+      result += '%';
+      cur += 2;
+      continue;
+    }
+
+    // Flags, width and precision are passed through, length modifiers dropped
+    std::string spec("%");
+    ++cur;
+    while (*cur && strchr("-+ #0", *cur)) {
+      spec += *cur++;
+    }
+    while (*cur && (isdigit(*cur) || *cur == '.')) {
+      spec += *cur++;
+    }
+    while (*cur && strchr("hlLqjzt", *cur)) {
+      ++cur;
+    }
+    char conversion = *cur;
+    if (!conversion) {
+      break;
+    }
+    ++cur;
+
+    char tag = args < end ? *args : 0;
+    if (strchr("di", conversion) && (tag == Encoder::INT || tag == Encoder::UINT)) {
+      long long value;
+      memcpy(&value, args + 1, sizeof(int64_t));
+      appendFormatted(result, spec + "ll" + conversion, value);
+      args += 1 + sizeof(int64_t);
+    } else if (strchr("uoxX", conversion) && (tag == Encoder::INT || tag == Encoder::UINT)) {
+      unsigned long long value;
+      memcpy(&value, args + 1, sizeof(uint64_t));
+      appendFormatted(result, spec + "ll" + conversion, value);
+      args += 1 + sizeof(uint64_t);
+    } else if (conversion == 'c' && (tag == Encoder::INT || tag == Encoder::UINT)) {
+      int64_t value;
+      memcpy(&value, args + 1, sizeof(int64_t));
+      appendFormatted(result, spec + conversion, (int)value);
+      args += 1 + sizeof(int64_t);
+    } else if (strchr("fFeEgGaA", conversion) && tag == Encoder::DOUBLE) {
+      double value;
+      memcpy(&value, args + 1, sizeof(double));
+      appendFormatted(result, spec + conversion, value);
+      args += 1 + sizeof(double);
+    } else if (conversion == 's' && tag == Encoder::STRING) {
+      const char * value = args + 1;
+      appendFormatted(result, spec + conversion, value);
+      args = value + strlen(value) + 1;
+    } else if (conversion == 'p' && tag == Encoder::POINTER) {
+      const void * value;
+      memcpy(&value, args + 1, sizeof(value));
+      appendFormatted(result, spec + conversion, value);
+      args += 1 + sizeof(value);
+    } else {
+      // Argument missing or of the wrong type for the conversion
+      result += "<?>";
+      args = end;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,202 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Asynchronous logging behind SAY / SAY_ERR.
+ *
+ * Each thread that logs gets its own single producer ring buffer, so a log
+ * call never takes a lock.  The caller only copies the format string and
+ * the raw argument values into a ring slot; formatting and the actual write
+ * to the console (or a file) happen on a background drain thread, which
+ * merges the per-thread rings in timestamp order.
+ *
+ * If a thread's ring is full the message is dropped and counted rather than
+ * blocking the caller.  Messages whose arguments don't fit in a slot are
+ * formatted eagerly on the calling thread instead.
+ */
+class Logger {
+public:
+  static const size_t PAYLOAD_SIZE = 232;
+  static const size_t RING_SIZE = 512;
+
+  enum Stream {
+    STDOUT,
+    STDERR,
+  };
+
+  struct Entry {
+    int64_t time;
+    Stream stream;
+    // Set when the message had to be formatted on the calling thread
+    std::string * preformatted;
+    // The NUL terminated format string followed by the encoded arguments
+    char payload[PAYLOAD_SIZE];
+  };
+
+  struct Ring;
+
+  static Logger & instance();
+
+  template <typename ... Args>
+  static void say(std::ostream & out, const char * format, const Args & ... args) {
+    instance().submit(&out == &std::cerr ? STDERR : STDOUT, format, args...);
+  }
+
+  // Block until every message queued so far has been written
+  void flush();
+  // Write to the given file instead of the console.  An empty path restores
+  // console output.
+  void setOutputFile(const std::string & path);
+  // Format and write on the calling thread, bypassing the queue
+  void setSynchronous(bool synchronous);
+  size_t getDroppedCount() const {
+    return dropped;
+  }
+
+private:
+  Logger();
+  void start();
+  void shutdown();
+  void drainLoop();
+  bool drain();
+  void write(Stream stream, const std::string & text);
+  void writeNow(Stream stream, const std::string & text);
+  void flushOutput();
+  // Null once the calling thread is exiting
+  Ring * threadRing();
+  Entry * acquire(Ring & ring);
+  void commit(Ring & ring);
+  static std::string formatEntry(const Entry & entry);
+
+  template <typename ... Args>
+  void submit(Stream stream, const char * format, const Args & ... args) {
+    // Threads in their exit write directly too
+    Ring * ring = synchronous ? nullptr : threadRing();
+    if (!ring) {
+      writeNow(stream, Platform::format(format, printfArg(args)...));
+      return;
+    }
+
+    Entry * entry = acquire(*ring);
+    if (!entry) {
+      ++dropped;
+      return;
+    }
+    entry->time = Platform::elapsedNanos();
+    entry->stream = stream;
+    entry->preformatted = nullptr;
+    Encoder encoder(entry->payload);
+    if (!encoder.putString(format) || !encodeAll(encoder, args...)) {
+      entry->preformatted = new std::string(Platform::format(format, printfArg(args)...));
+    }
+    commit(*ring);
+  }
+
+  class Encoder {
+    char * cur;
+    char * const end;
+
+  public:
+    enum Tag {
+      INT = 'i',
+      UINT = 'u',
+      DOUBLE = 'd',
+      STRING = 's',
+      POINTER = 'p',
+    };
+
+    Encoder(char * payload) : cur(payload), end(payload + PAYLOAD_SIZE) {}
+
+    bool putString(const char * str);
+    bool put(char tag, const void * value, size_t size);
+
+    template <typename T>
+    bool encode(T value, std::true_type /* integral or enum */, std::false_type) {
+      if (std::is_signed<T>::value) {
+        int64_t v = (int64_t)value;
+        return put(INT, &v, sizeof(v));
+      }
+      uint64_t v = (uint64_t)value;
+      return put(UINT, &v, sizeof(v));
+    }
+
+    template <typename T>
+    bool encode(T value, std::false_type, std::true_type /* floating point */) {
+      double v = (double)value;
+      return put(DOUBLE, &v, sizeof(v));
+    }
+
+    bool encode(const char * value, std::false_type, std::false_type) {
+      return put(STRING, nullptr, 0) && putString(value ? value : "(null)");
+    }
+
+    bool encode(char * value, std::false_type, std::false_type) {
+      return encode((const char *)value, std::false_type(), std::false_type());
+    }
+
+    bool encode(const void * value, std::false_type, std::false_type) {
+      return put(POINTER, &value, sizeof(value));
+    }
+  };
+
+  template <typename T>
+  static bool encodeOne(Encoder & encoder, const T & arg) {
+    typedef typename std::decay<T>::type Decayed;
+    return encoder.encode((Decayed)arg,
+      std::integral_constant<bool, std::is_integral<Decayed>::value || std::is_enum<Decayed>::value>(),
+      std::integral_constant<bool, std::is_floating_point<Decayed>::value>());
+  }
+
+  static bool encodeOne(Encoder & encoder, const std::string & arg) {
+    return encodeOne(encoder, arg.c_str());
+  }
+
+  static bool encodeAll(Encoder &) {
+    return true;
+  }
+
+  template <typename T, typename ... Rest>
+  static bool encodeAll(Encoder & encoder, const T & first, const Rest & ... rest) {
+    return encodeOne(encoder, first) && encodeAll(encoder, rest...);
+  }
+
+  template <typename T>
+  static const T & printfArg(const T & arg) {
+    return arg;
+  }
+
+  static const char * printfArg(const std::string & arg) {
+    return arg.c_str();
+  }
+
+  std::vector<std::unique_ptr<Ring>> rings;
+  std::mutex ringsMutex;
+  // Serializes the consumer side of the rings and all output
+  std::mutex drainMutex;
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::thread drainThread;
+  std::atomic<bool> running{ false };
+  std::atomic<bool> synchronous{ false };
+  std::atomic<size_t> dropped{ 0 };
+  size_t reportedDropped{ 0 };
+  std::unique_ptr<std::ofstream> file;
+};
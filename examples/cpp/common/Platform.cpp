@@ -25,11 +25,16 @@
 #define snprintf _snprintf
 #else
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <cstdarg>
 #endif
 
+#ifdef OS_OSX
+#include <mach/mach_time.h>
+#endif
+
 void Platform::sleepMillis(int millis) {
 #ifdef OS_WIN
   Sleep(millis);
@@ -38,40 +43,64 @@ void Platform::sleepMillis(int millis) {
 #endif
 }
 
-long Platform::elapsedMillis() {
-#ifdef OS_WIN
-  static long start = GetTickCount();
-  return GetTickCount() - start;
+static int64_t monotonicNanos() {
+#if defined(OS_WIN)
+  static LARGE_INTEGER frequency;
+  if (0 == frequency.QuadPart) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  // Split the conversion to avoid overflowing 64 bits on long uptimes
+  int64_t seconds = counter.QuadPart / frequency.QuadPart;
+  int64_t remainder = counter.QuadPart % frequency.QuadPart;
+  return seconds * 1000000000LL + (remainder * 1000000000LL) / frequency.QuadPart;
+#elif defined(OS_OSX)
+  static mach_timebase_info_data_t timebase;
+  if (0 == timebase.denom) {
+    mach_timebase_info(&timebase);
+  }
+  return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom);
 #else
-  timeval time;
-  gettimeofday(&time, NULL);
-  long millis = (time.tv_sec * 1000) + (time.tv_usec / 1000);
-  static long start = millis;
-  return millis - start;
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000LL + time.tv_nsec;
 #endif
 }
 
+int64_t Platform::elapsedNanos() {
+  static const int64_t start = monotonicNanos();
+  return monotonicNanos() - start;
+}
+
+long Platform::elapsedMillis() {
+  return (long)(elapsedNanos() / 1000000LL);
+}
+
 float Platform::elapsedSeconds() {
-  return (float)elapsedMillis() / 1000.0f;
+  return (float)((double)elapsedNanos() / 1e9);
 }
 
 static const size_t BUFFER_SIZE = 8192;
 
 void Platform::fail(const char * file, int line, const char * message, ...) {
-  static char ERROR_BUFFER1[BUFFER_SIZE];
-  static char ERROR_BUFFER2[BUFFER_SIZE];
+  char messageBuffer[BUFFER_SIZE];
+  char errorBuffer[BUFFER_SIZE];
   va_list arg;
   va_start(arg, message);
-  vsnprintf(ERROR_BUFFER1, BUFFER_SIZE, message, arg);
+  vsnprintf(messageBuffer, BUFFER_SIZE, message, arg);
   va_end(arg);
-  snprintf(ERROR_BUFFER2, BUFFER_SIZE, "FATAL %s (%d): %s", file, line,
-      ERROR_BUFFER1);
-  std::string error(ERROR_BUFFER2);
-  std::cerr << error << std::endl;
+  snprintf(errorBuffer, BUFFER_SIZE, "FATAL %s (%d): %s", file, line,
+      messageBuffer);
+  std::string error(errorBuffer);
+  // The exception may well never be caught, so get everything queued out
+  // before throwing
+  Logger::say(std::cerr, "%s", error);
+  Logger::instance().flush();
   // If you got here, something's pretty wrong
 #ifdef OS_WIN
   if (NULL == GetConsoleWindow()) {
-    MessageBoxA(NULL, ERROR_BUFFER2, "Message", IDOK | MB_ICONERROR);
+    MessageBoxA(NULL, errorBuffer, "Message", IDOK | MB_ICONERROR);
   }
   DebugBreak();
 #endif
@@ -80,40 +109,159 @@ void Platform::fail(const char * file, int line, const char * message, ...) {
 }
 
 void Platform::say(std::ostream & out, const char * message, ...) {
-  static char SAY_BUFFER[BUFFER_SIZE];
+  char sayBuffer[BUFFER_SIZE];
   va_list arg;
   va_start(arg, message);
-  vsnprintf(SAY_BUFFER, BUFFER_SIZE, message, arg);
+  vsnprintf(sayBuffer, BUFFER_SIZE, message, arg);
   va_end(arg);
-#ifdef OS_WIN
-  OutputDebugStringA(SAY_BUFFER);
-  OutputDebugStringA("\n");
+  Logger::say(out, "%s", sayBuffer);
+}
+
+// Resources that are loaded from disk at runtime (debug and Linux builds)
+// can be mapped instead of read.  A size of zero accepts a file of any size.
+static ResourceView mapResourceFile(Resource resource, size_t size) {
+  std::string path = Resources::getResourcePath(resource);
+  std::string candidates[] = {
+    path,
+    std::string(PROJECT_DIR "/resources/") + path,
+  };
+  for (const std::string & candidate : candidates) {
+    ResourceView result = ResourceView::mapFile(candidate);
+    // Guard against picking up an unrelated file with the same name
+    if (!result.empty() && (!size || result.size() == size)) {
+      return result;
+    }
+  }
+  return ResourceView();
+}
+
+static const std::string & resourceRoot() {
+  static const std::string ROOT(PROJECT_DIR "/resources/");
+  return ROOT;
+}
+
+// Archive entries are named relative to the resource root
+static std::string archivePath(Resource resource) {
+  const std::string & root = resourceRoot();
+  std::string path = Resources::getResourcePath(resource);
+  if (0 == path.compare(0, root.size(), root)) {
+    path = path.substr(root.size());
+  }
+  std::replace(path.begin(), path.end(), '\\', '/');
+  return path;
+}
+
+std::string Platform::getResourceName(Resource resource) {
+  return archivePath(resource);
+}
+
+// Debug builds look at the loose files first, so that resources edited
+// on disk are picked up while an older archive is still around
+#ifdef RIFT_DEBUG
+static const bool LOOSE_FILES_FIRST = true;
+#else
+static const bool LOOSE_FILES_FIRST = false;
 #endif
-  out << std::string(SAY_BUFFER) << std::endl;
+
+ResourceView Platform::getResourceView(const std::string & name) {
+  if (LOOSE_FILES_FIRST) {
+    ResourceView result = ResourceView::mapFile(resourceRoot() + name);
+    if (!result.empty()) {
+      return result;
+    }
+  }
+  ResourceArchive & archive = ResourceArchive::instance();
+  if (archive.isOpen()) {
+    ResourceView result = archive.get(name);
+    if (!result.empty()) {
+      return result;
+    }
+  }
+  return LOOSE_FILES_FIRST ? ResourceView() : ResourceView::mapFile(resourceRoot() + name);
 }
 
-std::string Platform::getResourceString(Resource resource) {
+ResourceView Platform::getResourceView(Resource resource) {
+  typedef std::map<Resource, ResourceView> ViewMap;
+  static ViewMap mapped;
+  static std::mutex mutex;
+
+  if (!LOOSE_FILES_FIRST) {
+    ResourceArchive & archive = ResourceArchive::instance();
+    if (archive.isOpen()) {
+      ResourceView result = archive.get(archivePath(resource));
+      if (!result.empty()) {
+        return result;
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    ViewMap::iterator itr = mapped.find(resource);
+    if (itr != mapped.end()) {
+      return itr->second;
+    }
+  }
+
+  // Edited files differ in size from the embedded copy, so in debug builds
+  // any loose file counts
   size_t size = Resources::getResourceSize(resource);
-  char * data = new char[size];
-  Resources::getResourceData(resource, data);
-  std::string dataStr(data, size);
-  delete[] data;
-  return dataStr;
+  ResourceView result = mapResourceFile(resource, LOOSE_FILES_FIRST ? 0 : size);
+  if (!result.empty()) {
+    // Mappings cost no memory of their own, so keep them around
+    std::lock_guard<std::mutex> guard(mutex);
+    mapped[resource] = result;
+    return result;
+  }
+
+  if (LOOSE_FILES_FIRST) {
+    ResourceArchive & archive = ResourceArchive::instance();
+    if (archive.isOpen()) {
+      ResourceView result = archive.get(archivePath(resource));
+      if (!result.empty()) {
+        return result;
+      }
+    }
+  }
+
+  // Embedded resources can only be had by copying them out
+  std::vector<uint8_t> data(size);
+  if (size) {
+    Resources::getResourceData(resource, &data[0]);
+  }
+  return ResourceView::adopt(std::move(data));
 }
 
-std::vector<uint8_t> Platform::getResourceByteVector(Resource resource) {
-  size_t size = Resources::getResourceSize(resource);
-  std::vector<uint8_t> data; 
-  data.resize(size);
-  Resources::getResourceData(resource, &data[0]);
-  return data;
+ResourceView Platform::getDerivedResourceView(Resource resource, const std::string & extension) {
+  ResourceArchive & archive = ResourceArchive::instance();
+  if (archive.isOpen()) {
+    ResourceView result = archive.get(archivePath(resource) + extension);
+    if (!result.empty()) {
+      return result;
+    }
+  }
+  // The same places mapResourceFile looks for the resource itself
+  std::string path = Resources::getResourcePath(resource) + extension;
+  std::string candidates[] = {
+    path,
+    resourceRoot() + path,
+  };
+  for (const std::string & candidate : candidates) {
+    ResourceView result = ResourceView::mapFile(candidate);
+    if (!result.empty()) {
+      return result;
+    }
+  }
+  return ResourceView();
+}
+
+std::string Platform::getResourceString(Resource resource) {
+  return getResourceView(resource).toString();
 }
 
-std::stringstream && Platform::getResourceStream(Resource resource) {
-  std::string data = Platform::getResourceString(resource);
-  std::stringstream result;
-  result.str(data);
-  return std::move(result);
+std::vector<uint8_t> Platform::getResourceByteVector(Resource resource) {
+  ResourceView view = getResourceView(resource);
+  return std::vector<uint8_t>(view.begin(), view.end());
 }
 
 
@@ -148,6 +296,17 @@ std::string Platform::replaceAll(const std::string & in, const std::string & fro
   return str;
 }
 
+bool Platform::hasExtension(const std::string & path, const std::string & extension) {
+  if (path.size() < extension.size()) {
+    return false;
+  }
+  std::string suffix = path.substr(path.size() - extension.size());
+  std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+  std::string lower = extension;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return suffix == lower;
+}
+
 
 typedef std::vector<std::function<void()>> VecLambda;
 VecLambda & getShutdownHooks() {
@@ -182,18 +341,16 @@ void Platform::setThreadPriority(ThreadPriority priority) {
   }
   SetThreadPriority(GetCurrentThread(), win32priority);
 #else 
+  // SCHED_FIFO only accepts priorities of 1 and up, and even its minimum
+  // preempts every normal thread, so only HIGH gets a real time policy.
+  // POSIX has no way to go below normal for a single thread.
+  int policy = SCHED_OTHER;
   sched_param params;
-  switch (priority) {
-  case LOW:
-    params.sched_priority = sched_get_priority_min(SCHED_FIFO);
-    break;
-  case MEDIUM:
-    params.sched_priority = 0;
-    break;
-  case HIGH:
+  params.sched_priority = 0;
+  if (HIGH == priority) {
+    policy = SCHED_FIFO;
     params.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    break;
   }
-  pthread_setschedparam(pthread_self(), SCHED_FIFO, &params);
+  pthread_setschedparam(pthread_self(), policy, &params);
 #endif
 }
@@ -29,22 +29,52 @@ public:
     HIGH
   };
   static void sleepMillis(int millis);
+  // Monotonic time since the first call, unaffected by wall clock changes
+  static int64_t elapsedNanos();
   static long elapsedMillis();
   static float elapsedSeconds();
   static void fail(const char * file, int line, const char * message, ...);
   static void say(std::ostream & out, const char * message, ...);
   static std::string format(const char * formatString, ...);
+  // The bytes of a resource without copying them where possible, from the
+  // resource archive if there is one.  Prefer this over the string and
+  // vector versions, which have to copy.
+  static ResourceView getResourceView(Resource resource);
+  // A file built from a resource by the tools, such as "images/floor.png.ktx",
+  // or an empty view when the build didn't produce one
+  static ResourceView getDerivedResourceView(Resource resource, const std::string & extension);
+  // A resource's path relative to the resource root, like "shaders/Lit.vs",
+  // which is also its name in the archive
+  static std::string getResourceName(Resource resource);
+  // A resource, or a file built from one, by that name.  Unlike resources
+  // looked up by enum, this only finds files in the archive or on disk.
+  static ResourceView getResourceView(const std::string & name);
   static std::string getResourceString(Resource resource);
   static std::vector<uint8_t> getResourceByteVector(Resource resource);
-  static std::stringstream && getResourceStream(Resource resource);
 
   static std::string replaceAll(const std::string & in, const std::string & from, const std::string & to);
+  // Whether the path ends in the extension, like ".obj", ignoring case
+  static bool hasExtension(const std::string & path, const std::string & extension);
+  // See ThreadPlacement for control over policies and core affinity
   static void setThreadPriority(ThreadPriority priority = MEDIUM);
 
   static void addShutdownHook(std::function<void()> f);
   static void runShutdownHooks();
 };
 
+// Visual Studio 2013 and the Apple toolchains lack the C++11 keyword, but
+// all of them support thread local POD types.  Only with the keyword do
+// thread locals get constructors and destructors.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(OS_OSX)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL thread_local
+#define HAVE_THREAD_LOCAL_OBJECTS
+#endif
+
 #define FAIL(...) Platform::fail(__FILE__, __LINE__, __VA_ARGS__)
-#define SAY(...) Platform::say(std::cout, __VA_ARGS__)
-#define SAY_ERR(...) Platform::say(std::cerr, __VA_ARGS__)
+// Formatting and output happen asynchronously, see Logging.h
+#define SAY(...) Logger::say(std::cout, __VA_ARGS__)
+#define SAY_ERR(...) Logger::say(std::cerr, __VA_ARGS__)
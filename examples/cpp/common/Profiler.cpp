@@ -0,0 +1,302 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+const size_t Profiler::MAX_EVENTS_PER_THREAD;
+std::atomic<bool> Profiler::enabled{ false };
+
+namespace {
+  struct Event {
+    // 'X' for a complete zone, 'C' for a counter, 'i' for an instant
+    char type;
+    const char * name;
+    int64_t start;
+    int64_t end;
+    double value;
+    std::string detail;
+  };
+
+  // Only the owning thread appends, so the mutex is uncontended except
+  // while the trace is being written out
+  struct ThreadEvents {
+    std::mutex mutex;
+    int id;
+    std::string name;
+    // Set for tracks that aren't bound to a thread
+    bool track{ false };
+    std::vector<Event> events;
+    size_t dropped{ 0 };
+  };
+
+  struct Recording {
+    std::mutex mutex;
+    std::list<std::unique_ptr<ThreadEvents>> threads;
+    std::string path{ "trace.json" };
+  };
+
+  // Leaked for the same reason as the logger, threads may still be
+  // recording during static destruction
+  Recording & recording() {
+    static Recording * RECORDING = nullptr;
+    static std::once_flag once;
+    std::call_once(once, [] {
+      RECORDING = new Recording();
+      atexit([] {
+        if (Profiler::isEnabled()) {
+          Profiler::setEnabled(false);
+        }
+      });
+    });
+    return *RECORDING;
+  }
+
+  THREAD_LOCAL ThreadEvents * THREAD_EVENTS = nullptr;
+
+  ThreadEvents & threadEvents() {
+    if (!THREAD_EVENTS) {
+      Recording & rec = recording();
+      std::lock_guard<std::mutex> guard(rec.mutex);
+      ThreadEvents * events = new ThreadEvents();
+      events->id = (int)rec.threads.size() + 1;
+      rec.threads.push_back(std::unique_ptr<ThreadEvents>(events));
+      THREAD_EVENTS = events;
+    }
+    return *THREAD_EVENTS;
+  }
+
+  ThreadEvents & trackEvents(const char * name) {
+    Recording & rec = recording();
+    std::lock_guard<std::mutex> guard(rec.mutex);
+    for (auto & thread : rec.threads) {
+      if (thread->track && thread->name == name) {
+        return *thread;
+      }
+    }
+    ThreadEvents * events = new ThreadEvents();
+    events->id = (int)rec.threads.size() + 1;
+    events->name = name;
+    events->track = true;
+    rec.threads.push_back(std::unique_ptr<ThreadEvents>(events));
+    return *events;
+  }
+
+  void record(ThreadEvents & thread, Event && event) {
+    std::lock_guard<std::mutex> guard(thread.mutex);
+    if (thread.events.size() >= Profiler::MAX_EVENTS_PER_THREAD) {
+      ++thread.dropped;
+      return;
+    }
+    thread.events.push_back(std::move(event));
+  }
+
+  void record(Event && event) {
+    record(threadEvents(), std::move(event));
+  }
+
+  void writeString(std::ostream & out, const char * str) {
+    out << '"';
+    for (; *str; ++str) {
+      char c = *str;
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if ((unsigned char)c < 0x20) {
+        out << ' ';
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+
+  // Trace timestamps are in microseconds
+  double micros(int64_t nanos) {
+    return (double)nanos / 1e3;
+  }
+
+  int processId() {
+#ifdef OS_WIN
+    return (int)GetCurrentProcessId();
+#else
+    return (int)getpid();
+#endif
+  }
+
+  // Must be called with the recording mutex held.  Unless clear is set the
+  // recorded events are kept, so a later write still contains them.
+  void writeTrace(Recording & rec, bool clear) {
+    std::ofstream out(rec.path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      SAY_ERR("Unable to write trace to %s", rec.path.c_str());
+      return;
+    }
+
+    int pid = processId();
+    size_t count = 0;
+    size_t dropped = 0;
+    bool first = true;
+    out << std::fixed;
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (auto & thread : rec.threads) {
+      std::vector<Event> events;
+      std::string name;
+      {
+        std::lock_guard<std::mutex> guard(thread->mutex);
+        name = thread->name;
+        dropped += thread->dropped;
+        if (clear) {
+          events.swap(thread->events);
+          thread->dropped = 0;
+        } else {
+          events = thread->events;
+        }
+      }
+
+      if (!name.empty()) {
+        out << (first ? "\n" : ",\n");
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << thread->id << ",\"args\":{\"name\":";
+        writeString(out, name.c_str());
+        out << "}}";
+        first = false;
+      }
+
+      for (const Event & event : events) {
+        out << (first ? "\n" : ",\n");
+        out << "{\"ph\":\"" << event.type << "\",\"name\":";
+        writeString(out, event.name);
+        out << ",\"pid\":" << pid << ",\"tid\":" << thread->id << ",\"ts\":" << micros(event.start);
+        switch (event.type) {
+        case 'X':
+          out << ",\"dur\":" << micros(event.end - event.start);
+          if (!event.detail.empty()) {
+            out << ",\"args\":{\"detail\":";
+            writeString(out, event.detail.c_str());
+            out << "}";
+          }
+          break;
+        case 'C':
+          out << ",\"args\":{\"value\":" << event.value << "}";
+          break;
+        case 'i':
+          out << ",\"s\":\"t\"";
+          break;
+        }
+        out << "}";
+        first = false;
+      }
+      count += events.size();
+    }
+    out << "\n]}\n";
+    SAY("Wrote %d trace events to %s", (int)count, rec.path.c_str());
+    if (dropped) {
+      SAY_ERR("Trace buffers were full, %d events were dropped", (int)dropped);
+    }
+  }
+}
+
+void Profiler::setEnabled(bool enable) {
+  Recording & rec = recording();
+  std::lock_guard<std::mutex> guard(rec.mutex);
+  if (enable == enabled) {
+    return;
+  }
+  enabled = enable;
+  if (enable) {
+    SAY("Trace recording started");
+  } else {
+    writeTrace(rec, true);
+  }
+}
+
+void Profiler::toggle() {
+  setEnabled(!isEnabled());
+}
+
+void Profiler::setOutputFile(const std::string & path) {
+  Recording & rec = recording();
+  std::lock_guard<std::mutex> guard(rec.mutex);
+  rec.path = path;
+}
+
+void Profiler::setThreadName(const char * name) {
+  ThreadEvents & thread = threadEvents();
+  std::lock_guard<std::mutex> guard(thread.mutex);
+  thread.name = name;
+}
+
+void Profiler::counter(const char * name, double value) {
+  if (!isEnabled()) {
+    return;
+  }
+  Event event;
+  event.type = 'C';
+  event.name = name;
+  event.start = event.end = Platform::elapsedNanos();
+  event.value = value;
+  record(std::move(event));
+}
+
+void Profiler::instant(const char * name) {
+  if (!isEnabled()) {
+    return;
+  }
+  Event event;
+  event.type = 'i';
+  event.name = name;
+  event.start = event.end = Platform::elapsedNanos();
+  event.value = 0;
+  record(std::move(event));
+}
+
+void Profiler::completeOnTrack(const char * track, const char * name, int64_t start, int64_t end) {
+  if (!isEnabled()) {
+    return;
+  }
+  Event event;
+  event.type = 'X';
+  event.name = name;
+  event.start = start;
+  event.end = end;
+  event.value = 0;
+  record(trackEvents(track), std::move(event));
+}
+
+void Profiler::flush() {
+  Recording & rec = recording();
+  std::lock_guard<std::mutex> guard(rec.mutex);
+  writeTrace(rec, false);
+}
+
+void Profiler::complete(const char * name, const std::string & detail, int64_t start, int64_t end) {
+  Event event;
+  event.type = 'X';
+  event.name = name;
+  event.start = start;
+  event.end = end;
+  event.value = 0;
+  event.detail = detail;
+  record(std::move(event));
+}
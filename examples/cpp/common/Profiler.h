@@ -0,0 +1,88 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Trace recording in the Chrome trace event format, viewable in
+ * chrome://tracing or the Perfetto UI.
+ *
+ * Zones are RAII objects that record how long a scope took on the current
+ * thread, counters record a value over time.  While recording is disabled
+ * a zone costs a single relaxed atomic load, so they can be left in hot
+ * paths.  Disabling recording writes everything captured so far to the
+ * output file.
+ *
+ * Zone and counter names must be string literals (or otherwise outlive the
+ * recording), only the optional detail string is copied.
+ */
+class Profiler {
+public:
+  static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+  static bool isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+  }
+
+  static void setEnabled(bool enable);
+  static void toggle();
+  // Where the trace is written, defaults to trace.json in the working directory
+  static void setOutputFile(const std::string & path);
+  // Labels the calling thread in the trace viewer
+  static void setThreadName(const char * name);
+  static void counter(const char * name, double value);
+  static void instant(const char * name);
+  // Record a zone measured by something other than the calling thread, such
+  // as the GPU, on a separate named track
+  static void completeOnTrack(const char * track, const char * name, int64_t start, int64_t end);
+  // Write out everything captured so far without stopping the recording
+  static void flush();
+
+  class Zone {
+    const char * name;
+    int64_t start;
+    std::string detail;
+
+  public:
+    Zone(const char * name)
+      : name(name), start(isEnabled() ? Platform::elapsedNanos() : -1) {
+    }
+
+    Zone(const char * name, const std::string & detail)
+      : name(name), start(isEnabled() ? Platform::elapsedNanos() : -1) {
+      if (start >= 0) {
+        this->detail = detail;
+      }
+    }
+
+    ~Zone() {
+      if (start >= 0 && isEnabled()) {
+        complete(name, detail, start, Platform::elapsedNanos());
+      }
+    }
+  };
+
+private:
+  static void complete(const char * name, const std::string & detail, int64_t start, int64_t end);
+  static std::atomic<bool> enabled;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(...) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(__VA_ARGS__)
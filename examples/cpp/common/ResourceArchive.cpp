@@ -0,0 +1,198 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+#include <zlib.h>
+
+const uint32_t ResourceArchive::VERSION;
+const size_t ResourceArchive::ALIGNMENT;
+const char ResourceArchive::MAGIC[8] = { 'O', 'R', 'I', 'A', 'P', 'A', 'K', 0 };
+
+namespace {
+  // Little endian reads that can't run off the end of the archive
+  class IndexReader {
+    const uint8_t * cur;
+    const uint8_t * const end;
+
+  public:
+    IndexReader(const uint8_t * begin, const uint8_t * end) : cur(begin), end(end) {}
+
+    bool skip(size_t size) {
+      if ((size_t)(end - cur) < size) {
+        cur = end;
+        return false;
+      }
+      cur += size;
+      return true;
+    }
+
+    template <typename T>
+    bool read(T & out) {
+      if ((size_t)(end - cur) < sizeof(T)) {
+        cur = end;
+        return false;
+      }
+      uint64_t value = 0;
+      for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= (uint64_t)cur[i] << (8 * i);
+      }
+      out = (T)value;
+      cur += sizeof(T);
+      return true;
+    }
+
+    bool read(std::string & out, size_t size) {
+      if ((size_t)(end - cur) < size) {
+        cur = end;
+        return false;
+      }
+      out.assign((const char *)cur, size);
+      cur += size;
+      return true;
+    }
+  };
+}
+
+ResourceArchive & ResourceArchive::instance() {
+  static ResourceArchive INSTANCE;
+  static std::once_flag once;
+  std::call_once(once, [] {
+    const char * env = getenv("ORIA_RESOURCE_ARCHIVE");
+    std::string candidates[] = {
+      env ? env : "",
+      "resources.pak",
+#ifdef RESOURCE_ARCHIVE
+      RESOURCE_ARCHIVE,
+#endif
+    };
+    for (const std::string & candidate : candidates) {
+      if (!candidate.empty() && INSTANCE.open(candidate)) {
+        SAY("Using resource archive %s", candidate.c_str());
+        break;
+      }
+    }
+  });
+  return INSTANCE;
+}
+
+uint64_t ResourceArchive::hash(const void * data, size_t size) {
+  const uint8_t * bytes = static_cast<const uint8_t *>(data);
+  uint64_t result = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    result ^= bytes[i];
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+bool ResourceArchive::open(const std::string & path) {
+  std::lock_guard<std::mutex> guard(mutex);
+  file = ResourceView::mapFile(path);
+  index.clear();
+  inflated.clear();
+  if (file.empty()) {
+    return false;
+  }
+  if (!readIndex()) {
+    SAY_ERR("Ignoring invalid resource archive %s", path.c_str());
+    file = ResourceView();
+    index.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ResourceArchive::readIndex() {
+  IndexReader header(file.begin(), file.end());
+  uint32_t version, count;
+  uint64_t indexSize;
+  if (file.size() < sizeof(MAGIC) || memcmp(file.data(), MAGIC, sizeof(MAGIC))) {
+    return false;
+  }
+  header.skip(sizeof(MAGIC));
+  if (!header.read(version) || VERSION != version || !header.read(count) || !header.read(indexSize)) {
+    return false;
+  }
+
+  size_t headerSize = sizeof(MAGIC) + 4 + 4 + 8;
+  if (indexSize > file.size() - headerSize) {
+    return false;
+  }
+  IndexReader reader(file.begin() + headerSize, file.begin() + headerSize + indexSize);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint16_t pathLength;
+    std::string path;
+    Entry entry;
+    if (!reader.read(pathLength) || !reader.read(path, pathLength) ||
+        !reader.read(entry.flags) || !reader.read(entry.offset) ||
+        !reader.read(entry.storedSize) || !reader.read(entry.size) ||
+        !reader.read(entry.hash)) {
+      return false;
+    }
+    if (entry.offset > file.size() || entry.storedSize > file.size() - entry.offset) {
+      return false;
+    }
+    index[path] = entry;
+  }
+  return true;
+}
+
+bool ResourceArchive::contains(const std::string & path) const {
+  return index.count(path) > 0;
+}
+
+ResourceView ResourceArchive::get(const std::string & path) {
+  std::lock_guard<std::mutex> guard(mutex);
+  Index::const_iterator itr = index.find(path);
+  if (itr == index.end()) {
+    return ResourceView();
+  }
+  const Entry & entry = itr->second;
+  if (!(entry.flags & COMPRESSED)) {
+    return file.subView((size_t)entry.offset, (size_t)entry.storedSize);
+  }
+
+  ViewMap::const_iterator cached = inflated.find(path);
+  if (cached != inflated.end()) {
+    return cached->second;
+  }
+  ResourceView result = inflate(path, entry);
+  if (!result.empty()) {
+    inflated[path] = result;
+  }
+  return result;
+}
+
+ResourceView ResourceArchive::inflate(const std::string & path, const Entry & entry) {
+  PROFILE_ZONE("ResourceArchive::inflate", path);
+  std::vector<uint8_t> data((size_t)entry.size);
+  uLongf size = (uLongf)entry.size;
+  int result = uncompress(data.data(), &size,
+    file.data() + entry.offset, (uLong)entry.storedSize);
+  if (Z_OK != result || size != entry.size) {
+    SAY_ERR("Failed to inflate %s from the resource archive (%d)", path.c_str(), result);
+    return ResourceView();
+  }
+  if (hash(data.data(), data.size()) != entry.hash) {
+    SAY_ERR("Hash mismatch for %s in the resource archive", path.c_str());
+    return ResourceView();
+  }
+  return ResourceView::adopt(std::move(data));
+}
@@ -0,0 +1,86 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * A single file holding every resource, built at compile time by the
+ * ResourcePacker tool.
+ *
+ * Layout, all integers little endian:
+ *
+ *   header   char magic[8] "ORIAPAK", uint32 version, uint32 entry count,
+ *            uint64 index size in bytes
+ *   index    per entry: uint16 path length, path bytes (relative to the
+ *            resource root, '/' separated), uint32 flags, uint64 offset of
+ *            the data from the start of the file, uint64 stored size,
+ *            uint64 size, uint64 FNV-1a hash of the uncompressed bytes
+ *   data     entry data, each starting on a 16 byte boundary
+ *
+ * The archive is mapped once when it's opened.  Entries stored raw are
+ * returned as views straight into the mapping.  Compressed entries are
+ * inflated on first access, checked against their hash and then cached.
+ */
+class ResourceArchive {
+public:
+  static const uint32_t VERSION = 1;
+  static const size_t ALIGNMENT = 16;
+  static const char MAGIC[8];
+
+  enum Flags {
+    // Stored with zlib, otherwise stored raw
+    COMPRESSED = 1,
+  };
+
+  struct Entry {
+    uint32_t flags{ 0 };
+    uint64_t offset{ 0 };
+    uint64_t storedSize{ 0 };
+    uint64_t size{ 0 };
+    uint64_t hash{ 0 };
+  };
+
+  // The archive the resource loaders consult.  On first use it's opened
+  // from the ORIA_RESOURCE_ARCHIVE environment variable, resources.pak in
+  // the working directory, or the archive produced by the build, in that
+  // order.  If none exists it's simply empty.
+  static ResourceArchive & instance();
+  static uint64_t hash(const void * data, size_t size);
+
+  bool open(const std::string & path);
+  bool isOpen() const {
+    return !file.empty();
+  }
+  bool contains(const std::string & path) const;
+  // The bytes of an entry, or an empty view if there is no such entry or
+  // it is corrupt
+  ResourceView get(const std::string & path);
+
+private:
+  typedef std::unordered_map<std::string, Entry> Index;
+  typedef std::unordered_map<std::string, ResourceView> ViewMap;
+
+  bool readIndex();
+  ResourceView inflate(const std::string & path, const Entry & entry);
+
+  ResourceView file;
+  Index index;
+  ViewMap inflated;
+  std::mutex mutex;
+};
@@ -0,0 +1,120 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ResourceView ResourceView::mapFile(const std::string & path) {
+#ifdef OS_WIN
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == file) {
+    return ResourceView();
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || 0 == fileSize.QuadPart) {
+    CloseHandle(file);
+    return ResourceView();
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (NULL == mapping) {
+    return ResourceView();
+  }
+  const void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (NULL == data) {
+    return ResourceView();
+  }
+  std::shared_ptr<const void> owner(data, [](const void * p) {
+    UnmapViewOfFile(p);
+  });
+  return ResourceView(data, (size_t)fileSize.QuadPart, owner);
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ResourceView();
+  }
+  struct stat info;
+  if (0 != fstat(fd, &info) || 0 == info.st_size) {
+    close(fd);
+    return ResourceView();
+  }
+  size_t size = (size_t)info.st_size;
+  void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (MAP_FAILED == data) {
+    return ResourceView();
+  }
+  std::shared_ptr<const void> owner(data, [size](const void * p) {
+    munmap(const_cast<void *>(p), size);
+  });
+  return ResourceView(data, size, owner);
+#endif
+}
+
+ResourceView ResourceView::adopt(std::vector<uint8_t> && data) {
+  std::shared_ptr<std::vector<uint8_t>> owner(new std::vector<uint8_t>());
+  owner->swap(data);
+  if (owner->empty()) {
+    return ResourceView();
+  }
+  return ResourceView(&(*owner)[0], owner->size(), owner);
+}
+
+ResourceStream::Buffer::Buffer(const ResourceView & view) {
+  char * begin = const_cast<char *>(view.chars());
+  setg(begin, begin, begin + view.size());
+}
+
+std::streambuf::pos_type ResourceStream::Buffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+  char * target;
+  switch (dir) {
+  case std::ios_base::beg:
+    target = eback() + off;
+    break;
+  case std::ios_base::cur:
+    target = gptr() + off;
+    break;
+  default:
+    target = egptr() + off;
+    break;
+  }
+  if (target < eback() || target > egptr()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), target, egptr());
+  return pos_type(target - eback());
+}
+
+std::streambuf::pos_type ResourceStream::Buffer::seekpos(pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
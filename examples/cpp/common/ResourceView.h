@@ -0,0 +1,105 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * A read-only view of a block of bytes, usually the contents of a resource.
+ *
+ * The bytes may be a memory mapped file, memory embedded in the executable
+ * or a buffer owned by the view itself.  Copies of a view share the same
+ * bytes, which stay valid as long as any copy exists.  A view constructed
+ * from a raw pointer doesn't own anything, so the caller has to keep the
+ * memory alive.
+ */
+class ResourceView {
+public:
+  ResourceView() {}
+
+  ResourceView(const void * data, size_t size, std::shared_ptr<const void> owner = std::shared_ptr<const void>())
+    : ptr(static_cast<const uint8_t *>(data)), length(size), owner(owner) {
+  }
+
+  const uint8_t * data() const {
+    return ptr;
+  }
+
+  const char * chars() const {
+    return reinterpret_cast<const char *>(ptr);
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+  bool empty() const {
+    return 0 == length;
+  }
+
+  const uint8_t * begin() const {
+    return ptr;
+  }
+
+  const uint8_t * end() const {
+    return ptr + length;
+  }
+
+  ResourceView subView(size_t offset, size_t size = (size_t)-1) const {
+    offset = std::min(offset, length);
+    return ResourceView(ptr + offset, std::min(size, length - offset), owner);
+  }
+
+  std::string toString() const {
+    return std::string(chars(), length);
+  }
+
+  // Map a file read-only, returning an empty view if that isn't possible
+  static ResourceView mapFile(const std::string & path);
+  // Take ownership of a buffer
+  static ResourceView adopt(std::vector<uint8_t> && data);
+
+private:
+  const uint8_t * ptr{ nullptr };
+  size_t length{ 0 };
+  std::shared_ptr<const void> owner;
+};
+
+/**
+ * A seekable std::istream reading straight out of a view, for parsers that
+ * insist on a stream.  Unlike std::istringstream nothing is copied.
+ */
+class ResourceStream : public std::istream {
+  class Buffer : public std::streambuf {
+  public:
+    Buffer(const ResourceView & view);
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+  };
+
+  ResourceView view;
+  Buffer buffer;
+
+public:
+  ResourceStream(const ResourceView & view)
+    : std::istream(nullptr), view(view), buffer(this->view) {
+    rdbuf(&buffer);
+  }
+};
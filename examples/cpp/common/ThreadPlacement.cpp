@@ -0,0 +1,275 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+#ifdef OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace {
+  struct Placement {
+    std::mutex mutex;
+    ThreadPlacement::Settings settings[ThreadPlacement::ROLE_COUNT];
+    std::vector<ThreadPlacement::Applied> applied;
+
+    Placement() {
+      typedef ThreadPlacement TP;
+      int cores = TP::getCoreCount();
+      if (cores >= 4) {
+        uint64_t all = cores >= 64 ? ~0ULL : ((1ULL << cores) - 1);
+        settings[TP::RENDER].affinity = 1 << 0;
+        settings[TP::DISTORTION].affinity = 1 << 1;
+        settings[TP::CAPTURE].affinity = all & ~3ULL;
+        settings[TP::LOADER].affinity = all & ~3ULL;
+        settings[TP::UI].affinity = all & ~3ULL;
+      }
+      settings[TP::RENDER].policy = TP::FIFO;
+      settings[TP::RENDER].priority = 50;
+      // Timewarp has to be able to preempt the render thread
+      settings[TP::DISTORTION].policy = TP::FIFO;
+      settings[TP::DISTORTION].priority = 75;
+    }
+  };
+
+  Placement & placement() {
+    static Placement PLACEMENT;
+    return PLACEMENT;
+  }
+
+  uint64_t currentThreadId() {
+#if defined(OS_WIN)
+    return GetCurrentThreadId();
+#elif defined(OS_OSX)
+    uint64_t result = 0;
+    pthread_threadid_np(nullptr, &result);
+    return result;
+#else
+    return (uint64_t)syscall(SYS_gettid);
+#endif
+  }
+
+  void setThreadName(const char * name) {
+#if defined(OS_OSX)
+    pthread_setname_np(name);
+#elif defined(OS_LINUX)
+    pthread_setname_np(pthread_self(), name);
+#endif
+    Profiler::setThreadName(name);
+  }
+
+  std::string describeMask(uint64_t mask) {
+    if (!mask) {
+      return "any";
+    }
+    std::string result;
+    for (int i = 0; i < 64; ++i) {
+      if (mask & (1ULL << i)) {
+        result += (result.empty() ? "" : ",") + std::to_string(i);
+      }
+    }
+    return result;
+  }
+
+  void addError(ThreadPlacement::Applied & applied, const std::string & error) {
+    applied.error += (applied.error.empty() ? "" : "; ") + error;
+  }
+
+  void applyAffinity(ThreadPlacement::Applied & applied) {
+    uint64_t mask = applied.requested.affinity;
+#if defined(OS_WIN)
+    if (!mask) {
+      // Undo any mask inherited from the creating thread
+      DWORD_PTR processMask, systemMask;
+      GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+      mask = processMask;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask)) {
+      applied.affinityApplied = true;
+    } else {
+      addError(applied, Platform::format("affinity failed (%d)", (int)GetLastError()));
+    }
+#elif defined(OS_LINUX)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (!mask) {
+      // Undo any mask inherited from the creating thread
+      for (int i = 0; i < CPU_SETSIZE; ++i) {
+        CPU_SET(i, &cpus);
+      }
+    }
+    for (int i = 0; i < 64 && i < CPU_SETSIZE; ++i) {
+      if (mask & (1ULL << i)) {
+        CPU_SET(i, &cpus);
+      }
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (0 == result) {
+      applied.affinityApplied = true;
+    } else {
+      addError(applied, std::string("affinity failed: ") + strerror(result));
+    }
+#else
+    if (!mask) {
+      applied.affinityApplied = true;
+      return;
+    }
+    addError(applied, "affinity not supported on this platform");
+#endif
+  }
+
+  void applyPolicy(ThreadPlacement::Applied & applied) {
+    const ThreadPlacement::Settings & settings = applied.requested;
+    int priority = std::min(std::max(settings.priority, 0), 100);
+#ifdef OS_WIN
+    int win32priority = THREAD_PRIORITY_NORMAL;
+    if (ThreadPlacement::OTHER != settings.policy) {
+      win32priority = priority >= 75 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+    }
+    applied.nativePriority = win32priority;
+    if (SetThreadPriority(GetCurrentThread(), win32priority)) {
+      applied.policyApplied = true;
+    } else {
+      addError(applied, Platform::format("priority failed (%d)", (int)GetLastError()));
+    }
+#else
+    int policy = SCHED_OTHER;
+    switch (settings.policy) {
+    case ThreadPlacement::FIFO:
+      policy = SCHED_FIFO;
+      break;
+    case ThreadPlacement::ROUND_ROBIN:
+      policy = SCHED_RR;
+      break;
+    default:
+      break;
+    }
+    int minPriority = sched_get_priority_min(policy);
+    int maxPriority = sched_get_priority_max(policy);
+    sched_param params;
+    memset(&params, 0, sizeof(params));
+    params.sched_priority = minPriority + (maxPriority - minPriority) * priority / 100;
+    applied.nativePriority = params.sched_priority;
+    int result = pthread_setschedparam(pthread_self(), policy, &params);
+    if (0 == result) {
+      applied.policyApplied = true;
+    } else {
+      addError(applied, std::string("policy failed: ") + strerror(result));
+    }
+#endif
+  }
+
+  std::string describe(const ThreadPlacement::Applied & applied) {
+    const ThreadPlacement::Settings & settings = applied.requested;
+    std::string result = Platform::format("%-10s thread %s: cores %s%s, %s priority %d (native %d)%s",
+      ThreadPlacement::roleName(applied.role), applied.thread.c_str(),
+      describeMask(settings.affinity).c_str(), applied.affinityApplied ? "" : " (not applied)",
+      ThreadPlacement::policyName(settings.policy), settings.priority, applied.nativePriority,
+      applied.policyApplied ? "" : " (not applied)");
+    if (!applied.error.empty()) {
+      result += " - " + applied.error;
+    }
+    return result;
+  }
+}
+
+const char * ThreadPlacement::roleName(Role role) {
+  switch (role) {
+  case RENDER:
+    return "render";
+  case DISTORTION:
+    return "distortion";
+  case CAPTURE:
+    return "capture";
+  case LOADER:
+    return "loader";
+  case UI:
+    return "ui";
+  case WORKER:
+    return "worker";
+  default:
+    return "unknown";
+  }
+}
+
+const char * ThreadPlacement::policyName(Policy policy) {
+  switch (policy) {
+  case FIFO:
+    return "FIFO";
+  case ROUND_ROBIN:
+    return "RR";
+  default:
+    return "OTHER";
+  }
+}
+
+int ThreadPlacement::getCoreCount() {
+  return std::max((int)std::thread::hardware_concurrency(), 1);
+}
+
+void ThreadPlacement::configure(Role role, const Settings & settings) {
+  Placement & p = placement();
+  std::lock_guard<std::mutex> guard(p.mutex);
+  p.settings[role] = settings;
+}
+
+ThreadPlacement::Settings ThreadPlacement::getSettings(Role role) {
+  Placement & p = placement();
+  std::lock_guard<std::mutex> guard(p.mutex);
+  return p.settings[role];
+}
+
+ThreadPlacement::Applied ThreadPlacement::apply(Role role) {
+  Applied result;
+  result.role = role;
+  result.requested = getSettings(role);
+  result.thread = std::to_string(currentThreadId());
+  setThreadName(roleName(role));
+  applyAffinity(result);
+  applyPolicy(result);
+  if (result.error.empty()) {
+    SAY("%s", describe(result).c_str());
+  } else {
+    SAY_ERR("%s", describe(result).c_str());
+  }
+
+  Placement & p = placement();
+  std::lock_guard<std::mutex> guard(p.mutex);
+  p.applied.push_back(result);
+  return result;
+}
+
+std::string ThreadPlacement::report() {
+  Placement & p = placement();
+  std::lock_guard<std::mutex> guard(p.mutex);
+  std::string result;
+  for (const Applied & applied : p.applied) {
+    result += describe(applied) + "\n";
+  }
+  return result;
+}
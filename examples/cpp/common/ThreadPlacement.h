@@ -0,0 +1,94 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Places threads on CPU cores and scheduling policies by role.
+ *
+ * Each role has settings (an affinity mask, a policy and a priority) that
+ * default to something sensible for the number of cores in the machine and
+ * can be overridden with configure().  A thread calls apply() with its role
+ * once, at the start of its body.
+ *
+ * New threads inherit the placement of the thread that starts them, so a
+ * render thread's real time policy and core would leak into every helper
+ * it spawns.  Every thread the examples start applies a role of its own,
+ * WORKER for housekeeping like the log drain, and render loops apply
+ * RENDER only once their setup, which starts most of the helpers,
+ * is done.  The Qt examples' GUI thread, which runs the event loop and the
+ * offscreen UI, applies UI.  What actually took effect, including any
+ * refusal from the OS (real time policies usually need elevated privileges),
+ * is recorded and available from report().
+ *
+ * With four or more cores the defaults keep rendering on core 0 and
+ * distortion on core 1, and push capture, loading and the UI onto the
+ * remaining cores, so they can't steal time from the frame.
+ */
+class ThreadPlacement {
+public:
+  enum Role {
+    RENDER,
+    DISTORTION,
+    CAPTURE,
+    LOADER,
+    UI,
+    // Housekeeping threads, anywhere but never real time
+    WORKER,
+    ROLE_COUNT
+  };
+
+  enum Policy {
+    // The normal time shared scheduler, priority is ignored
+    OTHER,
+    FIFO,
+    ROUND_ROBIN,
+  };
+
+  struct Settings {
+    // Bit N allows the thread to run on core N, 0 allows every core
+    uint64_t affinity{ 0 };
+    Policy policy{ OTHER };
+    // 0 - 100, mapped onto the valid priority range of the policy
+    int priority{ 0 };
+  };
+
+  struct Applied {
+    Role role;
+    std::string thread;
+    Settings requested;
+    bool affinityApplied{ false };
+    bool policyApplied{ false };
+    // The native priority actually passed to the OS
+    int nativePriority{ 0 };
+    std::string error;
+  };
+
+  static const char * roleName(Role role);
+  static const char * policyName(Policy policy);
+  static int getCoreCount();
+
+  static void configure(Role role, const Settings & settings);
+  static Settings getSettings(Role role);
+  // Place the calling thread according to the settings for the role.  The
+  // thread is also named after the role in debuggers and traces.
+  static Applied apply(Role role);
+  // One line per thread that called apply()
+  static std::string report();
+};
@@ -32,31 +32,3 @@ public:
 
 };
 
-
-class RateCounter {
-  std::vector<float> times;
-
-public:
-  void reset() {
-    times.clear();
-  }
-
-  float elapsed() const {
-    if (times.size() < 1) {
-      return 0.0f;
-    }
-    float elapsed = *times.rbegin() - *times.begin();
-    return elapsed;
-  }
-
-  void increment() {
-    times.push_back(Platform::elapsedSeconds());
-  }
-
-  float getRate() const {
-    if (elapsed() == 0.0f) {
-      return NAN;
-    }
-    return (times.size() - 1) / elapsed();
-  }
-};
@@ -70,6 +70,7 @@ GlfwApp::~GlfwApp() {
   }
 
 int GlfwApp::run() {
+  PROFILE_ZONE("GlfwApp::run");
   try {
     preCreate();
     window = createRenderingTarget(windowSize, windowPosition);
@@ -87,17 +88,45 @@ int GlfwApp::run() {
     Finally f([&]{
       shutdownGl();
     });
+    // Only now, so the threads started while setting up don't inherit it
+    ThreadPlacement::apply(ThreadPlacement::RENDER);
 
     while (!glfwWindowShouldClose(window)) {
-      glfwPollEvents();
+      PROFILE_ZONE("frame");
+      timeline.beginFrame(frame + 1);
+      {
+        FrameTimeline::Scope phase(timeline, "poll");
+        glfwPollEvents();
+      }
       ++frame;
-      update();
-      draw();
-      finishFrame();
+      {
+        FrameTimeline::Scope phase(timeline, "update");
+        update();
+      }
+      {
+        FrameTimeline::Scope phase(timeline, "uploads");
+        AssetLoader::instance().processUploads();
+      }
+      GpuTimer & gpuTimer = GpuTimer::instance();
+      gpuTimer.beginFrame(frame);
+      {
+        FrameTimeline::Scope phase(timeline, "draw");
+        draw();
+      }
+      {
+        FrameTimeline::Scope phase(timeline, "finish");
+        finishFrame();
+      }
+      gpuTimer.endFrame();
+      timeline.endFrame();
       fpsCounter.increment();
       if (fpsCounter.elapsed() >= 2.0f) {
         fps = fpsCounter.getRate();
-        SAY("FPS: %0.2f", fps);
+        SAY("FPS: %s", fpsCounter.describe().c_str());
+        SAY("%s", timeline.describe().c_str());
+        if (gpuTimer.isSupported()) {
+          SAY("%s", gpuTimer.describe().c_str());
+        }
         fpsCounter.reset();
       }
     }
@@ -113,6 +142,10 @@ int GlfwApp::getFrame() const {
   return this->frame;
 }
 
+FrameTimeline & GlfwApp::getTimeline() {
+  return timeline;
+}
+
 void GlfwApp::preCreate() {
   glfwWindowHint(GLFW_DEPTH_BITS, 16);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -208,6 +241,9 @@ void GlfwApp::onKey(int key, int scancode, int action, int mods) {
   }
 
   switch (key) {
+  case GLFW_KEY_F12:
+    Profiler::toggle();
+    return;
   case GLFW_KEY_ESCAPE:
     glfwSetWindowShouldClose(window, 1);
     return;
@@ -25,7 +25,8 @@ protected:
   glm::uvec2    windowSize;
   glm::ivec2    windowPosition;
   int           frame{ 0 };
-  RateCounter   fpsCounter;
+  FrameStatistics fpsCounter;
+  FrameTimeline timeline;
 
 protected:
   float         windowAspect{ 1.0f };
@@ -42,6 +43,7 @@ protected:
   virtual void draw() = 0;
 
   int getFrame() const;
+  FrameTimeline & getTimeline();
   const glm::uvec2 & getSize() const;
   const glm::ivec2 & getPosition() const;
   GLFWwindow * getWindow();
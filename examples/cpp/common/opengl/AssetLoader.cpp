@@ -0,0 +1,262 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+#include "Font.h"
+
+const int64_t AssetLoader::DEFAULT_UPLOAD_BUDGET;
+const int AssetLoader::MAX_WORKERS;
+
+AssetLoader & AssetLoader::instance() {
+  static AssetLoader INSTANCE;
+  return INSTANCE;
+}
+
+AssetLoader::AssetLoader() {
+}
+
+void AssetLoader::startWorkers() {
+  // Leave a core each for rendering and distortion
+  int count = std::min(MAX_WORKERS, std::max(1, ThreadPlacement::getCoreCount() - 2));
+  for (int i = 0; i < count; ++i) {
+    workers.push_back(std::thread(&AssetLoader::workerLoop, this));
+  }
+}
+
+AssetLoader::~AssetLoader() {
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    stopping = true;
+    // Uploads that never ran haven't created any GL objects yet, and there
+    // may be no context left to run them in
+    uploads = std::queue<Task>();
+  }
+  decodeReady.notify_all();
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+}
+
+void AssetLoader::enqueueDecode(const std::string & name, Lambda work) {
+  ++pending;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    // Apps that never load anything asynchronously don't pay for the pool
+    if (workers.empty()) {
+      startWorkers();
+    }
+    decodes.push(Task{ name, work });
+  }
+  decodeReady.notify_one();
+}
+
+void AssetLoader::enqueueUpload(const std::string & name, Lambda work) {
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    uploads.push(Task{ name, work });
+  }
+  uploadReady.notify_all();
+}
+
+void AssetLoader::parallelFor(size_t count, const std::function<void(size_t)> & task) {
+  struct Batch {
+    std::atomic<size_t> next{ 0 };
+    size_t remaining{ 0 };
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  if (!count) {
+    return;
+  }
+  std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+  batch->remaining = count;
+  // Helpers that only get to run after the work is gone find nothing left
+  // to claim and return straight away
+  Lambda drain = [batch, task, count] {
+    for (size_t i = batch->next++; i < count; i = batch->next++) {
+      std::exception_ptr error;
+      try {
+        task(i);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> guard(batch->mutex);
+      if (error && !batch->error) {
+        batch->error = error;
+      }
+      if (0 == --batch->remaining) {
+        batch->finished.notify_all();
+      }
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (workers.empty()) {
+      startWorkers();
+    }
+    size_t helpers = std::min(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+      decodes.push(Task{ "parallelFor", drain });
+    }
+  }
+  decodeReady.notify_all();
+
+  drain();
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->finished.wait(lock, [&] {
+    return 0 == batch->remaining;
+  });
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+void AssetLoader::completed() {
+  --pending;
+  uploadReady.notify_all();
+}
+
+void AssetLoader::workerLoop() {
+  ThreadPlacement::apply(ThreadPlacement::LOADER);
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      decodeReady.wait(lock, [&] {
+        return stopping || !decodes.empty();
+      });
+      if (stopping) {
+        return;
+      }
+      task = decodes.front();
+      decodes.pop();
+    }
+    PROFILE_ZONE("decode", task.name);
+    task.work();
+  }
+}
+
+bool AssetLoader::runUpload() {
+  Task task;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (uploads.empty()) {
+      return false;
+    }
+    task = uploads.front();
+    uploads.pop();
+  }
+  {
+    PROFILE_ZONE("upload", task.name);
+    task.work();
+  }
+  completed();
+  return true;
+}
+
+void AssetLoader::processUploads(int64_t budgetNanos) {
+  if (!pending) {
+    return;
+  }
+  int64_t deadline = Platform::elapsedNanos() + budgetNanos;
+  while (runUpload() && Platform::elapsedNanos() < deadline) {
+  }
+}
+
+void AssetLoader::finish() {
+  PROFILE_ZONE("AssetLoader::finish");
+  while (pending) {
+    if (runUpload()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    uploadReady.wait_for(lock, std::chrono::milliseconds(10), [&] {
+      return !pending || !uploads.empty();
+    });
+  }
+}
+
+std::shared_future<TexturePtr> AssetLoader::loadTexture(Resource resource) {
+  return load<TexturePtr>(Resources::getResourcePath(resource), [=]() -> std::function<TexturePtr()> {
+    // Compressed builds need no decoding, just uploading from the mapping
+    if (!Platform::getDerivedResourceView(resource, ".ktx").empty()) {
+      return [=] {
+        return oria::load2dTexture(resource);
+      };
+    }
+    ImagePtr image = oria::loadImage(resource);
+    return [=] {
+      return oria::load2dTexture(resource, image);
+    };
+  });
+}
+
+std::shared_future<TexturePtr> AssetLoader::loadCubemap(Resource firstResource, bool flip) {
+  return load<TexturePtr>(Resources::getResourcePath(firstResource), [=]() -> std::function<TexturePtr()> {
+    if (oria::hasCompressedCubemap(firstResource, flip)) {
+      return [=] {
+        return oria::loadCubemapTexture(firstResource, flip);
+      };
+    }
+    std::vector<ImagePtr> faces = oria::loadCubemapImages(firstResource, flip);
+    return [=] {
+      return oria::loadCubemapTexture(firstResource, faces);
+    };
+  });
+}
+
+std::shared_future<void> AssetLoader::loadFont(Resource resource) {
+  return load<void>(Resources::getResourcePath(resource), [=] {
+    ResourceView data = Platform::getResourceView(resource);
+    Text::FontPtr font(new Text::Font());
+    font->decode(data.data(), data.size());
+    return [=] {
+      font->upload();
+      oria::getFont(resource, font);
+    };
+  });
+}
+
+std::shared_future<void> AssetLoader::loadMesh(Resource resource) {
+  return load<void>(Resources::getResourcePath(resource), [=] {
+    oria::prepareMesh(resource);
+    return [] {};
+  });
+}
+
+void AssetLoader::preload(const std::vector<Resource> & resources) {
+  for (Resource resource : resources) {
+    std::string path = Resources::getResourcePath(resource);
+    if (Platform::hasExtension(path, ".png") || Platform::hasExtension(path, ".jpg")) {
+      loadTexture(resource);
+    } else if (Platform::hasExtension(path, ".sdff")) {
+      loadFont(resource);
+    } else if (Platform::hasExtension(path, ".ctm") || Platform::hasExtension(path, ".obj")) {
+      loadMesh(resource);
+    } else {
+      load<void>(path, [=] {
+        Platform::getResourceView(resource);
+        return [] {};
+      });
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Loads assets in two steps: decoding on a pool of worker threads (started
+ * by the first load), then a GL upload on the render thread.  Every load
+ * returns a future that becomes ready once the upload has run, or holds
+ * the exception if either step failed.
+ *
+ * The render thread drives the uploads by calling processUploads() once a
+ * frame, which runs queued uploads until the time budget is spent (at least
+ * one per call, so loading always makes progress).  GlfwApp and
+ * QRiftWindow already do this.  Never block the render thread on one
+ * of the futures, the upload it is waiting for would never run; use
+ * finish() instead.
+ *
+ * The typed loaders fill the same caches as the synchronous loaders, so a
+ * preloaded texture, font or mesh is picked up by load2dTexture, getFont,
+ * loadMesh and the render helpers without any change at the call site.
+ */
+class AssetLoader {
+public:
+  // Default time allowed for uploads each frame, in nanoseconds
+  static const int64_t DEFAULT_UPLOAD_BUDGET = 2000000;
+  static const int MAX_WORKERS = 16;
+
+  // Runs on a worker and returns the step to run on the render thread
+  template <typename T>
+  using Decoder = std::function<std::function<T()>()>;
+
+  static AssetLoader & instance();
+
+  template <typename T>
+  std::shared_future<T> load(const std::string & name, Decoder<T> decoder) {
+    std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+    std::shared_future<T> result = promise->get_future().share();
+    enqueueDecode(name, [=] {
+      std::function<T()> upload;
+      try {
+        upload = decoder();
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+        completed();
+        return;
+      }
+      enqueueUpload(name, [=] {
+        try {
+          fulfil(*promise, upload);
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      });
+    });
+    return result;
+  }
+
+  std::shared_future<TexturePtr> loadTexture(Resource resource);
+  std::shared_future<TexturePtr> loadCubemap(Resource firstResource, bool flip = true);
+  std::shared_future<void> loadFont(Resource resource);
+  // Meshes can only be decoded ahead of time, the upload happens when a
+  // program first binds them
+  std::shared_future<void> loadMesh(Resource resource);
+
+  // Starts loading every resource, choosing the loader from the file
+  // extension.  Cubemap faces look like any other image, so cubemaps need
+  // loadCubemap.  Anything unrecognized is just paged into memory.
+  void preload(const std::vector<Resource> & resources);
+
+  // Runs task(0) ... task(count - 1) on the worker pool, with the calling
+  // thread helping, and returns once all of them have finished.  The first
+  // exception thrown by a task is rethrown here.  Safe to call from any
+  // thread, including a worker.
+  void parallelFor(size_t count, const std::function<void(size_t)> & task);
+
+  // Render thread only
+  void processUploads(int64_t budgetNanos = DEFAULT_UPLOAD_BUDGET);
+  // Render thread only, blocks until everything queued so far is loaded
+  void finish();
+
+  // Loads that haven't been uploaded yet
+  size_t getPendingCount() const {
+    return pending;
+  }
+
+  bool isIdle() const {
+    return 0 == pending;
+  }
+
+private:
+  struct Task {
+    std::string name;
+    Lambda work;
+  };
+
+  AssetLoader();
+  ~AssetLoader();
+  void startWorkers();
+  void enqueueDecode(const std::string & name, Lambda work);
+  void enqueueUpload(const std::string & name, Lambda work);
+  void completed();
+  void workerLoop();
+  bool runUpload();
+
+  template <typename T>
+  static void fulfil(std::promise<T> & promise, const std::function<T()> & upload) {
+    promise.set_value(upload());
+  }
+
+  static void fulfil(std::promise<void> & promise, const std::function<void()> & upload) {
+    upload();
+    promise.set_value();
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable decodeReady;
+  std::condition_variable uploadReady;
+  std::queue<Task> decodes;
+  std::queue<Task> uploads;
+  std::atomic<size_t> pending{ 0 };
+  bool stopping{ false };
+};
@@ -29,6 +29,7 @@ namespace Text {
 const float Font::DTP_TO_METERS = 0.003528f;
 const float Font::METERS_TO_DTP = 1.0f / Font::DTP_TO_METERS;
 static ProgramPtr TEXT_PROGRAM;
+static UniformHandle<vec4> TEXT_COLOR;
 
 Font::Font(void)
     : mFamily("Unknown"), mFontSize(12.0f), mLeading(0.0f), mAscent(0.0f), mDescent(
@@ -38,17 +39,8 @@ Font::Font(void)
 Font::~Font(void) {
 }
 
-struct TextureVertex {
-  glm::vec4 pos;
-  glm::vec4 tex;
-  TextureVertex() {
-  }
-  TextureVertex(const glm::vec2 & pos, const glm::vec2 & tex)
-      : pos(pos, 0, 0), tex(tex, 0, 0) {
-  }
-};
-
 struct QuadBuilder {
+  typedef Font::TextureVertex TextureVertex;
   TextureVertex vertices[4];
   QuadBuilder(const rectf & r, const rectf & tr) {
     vertices[0] = TextureVertex(r.getLowerLeft(), tr.getUpperLeft());
@@ -58,17 +50,14 @@ struct QuadBuilder {
   }
 };
 
-void readPngToTexture(const char * data, size_t size,  TexturePtr & texture, glm::vec2 & textureSize) {
-  using namespace oglplus;
-  std::vector<uint8_t> pngData(size);
-  memcpy(&pngData[0], data, size);
-  ImagePtr image = oria::loadImage(pngData);
-  textureSize = glm::vec2(image->Width(), image->Height());
-  texture = oria::load2dTextureFromPngData(pngData);
+void Font::read(const void * data, size_t size) {
+  decode(data, size);
+  upload();
 }
 
-void Font::read(const void * data, size_t size) {
-  std::istringstream in(std::string(static_cast<const char*>(data), size));
+void Font::decode(const void * data, size_t size) {
+  ResourceView view(data, size);
+  ResourceStream in(view);
 //  SignedDistanceFontFile sdff;
 //  sdff.read(in);
 
@@ -119,11 +108,13 @@ void Font::read(const void * data, size_t size) {
   }
 
   // read image data
-  readPngToTexture((const char *) data + in.tellg(), size - in.tellg(),
-      mTexture, mTextureSize);
+  mPendingImage = oria::loadImage(view.subView((size_t)in.tellg()));
+  mTextureSize = glm::vec2(mPendingImage->Width(), mPendingImage->Height());
 
-  std::vector<TextureVertex> vertexData;
-  std::vector<GLuint> indexData;
+  std::vector<TextureVertex> & vertexData = mPendingVertices;
+  std::vector<GLuint> & indexData = mPendingIndices;
+  vertexData.clear();
+  indexData.clear();
   int characters = 0;
   std::for_each(mMetrics.begin(), mMetrics.end(),
       [&] ( MetricsData::reference & md ) {
@@ -145,19 +136,36 @@ void Font::read(const void * data, size_t size) {
         indexData.push_back(index + 2);
         indexData.push_back(index + 3);
       });
+}
 
+void Font::upload() {
+  if (!mPendingImage) {
+    FAIL("Font has no decoded data to upload");
+  }
 
   if (!TEXT_PROGRAM) {
     TEXT_PROGRAM = oria::loadProgram(
       Resource::SHADERS_TEXT_VS,
       Resource::SHADERS_TEXT_FS);
+    TEXT_COLOR = UniformHandle<vec4>(TEXT_PROGRAM, "Color");
 
     Platform::addShutdownHook([&]{
       TEXT_PROGRAM.reset();
+      TEXT_COLOR = UniformHandle<vec4>();
     });
   }
 
   using namespace oglplus;
+  mTexture = TexturePtr(new Texture());
+  Context::Bound(TextureTarget::_2D, *mTexture)
+    .MagFilter(TextureMagFilter::Linear)
+    .MinFilter(TextureMinFilter::Linear);
+  uvec2 imageSize(mPendingImage->Width(), mPendingImage->Height());
+  TextureStreamer::allocate(GL_TEXTURE_2D, 1, (GLenum)mPendingImage->InternalFormat(), imageSize);
+  TextureStreamer::instance().subImage2D(GL_TEXTURE_2D, 0, imageSize,
+    (GLenum)mPendingImage->Format(), (GLenum)mPendingImage->Type(), mPendingImage->RawData());
+  DefaultTexture().Bind(TextureTarget::_2D);
+
   mVao = VertexArrayPtr(new VertexArray());
   mVao->Bind();
   BufferPtr vertexBuffer;
@@ -169,11 +177,11 @@ void Font::read(const void * data, size_t size) {
 
   vertexBuffer = BufferPtr(new Buffer());
   vertexBuffer->Bind(Buffer::Target::Array);
-  Buffer::Data(Buffer::Target::Array, vertexData);
+  Buffer::Data(Buffer::Target::Array, mPendingVertices);
 
   indexBuffer = BufferPtr(new Buffer());
   indexBuffer->Bind(Buffer::Target::ElementArray);
-  Buffer::Data(Buffer::Target::ElementArray, indexData);
+  Buffer::Data(Buffer::Target::ElementArray, mPendingIndices);
 
   GLsizei stride = (GLsizei)sizeof(TextureVertex);
   void* offset = (void*)offsetof(TextureVertex, tex);
@@ -187,6 +195,11 @@ void Font::read(const void * data, size_t size) {
     .Enable();
 
   NoVertexArray().Bind();
+
+  // The GL objects own everything from here on
+  mPendingImage.reset();
+  mPendingVertices = std::vector<TextureVertex>();
+  mPendingIndices = std::vector<GLuint>();
 }
 
 Font::Metrics Font::getMetrics(uint16_t charcode) const {
@@ -280,6 +293,8 @@ void Font::renderString(
     glm::vec2 & cursor,
     float fontSize,
     float maxWidth) {
+  PROFILE_ZONE("Font::renderString");
+  GPU_ZONE("text");
   float scale = Text::Font::DTP_TO_METERS * fontSize / mFontSize;
   bool wrap = (maxWidth == maxWidth);
   if (wrap) {
@@ -295,9 +310,16 @@ void Font::renderString(
 
   using namespace oglplus;
   TEXT_PROGRAM->Use();
-  Uniform<vec4>(*TEXT_PROGRAM, "Color").Set(vec4(1));
+  UniformTable::Pointer uniforms = UniformTable::forProgram(TEXT_PROGRAM);
+  if (uniforms->hasFrameBlock()) {
+    FrameUniforms::instance().sync();
+  } else {
+    Mat4Handle(uniforms, uniforms->getProjection()).set(Stacks::projection().top());
+  }
+  TEXT_COLOR.set(vec4(1));
   //  Uniform<int>(*program, "Font").Set(0);
-  Mat4Uniform(*TEXT_PROGRAM, "Projection").Set(Stacks::projection().top());
+  // Set once per glyph
+  Mat4Handle modelView(uniforms, uniforms->getModelView());
 
   mTexture->Bind(Texture::Target::_2D);
   mVao->Bind();
@@ -343,7 +365,7 @@ void Font::renderString(
         // Bind the new position
         mv.withPush([&]{
           mv.translate(offset);
-          Mat4Uniform(*TEXT_PROGRAM, "ModelView").Set(mv.top());
+          modelView.set(mv.top());
           // Render the item
           glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(m.indexOffset * sizeof(GLuint)));
         });
@@ -47,6 +47,17 @@ public:
   };
 
   typedef std::unordered_map<uint16_t, Metrics> MetricsData;
+
+  struct TextureVertex {
+    glm::vec4 pos;
+    glm::vec4 tex;
+    TextureVertex() {
+    }
+    TextureVertex(const glm::vec2 & pos, const glm::vec2 & tex)
+        : pos(pos, 0, 0), tex(tex, 0, 0) {
+    }
+  };
+
   public:
   Font();
   virtual ~Font();
@@ -54,6 +65,13 @@ public:
   //! reads a binary font file created using 'writeBinary'
   void read(const void * data, size_t size);
 
+  //! the CPU half of 'read', safe to call off the render thread
+  void decode(const void * data, size_t size);
+
+  //! the GL half of 'read', creates the texture and buffers from the
+  //! decoded data
+  void upload();
+
   //!
   const std::string & getFamily() const {
     return mFamily;
@@ -148,6 +166,11 @@ public:
   glm::vec2 mTextureSize;
 
   MetricsData mMetrics;
+
+  //! decoded by 'decode', released by 'upload'
+  ImagePtr mPendingImage;
+  std::vector<TextureVertex> mPendingVertices;
+  std::vector<GLuint> mPendingIndices;
 };
 
 typedef std::shared_ptr<Font> FontPtr;
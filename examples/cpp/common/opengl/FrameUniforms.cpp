@@ -0,0 +1,161 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const GLuint FrameUniforms::BINDING;
+const int FrameUniforms::MAX_LIGHTS;
+const size_t FrameUniforms::RING_SLOTS;
+const char * const FrameUniforms::BLOCK_NAME = "Frame";
+const char * const FrameUniforms::DECLARATION =
+  "layout(std140) uniform Frame {\n"
+  "  mat4 Projection;\n"
+  "  mat4 View;\n"
+  "  vec4 EyePosition;\n"
+  "  vec4 Ambient;\n"
+  "  int LightCount;\n"
+  "  vec4 LightPosition[8];\n"
+  "  vec4 LightColor[8];\n"
+  "};\n";
+
+// The loose uniforms the block replaces, and the types they need to have
+static const struct {
+  const char * name;
+  const char * type;
+  bool array;
+} MEMBERS[] = {
+  { "Projection", "mat4", false },
+  { "Ambient", "vec4", false },
+  { "LightCount", "int", false },
+  { "LightPosition", "vec4", true },
+  { "LightColor", "vec4", true },
+};
+
+// Index into MEMBERS of the uniform a line declares, -1 for other lines and
+// -2 for a member declared with the wrong type
+static int declaredMember(const std::string & line) {
+  std::istringstream tokens(line);
+  std::string keyword, type, name;
+  if (!(tokens >> keyword >> type >> name) || "uniform" != keyword) {
+    return -1;
+  }
+  size_t end = name.find_first_of("[=;,");
+  bool array = std::string::npos != end && '[' == name[end];
+  // Several names in one declaration can't be taken apart line by line
+  bool list = std::string::npos != line.find(',');
+  name = name.substr(0, end);
+  for (int i = 0; i < (int)(sizeof(MEMBERS) / sizeof(MEMBERS[0])); ++i) {
+    if (name == MEMBERS[i].name) {
+      return !list && type == MEMBERS[i].type && array == MEMBERS[i].array ? i : -2;
+    }
+  }
+  return -1;
+}
+
+std::string FrameUniforms::promote(const std::string & source) {
+  if (std::string::npos != source.find(std::string("uniform ") + BLOCK_NAME)) {
+    return source;
+  }
+  // On one line, so that the lines after it keep their numbers
+  std::string declaration = DECLARATION;
+  std::replace(declaration.begin(), declaration.end(), '\n', ' ');
+
+  std::istringstream in(source);
+  std::string line, result;
+  bool declared = false;
+  while (std::getline(in, line)) {
+    int member = declaredMember(line);
+    if (-2 == member) {
+      return source;
+    }
+    if (member >= 0) {
+      if (!declared) {
+        result += declaration;
+        declared = true;
+      }
+      result += "\n";
+    } else {
+      result += line + "\n";
+    }
+  }
+  return declared ? result : source;
+}
+
+FrameUniforms::FrameUniforms() {
+  memset(&staging, 0, sizeof(staging));
+  memset(&current, 0, sizeof(current));
+  staging.projection = mat4();
+  staging.view = mat4();
+  staging.eyePosition = vec4(0, 0, 0, 1);
+}
+
+FrameUniforms & FrameUniforms::instance() {
+  static FrameUniforms INSTANCE;
+  static bool registeredShutdown = false;
+  if (!registeredShutdown) {
+    Platform::addShutdownHook([&] {
+      if (INSTANCE.buffer) {
+        glDeleteBuffers(1, &INSTANCE.buffer);
+        INSTANCE.buffer = 0;
+      }
+      INSTANCE.written = false;
+    });
+    registeredShutdown = true;
+  }
+  return INSTANCE;
+}
+
+void FrameUniforms::setView(const mat4 & view) {
+  staging.view = view;
+  staging.eyePosition = glm::inverse(view)[3];
+}
+
+void FrameUniforms::sync() {
+  staging.projection = Stacks::projection().top();
+  const Lights & lights = Stacks::lights();
+  staging.ambient = lights.ambient;
+  staging.lightCount = std::min((int)lights.lightPositions.size(), MAX_LIGHTS);
+  for (int i = 0; i < staging.lightCount; ++i) {
+    staging.lightPositions[i] = lights.lightPositions[i];
+    staging.lightColors[i] = lights.lightColors[i];
+  }
+  if (!written || memcmp(&staging, &current, sizeof(Block))) {
+    upload();
+  }
+}
+
+void FrameUniforms::upload() {
+  if (!buffer) {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    slotSize = ((sizeof(Block) + alignment - 1) / alignment) * alignment;
+    glGenBuffers(1, &buffer);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  if (++slot >= RING_SLOTS) {
+    // Orphan the storage rather than overwrite slots still in flight
+    glBufferData(GL_UNIFORM_BUFFER, slotSize * RING_SLOTS, nullptr, GL_STREAM_DRAW);
+    slot = 0;
+  }
+  glBufferSubData(GL_UNIFORM_BUFFER, slotSize * slot, sizeof(Block), &staging);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, buffer, slotSize * slot, sizeof(Block));
+  current = staging;
+  written = true;
+  ++uploads;
+}
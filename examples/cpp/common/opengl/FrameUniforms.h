@@ -0,0 +1,91 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Camera and light state shared by every program through one std140
+ * uniform block, instead of loose uniforms uploaded on every draw.
+ *
+ * A program opts in by declaring the block, DECLARATION below, in place of
+ * its Projection, Ambient, LightCount, LightPosition and LightColor
+ * uniforms.  Members of an unnamed block share the global namespace, so
+ * the rest of the shader reads them by the same names as before.  The
+ * built-in shaders still declare the loose uniforms, so oria::loadProgram
+ * swaps them for the block with promote() as it loads them.  Programs
+ * declaring it are bound to BINDING when their UniformTable is built, and
+ * renderGeometry and bindLights leave those uniforms alone for them,
+ * uploading only ModelView per draw.
+ *
+ * The block is written when a program using it is drawn and the
+ * projection, view or lights differ from the copy the GPU already has,
+ * which in practice is once per eye.  Each write goes to a fresh slot of a
+ * ring buffer, so the GPU never waits on a slot still being read.  Must
+ * only be used from the thread owning the GL context.
+ */
+class FrameUniforms {
+public:
+  static const GLuint BINDING = 0;
+  static const int MAX_LIGHTS = 8;
+  static const size_t RING_SLOTS = 64;
+  static const char * const BLOCK_NAME;
+  static const char * const DECLARATION;
+
+  // Matches the std140 layout of DECLARATION
+  struct Block {
+    mat4 projection;
+    mat4 view;
+    vec4 eyePosition;
+    vec4 ambient;
+    GLint lightCount;
+    GLint padding[3];
+    vec4 lightPositions[MAX_LIGHTS];
+    vec4 lightColors[MAX_LIGHTS];
+  };
+
+  static FrameUniforms & instance();
+
+  // The source with its loose uniforms that the block holds replaced by
+  // the block, keeping the line numbers.  Sources already declaring it,
+  // or declaring one of those names with another type, come back as is.
+  static std::string promote(const std::string & source);
+
+  // The camera transform for the eye about to be rendered, from which the
+  // eye position is also derived.  Call once per eye after applying the
+  // head pose.
+  void setView(const mat4 & view);
+  // Brings the block up to date with the projection stack and the lights
+  // and binds it
+  void sync();
+
+  size_t getUploads() const {
+    return uploads;
+  }
+
+private:
+  FrameUniforms();
+  void upload();
+
+  GLuint buffer{ 0 };
+  GLsizeiptr slotSize{ 0 };
+  size_t slot{ RING_SLOTS };
+  size_t uploads{ 0 };
+  bool written{ false };
+  Block staging;
+  Block current;
+};
@@ -20,7 +20,6 @@
 #include "Common.h"
 
 #include "Font.h"
-#include <openctmpp.h>
 #pragma warning( disable : 4068 4244 4267 4065 4101 4244)
 #include <oglplus/bound/buffer.hpp>
 #include <oglplus/shapes/cube.hpp>
@@ -32,285 +31,6 @@
 #include <oglplus/shapes/grid.hpp>
 #include <oglplus/shapes/vector.hpp>
 #include <oglplus/opt/list_init.hpp>
-#include <oglplus/shapes/obj_mesh.hpp>
-
-namespace oglplus {
-  namespace shapes {
-
-    /// Class providing attributes and instructions for drawing of mesh loaded from obj
-    class CtmMesh
-      : public DrawingInstructionWriter
-      , public DrawMode
-    {
-    public:
-      typedef std::vector<GLuint> IndexArray;
-
-    private:
-      struct _loading_options
-      {
-        bool load_normals;
-        bool load_tangents;
-        bool load_bitangents;
-        bool load_texcoords;
-        bool load_materials;
-
-        _loading_options(bool load_all = true)
-        {
-          All(load_all);
-        }
-
-        _loading_options& All(bool load_all = true)
-        {
-          load_normals = load_all;
-          load_tangents = load_all;
-          load_bitangents = load_all;
-          load_texcoords = load_all;
-          load_materials = load_all;
-          return *this;
-        }
-
-        _loading_options& Nothing(void)
-        {
-          return All(false);
-        }
-
-        _loading_options& Normals(bool load = true)
-        {
-          load_normals = load;
-          return *this;
-        }
-
-        _loading_options& Tangents(bool load = true)
-        {
-          load_tangents = load;
-          return *this;
-        }
-
-        _loading_options& Bitangents(bool load = true)
-        {
-          load_bitangents = load;
-          return *this;
-        }
-
-        _loading_options& TexCoords(bool load = true)
-        {
-          load_texcoords = load;
-          return *this;
-        }
-
-        _loading_options& Materials(bool load = true)
-        {
-          load_materials = load;
-          return *this;
-        }
-      };
-
-      /// The type of the index container returned by Indices()
-      // vertex positions
-      std::vector<float> _pos_data;
-      // vertex normals
-      std::vector<float> _nml_data;
-      // vertex tex coords
-      std::vector<float> _tex_data;
-      IndexArray _idx_data;
-      unsigned int _prim_count;
-
-
-      struct _vert_indices
-      {
-        GLuint _pos;
-        GLuint _nml;
-        GLuint _tex;
-        GLuint _mtl;
-
-        _vert_indices(void)
-          : _pos(0)
-          , _nml(0)
-          , _tex(0)
-          , _mtl(0)
-        { }
-      };
-
-      bool _load_index(
-        GLuint& value,
-        GLuint count,
-        std::string::const_iterator& i,
-        std::string::const_iterator& e
-        );
-
-      void _call_load_meshes(
-        Resource resource,
-        aux::AnyInputIter<const char*> names_begin,
-        aux::AnyInputIter<const char*> names_end,
-        _loading_options opts
-        ) {
-
-        CTMimporter importer;
-        importer.LoadData(Platform::getResourceString(resource));
-        int vertexCount = importer.GetInteger(CTM_VERTEX_COUNT);
-        {
-          const float * ctmData = importer.GetFloatArray(CTM_VERTICES);
-          _pos_data = std::vector<float>(ctmData, ctmData + (vertexCount * 3));
-        }
-
-        if (opts.load_texcoords && importer.GetInteger(CTM_UV_MAP_COUNT)) {
-          const float * ctmData = importer.GetFloatArray(CTM_UV_MAP_1);
-          _tex_data = std::vector<float>(ctmData, ctmData + (vertexCount * 2));
-        }
-
-        if (opts.load_normals && importer.GetInteger(CTM_HAS_NORMALS)) {
-          const float * ctmData = importer.GetFloatArray(CTM_NORMALS);
-          _nml_data = std::vector<float>(ctmData, ctmData + (vertexCount * 3));
-        }
-
-        {
-          _prim_count = importer.GetInteger(CTM_TRIANGLE_COUNT);
-          int indexCount = 3 * _prim_count;
-          const CTMuint * ctmIntData = importer.GetIntegerArray(CTM_INDICES);
-          _idx_data = IndexArray(ctmIntData, ctmIntData + indexCount);
-        }
-      }
-
-    public:
-      typedef _loading_options LoadingOptions;
-
-      CtmMesh(
-        Resource resource,
-        LoadingOptions opts = LoadingOptions()
-        )
-      {
-        const char** p = nullptr;
-        _call_load_meshes(resource, p, p, opts);
-      }
-
-      /// Returns the winding direction of faces
-      FaceOrientation FaceWinding(void) const
-      {
-        return FaceOrientation::CCW;
-      }
-
-      typedef GLuint(CtmMesh::*VertexAttribFunc)(std::vector<GLfloat>&) const;
-
-      /// Makes the vertex positions and returns the number of values per vertex
-      template <typename T>
-      GLuint Positions(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _pos_data.begin(), _pos_data.end());
-        return 3;
-      }
-
-      /// Makes the vertex normals and returns the number of values per vertex
-      template <typename T>
-      GLuint Normals(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _nml_data.begin(), _nml_data.end());
-        return 3;
-      }
-
-      /// Makes the vertex tangents and returns the number of values per vertex
-      template <typename T>
-      GLuint Tangents(std::vector<T>& dest) const
-      {
-        dest.clear();
-        return 3;
-      }
-
-      /// Makes the vertex bi-tangents and returns the number of values per vertex
-      template <typename T>
-      GLuint Bitangents(std::vector<T>& dest) const
-      {
-        dest.clear();
-        return 3;
-      }
-
-      /// Makes the texture coordinates returns the number of values per vertex
-      template <typename T>
-      GLuint TexCoordinates(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _tex_data.begin(), _tex_data.end());
-        return 2;
-      }
-
-      typedef VertexAttribsInfo<
-        CtmMesh,
-        std::tuple<
-        VertexPositionsTag,
-        VertexNormalsTag,
-        VertexTangentsTag,
-        VertexBitangentsTag,
-        VertexTexCoordinatesTag
-        >
-      > VertexAttribs;
-
-      Spheref MakeBoundingSphere(void) const {
-          GLfloat min_x = _pos_data[3], max_x = _pos_data[3];
-          GLfloat min_y = _pos_data[4], max_y = _pos_data[4];
-          GLfloat min_z = _pos_data[5], max_z = _pos_data[5];
-          for (std::size_t v = 0, vn = _pos_data.size() / 3; v != vn; ++v)
-          {
-            GLfloat x = _pos_data[v * 3 + 0];
-            GLfloat y = _pos_data[v * 3 + 1];
-            GLfloat z = _pos_data[v * 3 + 2];
-
-            if (min_x > x) min_x = x;
-            if (min_y > y) min_y = y;
-            if (min_z > z) min_z = z;
-            if (max_x < x) max_x = x;
-            if (max_y < y) max_y = y;
-            if (max_z < z) max_z = z;
-          }
-
-          Vec3f c(
-            (min_x + max_x) * 0.5f,
-            (min_y + max_y) * 0.5f,
-            (min_z + max_z) * 0.5f
-            );
-
-          return Spheref(
-            c.x(), c.y(), c.z(),
-            Distance(c, Vec3f(min_x, min_y, min_z))
-            );
-      }
-
-      /// Queries the bounding sphere coordinates and dimensions
-      template <typename T>
-      void BoundingSphere(oglplus::Sphere<T>& bounding_sphere) const
-      {
-        bounding_sphere = oglplus::Sphere<T>(MakeBoundingSphere());
-      }
-
-
-      /// Returns element indices that are used with the drawing instructions
-      const IndexArray & Indices(Default = Default()) const
-      {
-        return _idx_data;
-      }
-
-      /// Returns the instructions for rendering of faces
-      DrawingInstructions Instructions(PrimitiveType primitive) const {
-        DrawingInstructions instr = this->MakeInstructions();
-        DrawOperation operation;
-        operation.method = DrawOperation::Method::DrawElements;
-        operation.mode = primitive;
-        operation.first = 0;
-        operation.count = _prim_count * 3;
-        operation.restart_index = DrawOperation::NoRestartIndex();
-        operation.phase = 0;
-        this->AddInstruction(instr, operation);
-        return std::move(instr);
-      }
-
-      /// Returns the instructions for rendering of faces
-      DrawingInstructions Instructions(Default = Default()) const
-      {
-        return Instructions(PrimitiveType::Triangles);
-      }
-    };
-  } // shapes
-} // oglplus
 
 #pragma warning( default : 4068 4244 4267 4065 4101)
 
@@ -323,17 +43,32 @@ namespace oria {
     return wide;
   }
 
+  typedef std::map<Resource, Text::FontPtr> FontMap;
+
+  FontMap & getFontMap() {
+    static FontMap fonts;
+    return fonts;
+  }
+
   Text::FontPtr getFont(Resource fontName) {
-    static std::map<Resource, Text::FontPtr> fonts;
+    FontMap & fonts = getFontMap();
     if (fonts.find(fontName) == fonts.end()) {
-      std::string fontData = Platform::getResourceString(fontName);
+      ResourceView fontData = Platform::getResourceView(fontName);
       Text::FontPtr result(new Text::Font());
-      result->read((const void*)fontData.data(), fontData.size());
+      result->read(fontData.data(), fontData.size());
       fonts[fontName] = result;
     }
     return fonts[fontName];
   }
 
+  Text::FontPtr getFont(Resource fontName, const Text::FontPtr & loaded) {
+    FontMap & fonts = getFontMap();
+    if (fonts.find(fontName) == fonts.end()) {
+      fonts[fontName] = loaded;
+    }
+    return fonts[fontName];
+  }
+
   Text::FontPtr getDefaultFont() {
     return getFont(Resource::FONTS_INCONSOLATA_MEDIUM_SDFF);
   }
@@ -354,31 +89,51 @@ namespace oria {
 
   void bindLights(ProgramPtr & program) {
     using namespace oglplus;
+    UniformTable::Pointer table = UniformTable::forProgram(program);
+    if (table->hasFrameBlock()) {
+      // Already in the block, see renderGeometry
+      return;
+    }
     Lights & lights = Stacks::lights();
+    const UniformTable::LightSlots & slots = table->getLights();
     int count = (int)lights.lightPositions.size();
-    Uniform<vec4>(*program, "Ambient").Set(lights.ambient);
-    Uniform<int>(*program, "LightCount").Set(count);
+    UniformHandle<vec4>(table, slots.ambient).set(lights.ambient);
+    UniformHandle<GLint>(table, slots.count).set(count);
     if (count) {
-      Uniform<Vec4f>(*program, "LightColor[0]").SetValues(count, (Vec4f*)&lights.lightColors.at(0).r);
-      Uniform<Vec4f>(*program, "LightPosition[0]").SetValues(count, (Vec4f*)&lights.lightPositions.at(0).x);
+      UniformHandle<vec4>(table, slots.colors).setValues(count, &lights.lightColors.at(0));
+      UniformHandle<vec4>(table, slots.positions).setValues(count, &lights.lightPositions.at(0));
     }
   }
 
   typedef std::function<void()> Lambda;
   typedef std::list<Lambda> LambdaList;
-  template <typename Iter>
-  void renderGeometryWithLambdas(ShapeWrapperPtr & shape, ProgramPtr & program, Iter begin, const Iter & end) {
+  void drawShape(ShapeWrapperPtr & shape) {
+    shape->Use();
+    shape->Draw();
+  }
+
+  void drawShape(MeshPtr & mesh) {
+    mesh->bind();
+    mesh->draw(LodSelector::instance().select(*mesh));
+  }
+
+  template <typename Shape, typename Iter>
+  void renderGeometryWithLambdas(Shape & shape, ProgramPtr & program, Iter begin, const Iter & end) {
     program->Use();
 
-    Mat4Uniform(*program, "ModelView").Set(Stacks::modelview().top());
-    Mat4Uniform(*program, "Projection").Set(Stacks::projection().top());
+    UniformTable::Pointer table = UniformTable::forProgram(program);
+    if (table->hasFrameBlock()) {
+      FrameUniforms::instance().sync();
+    } else {
+      Mat4Handle(table, table->getProjection()).set(Stacks::projection().top());
+    }
+    Mat4Handle(table, table->getModelView()).set(Stacks::modelview().top());
 
     std::for_each(begin, end, [&](const std::function<void()>&f){
       f();
     });
 
-    shape->Use();
-    shape->Draw();
+    drawShape(shape);
 
     oglplus::NoProgram().Bind();
     oglplus::NoVertexArray().Bind();
@@ -397,22 +152,38 @@ namespace oria {
     renderGeometryWithLambdas(shape, program, EMPTY_LIST.begin(), EMPTY_LIST.end());
   }
 
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program, std::function<void()> lambda) {
+    renderGeometry(mesh, program, LambdaList({ lambda }));
+  }
+
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program, const std::list<std::function<void()>> & list) {
+    renderGeometryWithLambdas(mesh, program, list.begin(), list.end());
+  }
+
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program) {
+    static const std::list<std::function<void()>> EMPTY_LIST;
+    renderGeometryWithLambdas(mesh, program, EMPTY_LIST.begin(), EMPTY_LIST.end());
+  }
+
 
   void renderCube(const glm::vec3 & color) {
     using namespace oglplus;
 
     static ProgramPtr program;
     static ShapeWrapperPtr shape;
+    static UniformHandle<vec4> colorUniform;
     if (!program) {
       program = loadProgram(Resource::SHADERS_SIMPLE_VS, Resource::SHADERS_COLORED_FS);
       shape = ShapeWrapperPtr(new shapes::ShapeWrapper(List("Position").Get(), shapes::Cube(), *program));
+      colorUniform = UniformHandle<vec4>(program, "Color");
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
+        colorUniform = UniformHandle<vec4>();
       });
     }
     program->Use();
-    Uniform<vec4>(*program, "Color").Set(vec4(color, 1));
+    colorUniform.set(vec4(color, 1));
     renderGeometry(shape, program);
   }
 
@@ -459,6 +230,7 @@ namespace oria {
   }
 
   void renderSkybox(Resource firstImageResource) {
+    GPU_ZONE("skybox");
     using namespace oglplus;
 
     static ProgramPtr program;
@@ -490,48 +262,87 @@ namespace oria {
     const float SIZE = 100;
     static ProgramPtr program;
     static ShapeWrapperPtr shape;
-    static TexturePtr texture;
+    static UniformHandle<vec2> uvMultiplier;
     if (!program) {
       program = loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
       shape = ShapeWrapperPtr(new shapes::ShapeWrapper(List("Position")("TexCoord").Get(), shapes::Plane(), *program));
-      texture = load2dTexture(Resource::IMAGES_FLOOR_PNG);
-      Context::Bound(TextureTarget::_2D, *texture).MinFilter(TextureMinFilter::LinearMipmapNearest).GenerateMipmap();
+      uvMultiplier = UniformHandle<vec2>(program, "UvMultiplier");
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
-        texture.reset();
+        uvMultiplier = UniformHandle<vec2>();
       });
     }
 
+    // Asked for every frame, like the skybox, so holding it doesn't keep it
+    // from being evicted while the floor isn't drawn
+    uvec2 size;
+    TexturePtr texture = load2dTexture(Resource::IMAGES_FLOOR_PNG, size, true);
     texture->Bind(TextureTarget::_2D);
     MatrixStack & mv = Stacks::modelview();
     mv.withPush([&]{
       mv.scale(vec3(SIZE));
       renderGeometry(shape, program, [&]{
-        oglplus::Uniform<vec2>(*program, "UvMultiplier").Set(vec2(SIZE * 2.0f));
+        uvMultiplier.set(vec2(SIZE * 2.0f));
       });
     });
 
     DefaultTexture().Bind(TextureTarget::_2D);
   }
 
-  ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource) {
-    using namespace oglplus;
-    return ShapeWrapperPtr(new shapes::ShapeWrapper(names, shapes::CtmMesh(resource)));
+  // Meshes decoded by prepareMesh, waiting to be picked up by the render
+  // thread
+  class PreparedMeshes {
+    std::mutex mutex;
+    std::map<Resource, MeshDataPtr> meshes;
+
+  public:
+    static PreparedMeshes & instance() {
+      static PreparedMeshes prepared;
+      return prepared;
+    }
+
+    void put(Resource resource, const MeshDataPtr & mesh) {
+      std::lock_guard<std::mutex> guard(mutex);
+      meshes[resource] = mesh;
+    }
+
+    // Hands over the prepared mesh, or loads it now if there isn't one
+    MeshDataPtr take(Resource resource) {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto itr = meshes.find(resource);
+        if (itr != meshes.end()) {
+          MeshDataPtr result = itr->second;
+          meshes.erase(itr);
+          return result;
+        }
+      }
+      return decode(resource);
+    }
+
+    static MeshDataPtr decode(Resource resource) {
+      PROFILE_ZONE("decodeMesh", Resources::getResourcePath(resource));
+      return MeshData::load(resource);
+    }
+  };
+
+  void prepareMesh(Resource resource) {
+    PreparedMeshes::instance().put(resource, PreparedMeshes::decode(resource));
   }
 
-  ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program) {
-    using namespace oglplus;
-    return ShapeWrapperPtr(new shapes::ShapeWrapper(names, shapes::CtmMesh(resource), *program));
+  MeshPtr loadMesh(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program) {
+    MeshDataPtr data = PreparedMeshes::instance().take(resource);
+    return MeshPtr(new Mesh(*data, names, program));
   }
 
   void renderManikin() {
     static ProgramPtr program;
-    static ShapeWrapperPtr shape;
+    static MeshPtr shape;
 
     if (!program) {
       program = loadProgram(Resource::SHADERS_LIT_VS, Resource::SHADERS_LITCOLORED_FS);
-      shape = loadShape({ "Position", "Normal" }, Resource::MESHES_MANIKIN_CTM, program);
+      shape = loadMesh({ "Position", "Normal" }, Resource::MESHES_MANIKIN_CTM, program);
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
@@ -547,22 +358,25 @@ namespace oria {
   void renderRift(float alpha) {
     using namespace oglplus;
     static ProgramPtr program;
-    static ShapeWrapperPtr shape;
+    static MeshPtr shape;
+    static UniformHandle<GLfloat> forceAlpha;
     if (!program) {
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
+        forceAlpha = UniformHandle<GLfloat>();
       });
 
       program = loadProgram(Resource::SHADERS_LIT_VS, Resource::SHADERS_LITCOLORED_FS);
-      shape = ::oria::loadShape({ "Position", "Normal" }, Resource::MESHES_RIFT_CTM, program);
+      shape = loadMesh({ "Position", "Normal" }, Resource::MESHES_RIFT_CTM, program);
+      forceAlpha = UniformHandle<GLfloat>(program, "ForceAlpha");
     }
 
     auto & mv = Stacks::modelview();
     mv.withPush([&]{
       mv.rotate(-HALF_PI - 0.22f, Vectors::X_AXIS).scale(0.5f);
       renderGeometry(shape, program, [&] {
-        Uniform<float>(*program, "ForceAlpha").Set(alpha);
+        forceAlpha.set(alpha);
         oria::bindLights(program);
       });
     });
@@ -571,32 +385,35 @@ namespace oria {
   void renderArtificialHorizon(float alpha) {
     using namespace oglplus;
     static ProgramPtr program;
-    static ShapeWrapperPtr shape;
-    static std::vector<Vec4f> materials = {
-        Vec4f(0.351366f, 0.665379f, 0.800000f, 1),
-        Vec4f(0.640000f, 0.179600f, 0.000000f, 1),
-        Vec4f(0.000000f, 0.000000f, 0.000000f, 1),
-        Vec4f(0.171229f, 0.171229f, 0.171229f, 1),
-        Vec4f(0.640000f, 0.640000f, 0.640000f, 1)
-    };
+    static MeshPtr shape;
+    static UniformHandle<GLfloat> forceAlpha;
 
     if (!program) {
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
+        forceAlpha = UniformHandle<GLfloat>();
       });
 
       program = loadProgram(Resource::SHADERS_LITMATERIALS_VS, Resource::SHADERS_LITCOLORED_FS);
-      std::stringstream && stream = Platform::getResourceStream(Resource::MESHES_ARTIFICIAL_HORIZON_OBJ);
-      shapes::ObjMesh mesh(stream);
-      shape = ShapeWrapperPtr(new shapes::ShapeWrapper({ "Position", "Normal", "Material" }, mesh, *program));
-      Uniform<Vec4f>(*program, "Materials[0]").Set(materials);
+      forceAlpha = UniformHandle<GLfloat>(program, "ForceAlpha");
+      shape = loadMesh({ "Position", "Normal", "Material" }, Resource::MESHES_ARTIFICIAL_HORIZON_OBJ, program);
+      // The colors come from the mesh's own material library
+      std::vector<vec4> materials;
+      for (const MeshData::Material & material : shape->getMaterials()) {
+        materials.push_back(material.diffuse);
+      }
+      if (!materials.empty()) {
+        program->Use();
+        UniformHandle<vec4>(program, "Materials").setValues((GLsizei)materials.size(), materials.data());
+        oglplus::NoProgram().Use();
+      }
     }
 
     auto & mv = Stacks::modelview();
     mv.withPush([&]{
       renderGeometry(shape, program, [&]{
-        Uniform<float>(*program, "ForceAlpha").Set(alpha);
+        forceAlpha.set(alpha);
         oria::bindLights(program);
       });
     });
@@ -23,20 +23,34 @@ typedef std::shared_ptr<oglplus::shapes::ShapeWrapper> ShapeWrapperPtr;
 typedef std::shared_ptr<oglplus::Buffer> BufferPtr;
 typedef std::shared_ptr<oglplus::VertexArray> VertexArrayPtr;
 
+namespace Text {
+  class Font;
+  typedef std::shared_ptr<Font> FontPtr;
+}
+
 namespace oria {
   inline void viewport(const uvec2 & size) {
     oglplus::Context::Viewport(0, 0, size.x, size.y);
   }
 
-  ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program);
+  // A CTM or OBJ mesh, see Mesh for the attribute names
+  MeshPtr loadMesh(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program);
   ShapeWrapperPtr loadSphere(const std::initializer_list<const GLchar*>& names, ProgramPtr program);
   ShapeWrapperPtr loadSkybox(ProgramPtr program);
   ShapeWrapperPtr loadPlane(ProgramPtr program, float aspect);
   void bindLights(ProgramPtr & program);
 
+  // Decodes a CTM or OBJ mesh ahead of time, so that the first loadMesh
+  // or render call using it only has to upload.  Safe to call from any
+  // thread.
+  void prepareMesh(Resource resource);
+
   void renderGeometry(ShapeWrapperPtr & shape, ProgramPtr & program);
   void renderGeometry(ShapeWrapperPtr & shape, ProgramPtr & program, const std::list<std::function<void()>> & list);
   void renderGeometry(ShapeWrapperPtr & shape, ProgramPtr & program, std::function<void()> lambda);
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program);
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program, const std::list<std::function<void()>> & list);
+  void renderGeometry(MeshPtr & mesh, ProgramPtr & program, std::function<void()> lambda);
   void renderCube(const glm::vec3 & color = Colors::white);
   void renderColorCube();
   void renderSkybox(Resource firstImageResource);
@@ -47,6 +61,11 @@ namespace oria {
   void renderManikinScene(float ipd, float eyeHeight);
   void renderExampleScene(float ipd, float eyeHeight);
 
+  Text::FontPtr getFont(Resource font);
+  // Adds a font that has already been decoded and uploaded to the cache
+  // used by getFont.  A font that is already cached wins.
+  Text::FontPtr getFont(Resource font, const Text::FontPtr & loaded);
+
   void renderString(const std::string & str, glm::vec2 & cursor,
       float fontSize = 12.0f, Resource font =
           Resource::FONTS_INCONSOLATA_MEDIUM_SDFF);
@@ -0,0 +1,209 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#include "Common.h"
+
+const size_t GpuTimer::MAX_SECTIONS;
+const size_t GpuTimer::FRAME_LATENCY;
+const size_t GpuTimer::INVALID_SECTION;
+
+int64_t GpuTimer::Frame::sectionDuration(const char * name) const {
+  int64_t result = 0;
+  for (size_t i = 0; i < sectionCount; ++i) {
+    if (0 == strcmp(sections[i].name, name)) {
+      result += sections[i].duration();
+    }
+  }
+  return result;
+}
+
+GpuTimer & GpuTimer::instance() {
+  static GpuTimer INSTANCE;
+  static bool registeredShutdown = false;
+  if (!registeredShutdown) {
+    Platform::addShutdownHook([&]{
+      if (INSTANCE.initialized) {
+        for (size_t i = 0; i < FRAME_LATENCY; ++i) {
+          glDeleteQueries(MAX_SECTIONS * 2, INSTANCE.slots[i].queries);
+        }
+        INSTANCE.initialized = false;
+      }
+    });
+    registeredShutdown = true;
+  }
+  return INSTANCE;
+}
+
+bool GpuTimer::isSupported() {
+  if (supported < 0) {
+    // Timer queries are core in 3.3, but Mesa and some older drivers only
+    // expose the extension
+    supported = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? 1 : 0;
+    if (!supported) {
+      SAY_ERR("Timer queries not supported, GPU timing disabled");
+    }
+  }
+  return supported > 0;
+}
+
+void GpuTimer::beginFrame(unsigned int index) {
+  if (!isSupported()) {
+    return;
+  }
+  if (frameOpen) {
+    endFrame();
+  }
+  if (!initialized) {
+    for (size_t i = 0; i < FRAME_LATENCY; ++i) {
+      glGenQueries(MAX_SECTIONS * 2, slots[i].queries);
+    }
+    initialized = true;
+  }
+
+  collect();
+  current = (current + 1) % FRAME_LATENCY;
+  Slot & slot = slots[current];
+  if (slot.pending) {
+    // The GPU is more than FRAME_LATENCY frames behind, give up on this one
+    ++missed;
+    slot.pending = false;
+  }
+  slot.frame.index = index;
+  slot.frame.sectionCount = 0;
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  slot.clockOffset = Platform::elapsedNanos() - gpuNow;
+  frameOpen = true;
+  depth = 0;
+  begin("GPU frame");
+}
+
+void GpuTimer::endFrame() {
+  if (!frameOpen) {
+    return;
+  }
+  Slot & slot = slots[current];
+  // Close out any sections left open, innermost first, so that the frame
+  // section's query is the last one issued
+  for (size_t i = slot.frame.sectionCount; i > 0; --i) {
+    end(i - 1);
+  }
+  slot.pending = true;
+  frameOpen = false;
+}
+
+size_t GpuTimer::begin(const char * name) {
+  if (!frameOpen) {
+    return INVALID_SECTION;
+  }
+  Frame & frame = slots[current].frame;
+  if (frame.sectionCount >= MAX_SECTIONS) {
+    return INVALID_SECTION;
+  }
+  size_t result = frame.sectionCount++;
+  Section & section = frame.sections[result];
+  section.name = name;
+  section.depth = depth++;
+  section.start = 0;
+  // Until the results are read back, a non-zero end marks a closed section
+  section.end = 0;
+  glQueryCounter(slots[current].queries[result * 2], GL_TIMESTAMP);
+  return result;
+}
+
+void GpuTimer::end(size_t section) {
+  if (!frameOpen || section >= slots[current].frame.sectionCount) {
+    return;
+  }
+  Section & closing = slots[current].frame.sections[section];
+  if (closing.end) {
+    return;
+  }
+  closing.end = 1;
+  glQueryCounter(slots[current].queries[section * 2 + 1], GL_TIMESTAMP);
+  --depth;
+}
+
+void GpuTimer::collect() {
+  // Oldest first, and once one frame isn't ready none of the later ones are
+  for (size_t i = 1; i <= FRAME_LATENCY; ++i) {
+    Slot & slot = slots[(current + i) % FRAME_LATENCY];
+    if (!slot.pending) {
+      continue;
+    }
+    if (!read(slot)) {
+      break;
+    }
+    slot.pending = false;
+    last = slot.frame;
+  }
+}
+
+bool GpuTimer::read(Slot & slot) {
+  Frame & frame = slot.frame;
+  if (!frame.sectionCount) {
+    return true;
+  }
+  GLint available = 0;
+  glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return false;
+  }
+
+  for (size_t i = 0; i < frame.sectionCount; ++i) {
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+    Section & section = frame.sections[i];
+    section.start = (int64_t)start;
+    section.end = (int64_t)end;
+    if (Profiler::isEnabled()) {
+      Profiler::completeOnTrack("GPU", section.name,
+        section.start + slot.clockOffset, section.end + slot.clockOffset);
+    }
+  }
+  return true;
+}
+
+std::string GpuTimer::describe() const {
+  std::stringstream result;
+  result.precision(3);
+  result << std::fixed;
+  result << "GPU frame " << last.index << " " << ((double)last.duration() / 1e6) << "ms";
+  int lastDepth = 0;
+  for (size_t i = 1; i < last.sectionCount; ++i) {
+    const Section & section = last.sections[i];
+    // Sections nest inside the frame section, which isn't listed
+    int sectionDepth = section.depth - 1;
+    for (; lastDepth < sectionDepth; ++lastDepth) {
+      result << " [";
+    }
+    for (; lastDepth > sectionDepth; --lastDepth) {
+      result << " ]";
+    }
+    result << " " << section.name << " " << ((double)section.duration() / 1e6);
+  }
+  for (; lastDepth > 0; --lastDepth) {
+    result << " ]";
+  }
+  if (missed) {
+    result << " missed " << missed;
+  }
+  return result.str();
+}
@@ -0,0 +1,125 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Measures GPU time for named, nested sections of a frame using timestamp
+ * queries.  Results are read back FRAME_LATENCY frames later, and only if
+ * the GPU has already finished with them, so timing never stalls the
+ * pipeline.  Frames whose results weren't ready in time are counted as
+ * missed rather than waited for.
+ *
+ * Like FrameTimeline, section names must be string literals.  The timer
+ * must only be used from the thread owning the GL context.  While the
+ * Profiler is recording, the sections are also written to a "GPU" track in
+ * the trace, aligned to the CPU clock.
+ */
+class GpuTimer {
+public:
+  static const size_t MAX_SECTIONS = 64;
+  static const size_t FRAME_LATENCY = 4;
+  static const size_t INVALID_SECTION = (size_t)-1;
+
+  struct Section {
+    const char * name{ nullptr };
+    int depth{ 0 };
+    int64_t start{ 0 };
+    int64_t end{ 0 };
+
+    int64_t duration() const {
+      return end - start;
+    }
+  };
+
+  struct Frame {
+    unsigned int index{ 0 };
+    size_t sectionCount{ 0 };
+    // The first section always spans the whole frame
+    Section sections[MAX_SECTIONS];
+
+    int64_t duration() const {
+      return sectionCount ? sections[0].duration() : 0;
+    }
+
+    // Total GPU time of all sections with the given name, in nanoseconds
+    int64_t sectionDuration(const char * name) const;
+  };
+
+  class Scope {
+    GpuTimer & timer;
+    size_t section;
+
+  public:
+    Scope(GpuTimer & timer, const char * name)
+      : timer(timer), section(timer.begin(name)) {
+    }
+
+    ~Scope() {
+      timer.end(section);
+    }
+  };
+
+  // The timer for the rendering context of this process
+  static GpuTimer & instance();
+
+  // False if the context lacks timer queries, in which case everything
+  // else is a no-op
+  bool isSupported();
+  void beginFrame(unsigned int index);
+  void endFrame();
+  size_t begin(const char * name);
+  void end(size_t section);
+
+  // The most recent frame whose results have been read back
+  const Frame & getLastFrame() const {
+    return last;
+  }
+
+  size_t getMissedFrames() const {
+    return missed;
+  }
+
+  std::string describe() const;
+
+private:
+  struct Slot {
+    Frame frame;
+    // Query ids, two per section
+    GLuint queries[MAX_SECTIONS * 2];
+    // CPU clock minus GPU clock, sampled when the frame was issued
+    int64_t clockOffset{ 0 };
+    bool pending{ false };
+  };
+
+  GpuTimer() {}
+  void collect();
+  bool read(Slot & slot);
+
+  int supported{ -1 };
+  bool initialized{ false };
+  bool frameOpen{ false };
+  int depth{ 0 };
+  size_t current{ 0 };
+  size_t missed{ 0 };
+  Slot slots[FRAME_LATENCY];
+  Frame last;
+};
+
+#define GPU_ZONE(name) GpuTimer::Scope PROFILE_CONCAT(gpuZone, __LINE__)(GpuTimer::instance(), name)
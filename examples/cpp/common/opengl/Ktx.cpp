@@ -0,0 +1,270 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+namespace oria {
+
+  static const uint8_t KTX_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+  };
+
+  static uint32_t readU32(const uint8_t * p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+  }
+
+  bool parseKtx(const ResourceView & data, KtxImage & out) {
+    const size_t HEADER_SIZE = sizeof(KTX_IDENTIFIER) + 13 * 4;
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER))) {
+      return false;
+    }
+    uint32_t header[13];
+    for (int i = 0; i < 13; ++i) {
+      header[i] = readU32(data.data() + sizeof(KTX_IDENTIFIER) + i * 4);
+    }
+    // Only native little endian files, which is all the tool writes
+    if (0x04030201 != header[0]) {
+      return false;
+    }
+    out.type = header[1];
+    out.format = header[3];
+    out.internalFormat = header[4];
+    out.baseInternalFormat = header[5];
+    out.size = uvec2(header[6], header[7]);
+    out.faces = header[10];
+    out.levelCount = std::max(1u, header[11]);
+    // No 3D textures or arrays
+    if (header[8] > 1 || header[9] > 0 || (1 != out.faces && 6 != out.faces) || !out.size.x || !out.size.y) {
+      return false;
+    }
+
+    size_t offset = HEADER_SIZE + header[12];
+    out.levels.clear();
+    for (uint32_t level = 0; level < out.levelCount; ++level) {
+      if (offset + 4 > data.size()) {
+        return false;
+      }
+      size_t imageSize = readU32(data.data() + offset);
+      offset += 4;
+      for (uint32_t face = 0; face < out.faces; ++face) {
+        if (imageSize > data.size() - offset) {
+          return false;
+        }
+        out.levels.push_back(data.subView(offset, imageSize));
+        offset += (imageSize + 3) & ~(size_t)3;
+      }
+    }
+    return true;
+  }
+
+  static bool isS3tc(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool canSampleCompressed(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      return GLEW_EXT_texture_compression_s3tc != 0;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+      return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+      return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+    default:
+      return false;
+    }
+  }
+
+  static void decodeColors(const uint8_t * block, bool fourColor, uint8_t palette[4][4]) {
+    uint16_t c0 = (uint16_t)(block[0] | block[1] << 8);
+    uint16_t c1 = (uint16_t)(block[2] | block[3] << 8);
+    uint16_t packed[2] = { c0, c1 };
+    for (int i = 0; i < 2; ++i) {
+      int r = (packed[i] >> 11) & 31, g = (packed[i] >> 5) & 63, b = packed[i] & 31;
+      palette[i][0] = (uint8_t)((r << 3) | (r >> 2));
+      palette[i][1] = (uint8_t)((g << 2) | (g >> 4));
+      palette[i][2] = (uint8_t)((b << 3) | (b >> 2));
+      palette[i][3] = 255;
+    }
+    for (int c = 0; c < 3; ++c) {
+      if (fourColor || c0 > c1) {
+        palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+        palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+      } else {
+        palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+        palette[3][c] = 0;
+      }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (fourColor || c0 > c1) ? 255 : 0;
+  }
+
+  static void decodeAlpha(const uint8_t * block, uint8_t alpha[16]) {
+    int a0 = block[0], a1 = block[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1) {
+      for (int p = 1; p < 7; ++p) {
+        palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+      }
+    } else {
+      for (int p = 1; p < 5; ++p) {
+        palette[p + 1] = ((5 - p) * a0 + p * a1) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) {
+      indices |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i) {
+      alpha[i] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+    }
+  }
+
+  bool decompressBlocks(GLenum internalFormat, const uvec2 & size,
+      const ResourceView & blocks, std::vector<uint8_t> & rgba) {
+    bool bc3 = (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT == internalFormat);
+    if (!isS3tc(internalFormat)) {
+      return false;
+    }
+    size_t blockSize = bc3 ? 16 : 8;
+    uint32_t blocksWide = (size.x + 3) / 4;
+    uint32_t blocksHigh = (size.y + 3) / 4;
+    if (blocks.size() < blocksWide * blocksHigh * blockSize) {
+      return false;
+    }
+
+    rgba.resize(size.x * size.y * 4);
+    const uint8_t * block = blocks.data();
+    for (uint32_t by = 0; by < blocksHigh; ++by) {
+      for (uint32_t bx = 0; bx < blocksWide; ++bx, block += blockSize) {
+        uint8_t alpha[16];
+        const uint8_t * colors = block;
+        if (bc3) {
+          decodeAlpha(block, alpha);
+          colors += 8;
+        }
+        uint8_t palette[4][4];
+        decodeColors(colors, bc3, palette);
+        uint32_t indices = readU32(colors + 4);
+        for (int i = 0; i < 16; ++i) {
+          uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+          if (x >= size.x || y >= size.y) {
+            continue;
+          }
+          uint8_t * out = &rgba[(y * size.x + x) * 4];
+          memcpy(out, palette[(indices >> (2 * i)) & 3], 4);
+          if (bc3) {
+            out[3] = alpha[i];
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  GLenum ktxStorageFormat(const KtxImage & image) {
+    if (image.isCompressed() && !canSampleCompressed(image.internalFormat)) {
+      return GL_RGBA8;
+    }
+    return image.internalFormat;
+  }
+
+  void uploadKtx(GLenum target, const KtxImage & image, uint32_t face) {
+    PROFILE_ZONE("uploadKtx");
+    bool direct = !image.isCompressed() || canSampleCompressed(image.internalFormat);
+    std::vector<uint8_t> expanded;
+    for (uint32_t level = 0; level < image.levelCount; ++level) {
+      const ResourceView & data = image.level(level, face);
+      uvec2 size = image.levelSize(level);
+      if (!image.isCompressed()) {
+        TextureStreamer::instance().subImage2D(target, level, size, image.format, image.type, data.data());
+      } else if (direct) {
+        glCompressedTexSubImage2D(target, level, 0, 0, size.x, size.y,
+          image.internalFormat, (GLsizei)data.size(), data.data());
+      } else if (decompressBlocks(image.internalFormat, size, data, expanded)) {
+        TextureStreamer::instance().subImage2D(target, level, size, GL_RGBA, GL_UNSIGNED_BYTE, expanded.data());
+      }
+    }
+  }
+
+  static bool isUsable(const KtxImage & image) {
+    return !image.isCompressed() || canSampleCompressed(image.internalFormat) || isS3tc(image.internalFormat);
+  }
+
+  TexturePtr loadKtxTexture(const ResourceView & data, uvec2 & outSize) {
+    PROFILE_ZONE("loadKtxTexture");
+    using namespace oglplus;
+    KtxImage image;
+    if (!parseKtx(data, image) || 1 != image.faces || !isUsable(image)) {
+      return TexturePtr();
+    }
+
+    TexturePtr result(new Texture());
+    Context::Bound(TextureTarget::_2D, *result)
+      .MagFilter(TextureMagFilter::Linear)
+      .MinFilter(image.levelCount > 1 ? TextureMinFilter::LinearMipmapLinear : TextureMinFilter::Linear);
+    TextureStreamer::allocate(GL_TEXTURE_2D, image.levelCount, ktxStorageFormat(image), image.size);
+    uploadKtx(GL_TEXTURE_2D, image);
+    outSize = image.size;
+    return result;
+  }
+
+  TexturePtr loadKtxCubemap(const std::vector<ResourceView> & faces) {
+    PROFILE_ZONE("loadKtxCubemap");
+    using namespace oglplus;
+    std::vector<KtxImage> images(6);
+    if (6 != faces.size()) {
+      return TexturePtr();
+    }
+    for (size_t i = 0; i < 6; ++i) {
+      if (!parseKtx(faces[i], images[i]) || 1 != images[i].faces || !isUsable(images[i]) ||
+          images[i].size != images[0].size || images[i].internalFormat != images[0].internalFormat ||
+          images[i].levelCount != images[0].levelCount) {
+        return TexturePtr();
+      }
+    }
+
+    TexturePtr result(new Texture());
+    Context::Bound(TextureTarget::CubeMap, *result)
+      .MagFilter(TextureMagFilter::Linear)
+      .MinFilter(images[0].levelCount > 1 ? TextureMinFilter::LinearMipmapLinear : TextureMinFilter::Linear)
+      .WrapS(TextureWrap::ClampToEdge)
+      .WrapT(TextureWrap::ClampToEdge)
+      .WrapR(TextureWrap::ClampToEdge);
+    TextureStreamer::allocate(GL_TEXTURE_CUBE_MAP, images[0].levelCount, ktxStorageFormat(images[0]), images[0].size);
+    for (int i = 0; i < 6; ++i) {
+      uploadKtx(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, images[i]);
+    }
+    return result;
+  }
+}
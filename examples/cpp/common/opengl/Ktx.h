@@ -0,0 +1,73 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+namespace oria {
+
+  /**
+   * A parsed KTX 1.1 container, as written by the TextureCompressor tool.
+   * The levels are views into the container bytes, ordered by level and
+   * then by face.
+   */
+  struct KtxImage {
+    GLenum type{ 0 };
+    GLenum format{ 0 };
+    GLenum internalFormat{ 0 };
+    GLenum baseInternalFormat{ 0 };
+    uvec2 size;
+    uint32_t faces{ 1 };
+    uint32_t levelCount{ 0 };
+    std::vector<ResourceView> levels;
+
+    bool isCompressed() const {
+      return 0 == type;
+    }
+
+    const ResourceView & level(uint32_t level, uint32_t face = 0) const {
+      return levels.at(level * faces + face);
+    }
+
+    uvec2 levelSize(uint32_t level) const {
+      return uvec2(std::max(1u, size.x >> level), std::max(1u, size.y >> level));
+    }
+  };
+
+  bool parseKtx(const ResourceView & data, KtxImage & out);
+
+  // True if the context can sample the compressed format directly
+  bool canSampleCompressed(GLenum internalFormat);
+
+  // Expands one level of BC1 or BC3 blocks to RGBA8, for contexts without
+  // S3TC.  Returns false for any other format.
+  bool decompressBlocks(GLenum internalFormat, const uvec2 & size,
+    const ResourceView & blocks, std::vector<uint8_t> & rgba);
+
+  // Uploads every level of a face into the texture bound to target, which
+  // must already have storage for them
+  void uploadKtx(GLenum target, const KtxImage & image, uint32_t face = 0);
+
+  // The format storage is allocated with, RGBA8 when the compressed format
+  // will have to be expanded
+  GLenum ktxStorageFormat(const KtxImage & image);
+
+  // Null if the container can't be used, so the caller can fall back on
+  // the source image
+  TexturePtr loadKtxTexture(const ResourceView & data, uvec2 & outSize);
+  TexturePtr loadKtxCubemap(const std::vector<ResourceView> & faces);
+}
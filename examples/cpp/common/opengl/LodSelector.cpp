@@ -0,0 +1,107 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const float LodSelector::DEFAULT_PIXEL_ERROR = 1.0f;
+
+LodSelector & LodSelector::instance() {
+  static LodSelector INSTANCE;
+  return INSTANCE;
+}
+
+LodSelector::LodSelector() {
+  const char * env = getenv("ORIA_LOD_PIXEL_ERROR");
+  if (env && *env) {
+    pixelError = (float)atof(env);
+  }
+}
+
+void LodSelector::beginFrame() {
+  remembering = true;
+  // Meshes not drawn last frame may have been destroyed, and their
+  // address reused
+  for (auto i = meshes.begin(); i != meshes.end(); ) {
+    if (i->second.choices.empty()) {
+      i = meshes.erase(i);
+    } else {
+      i->second.choices.clear();
+      i->second.drawn = 0;
+      ++i;
+    }
+  }
+}
+
+void LodSelector::beginEye(int height) {
+  viewportHeight = height;
+  for (auto & entry : meshes) {
+    entry.second.drawn = 0;
+  }
+}
+
+size_t LodSelector::select(const Mesh & mesh) {
+  if (mesh.getLodCount() < 2) {
+    return 0;
+  }
+  if (!remembering) {
+    return choose(mesh);
+  }
+  Draws & draws = meshes[&mesh];
+  size_t draw = draws.drawn++;
+  if (draw >= draws.choices.size()) {
+    draws.choices.push_back((uint8_t)choose(mesh));
+  }
+  return draws.choices[draw];
+}
+
+size_t LodSelector::choose(const Mesh & mesh) {
+  if (pixelError <= 0) {
+    return 0;
+  }
+  int height = viewportHeight;
+  if (!height) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    height = viewport[3];
+  }
+
+  const mat4 & modelView = Stacks::modelview().top();
+  const mat4 & projection = Stacks::projection().top();
+  // The largest scale of the modelview applies to errors in any direction
+  float scale = std::max(glm::length(vec3(modelView[0])),
+    std::max(glm::length(vec3(modelView[1])), glm::length(vec3(modelView[2]))));
+  vec3 center = vec3(modelView * vec4(mesh.getCenter(), 1));
+  // The nearest point of the bounding sphere, since any part of the mesh
+  // may be there
+  float distance = glm::length(center) - mesh.getRadius() * scale;
+  if (distance <= 0) {
+    return 0;
+  }
+  // Pixels per unit at distance one, along the vertical
+  float pixelsPerUnit = projection[1][1] * height * 0.5f;
+  float allowed = pixelError * distance / (pixelsPerUnit * scale);
+
+  size_t result = 0;
+  for (size_t lod = 1; lod < mesh.getLodCount(); ++lod) {
+    if (mesh.getLodError(lod) > allowed) {
+      break;
+    }
+    result = lod;
+  }
+  return result;
+}
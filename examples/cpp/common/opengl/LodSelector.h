@@ -0,0 +1,78 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Picks the level of detail for each mesh drawn, the coarsest whose error
+ * projects to less than getPixelError() pixels on screen.  Each instance
+ * is judged by its own distance and scale, so a scene costs in proportion
+ * to how much of the screen it covers rather than how many meshes it has.
+ *
+ * The eyes of a stereo frame see each mesh from slightly different
+ * places, so judging them separately can give one eye a coarser level
+ * than the other at the switching distance, which shows as shimmer.
+ * Between beginFrame() and the next one, the first eye's choices are
+ * remembered and the second eye gets the same level for the same draw.
+ * Draws are matched by mesh and by their order within the eye, as both
+ * eyes draw the same scene; beginEye() restarts the count.  Every loop
+ * rendering the eyes has to call both, or each eye is judged on its own.
+ * Without them the viewport height is also read back from GL at every
+ * selection.
+ *
+ * ORIA_LOD_PIXEL_ERROR sets the allowed error, and 0 draws every mesh at
+ * full detail.
+ */
+class LodSelector {
+public:
+  static const float DEFAULT_PIXEL_ERROR;
+
+  static LodSelector & instance();
+
+  void beginFrame();
+  // The height of the eye's viewport, in pixels, which the projection maps
+  // onto.  Zero reads it back from GL at each selection.
+  void beginEye(int viewportHeight = 0);
+
+  // The level to draw the mesh at under the current modelview and projection
+  size_t select(const Mesh & mesh);
+
+  float getPixelError() const {
+    return pixelError;
+  }
+
+  void setPixelError(float error) {
+    pixelError = error;
+  }
+
+private:
+  LodSelector();
+  size_t choose(const Mesh & mesh);
+
+  float pixelError{ DEFAULT_PIXEL_ERROR };
+  int viewportHeight{ 0 };
+  bool remembering{ false };
+  struct Draws {
+    // The choices of the first eye of the frame, in draw order
+    std::vector<uint8_t> choices;
+    // Draws so far in the current eye
+    size_t drawn{ 0 };
+  };
+  // Kept from frame to frame, so the vectors keep their storage
+  std::unordered_map<const Mesh *, Draws> meshes;
+};
@@ -0,0 +1,84 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+Mesh::Mesh(const MeshData & data, const std::initializer_list<const GLchar*> & names, const ProgramPtr & program)
+  : indexType(data.indexType), lods(data.lods), materials(data.materials) {
+  if (lods.empty()) {
+    MeshData::Lod all = { 0, data.indexCount, 0 };
+    lods.push_back(all);
+  }
+  center = (data.boundsMin + data.boundsMax) * 0.5f;
+  radius = glm::length(data.boundsMax - center);
+
+  using namespace oglplus;
+  vao.Bind();
+  vertexBuffer.Bind(Buffer::Target::Array);
+  glBufferData(GL_ARRAY_BUFFER, data.vertices.size(), data.vertices.data(), GL_STATIC_DRAW);
+  indexBuffer.Bind(Buffer::Target::ElementArray);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size(), data.indices.data(), GL_STATIC_DRAW);
+
+  GLuint programName = oglplus::GetName(*program);
+  GLsizei stride = (GLsizei)data.stride();
+  for (const GLchar * name : names) {
+    GLint size;
+    size_t offset;
+    if (0 == strcmp(name, "Position")) {
+      size = 3;
+      offset = 0;
+    } else if (0 == strcmp(name, "Normal")) {
+      if (!data.hasNormals) {
+        continue;
+      }
+      size = 3;
+      offset = data.normalOffset();
+    } else if (0 == strcmp(name, "TexCoord")) {
+      if (!data.hasTexCoords) {
+        continue;
+      }
+      size = 2;
+      offset = data.texCoordOffset();
+    } else if (0 == strcmp(name, "Material")) {
+      if (!data.hasMaterials) {
+        continue;
+      }
+      size = 1;
+      offset = data.materialOffset();
+    } else {
+      FAIL("Meshes have no %s attribute", name);
+    }
+    GLint location = glGetAttribLocation(programName, name);
+    if (location < 0) {
+      continue;
+    }
+    glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
+    glEnableVertexAttribArray(location);
+  }
+  NoVertexArray().Bind();
+}
+
+void Mesh::bind() {
+  vao.Bind();
+}
+
+void Mesh::draw(size_t lod) {
+  const MeshData::Lod & range = lods[std::min(lod, lods.size() - 1)];
+  glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, indexType,
+    (const void *)(range.indexOffset * MeshData::indexSize(indexType)));
+}
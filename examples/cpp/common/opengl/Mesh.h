@@ -0,0 +1,199 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Mesh vertices in the layout they are drawn from: positions, then normals,
+ * texture coordinates and material numbers when the mesh has them,
+ * interleaved into a single array, with indices alongside.  Decoding writes
+ * this layout directly, and uploading is one allocation per buffer straight
+ * from it, so there are no per-attribute arrays in between.
+ *
+ * The same layout is also a file format, laid out as
+ *
+ *   FileHeader
+ *   FileMaterial[materialCount]
+ *   FileLod[lodCount]
+ *   vertices, at vertexOffset
+ *   indices, at indexOffset
+ *
+ * with every section aligned to 16 bytes, in the byte order of the machine
+ * that wrote it.  The MeshConverter tool writes one for each mesh at build
+ * time, named like "meshes/ArtificialHorizon.obj.mesh", and load() maps it
+ * and points the vertices and indices into the file instead of parsing
+ * anything.  Meshes decoded at runtime are kept in the DecodedCache in this
+ * format too.
+ *
+ * Decoding and loading are safe on any thread.
+ */
+struct MeshData {
+  static const char MAGIC[4];
+  static const uint32_t VERSION = 2;
+  static const size_t MAX_MATERIAL_NAME = 48;
+
+  struct Material {
+    std::string name;
+    // From the OBJ material library, white without one
+    vec4 diffuse{ 1 };
+  };
+
+  // A range of the indices drawing the mesh at one level of detail.  Every
+  // level shares the vertices, and the first is the full mesh.
+  struct Lod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    // How far, in model units, the surface may be from the full mesh's
+    float error;
+  };
+
+  struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t hasNormals;
+    uint32_t hasTexCoords;
+    uint32_t hasMaterials;
+    uint32_t indexType;
+    uint32_t materialCount;
+    uint32_t vertexOffset;
+    uint32_t indexOffset;
+    uint32_t lodCount;
+    float boundsMin[3];
+    float boundsMax[3];
+  };
+
+  struct FileMaterial {
+    char name[MAX_MATERIAL_NAME];
+    float diffuse[4];
+  };
+
+  struct FileLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+  };
+
+  uint32_t vertexCount{ 0 };
+  uint32_t indexCount{ 0 };
+  bool hasNormals{ false };
+  bool hasTexCoords{ false };
+  // A float per vertex, the index into materials
+  bool hasMaterials{ false };
+  // GL_UNSIGNED_SHORT when every index fits, else GL_UNSIGNED_INT
+  GLenum indexType{ GL_UNSIGNED_INT };
+  ResourceView vertices;
+  ResourceView indices;
+  std::vector<Material> materials;
+  // Empty until MeshSimplifier has run, meaning all the indices are one level
+  std::vector<Lod> lods;
+  vec3 boundsMin;
+  vec3 boundsMax;
+
+  size_t stride() const {
+    return sizeof(float) * (3 + (hasNormals ? 3 : 0) + (hasTexCoords ? 2 : 0) + (hasMaterials ? 1 : 0));
+  }
+
+  size_t normalOffset() const {
+    return sizeof(float) * 3;
+  }
+
+  size_t texCoordOffset() const {
+    return sizeof(float) * (hasNormals ? 6 : 3);
+  }
+
+  size_t materialOffset() const {
+    return texCoordOffset() + (hasTexCoords ? sizeof(float) * 2 : 0);
+  }
+
+  static size_t indexSize(GLenum indexType) {
+    return GL_UNSIGNED_SHORT == indexType ? sizeof(GLushort) : sizeof(GLuint);
+  }
+
+  // The converted file if the build made one, else the resource decoded
+  // by its extension
+  static std::shared_ptr<MeshData> load(Resource resource);
+  // Null if the file is truncated or from another version
+  static std::shared_ptr<MeshData> fromFile(const ResourceView & file);
+  static std::shared_ptr<MeshData> decodeCtm(const ResourceView & data);
+  // Material libraries named by the OBJ are opened through the callback,
+  // if there is one
+  typedef std::function<ResourceView(const std::string & name)> Opener;
+  static std::shared_ptr<MeshData> decodeObj(const ResourceView & data, const Opener & open = Opener());
+
+  // Most meshes fit 16 bit indices, which halves the index fetches, so
+  // this picks the smallest type that holds them
+  void setIndices(const std::vector<uint32_t> & source);
+  std::vector<uint32_t> getIndices() const;
+
+  std::vector<uint8_t> toFile() const;
+};
+
+typedef std::shared_ptr<MeshData> MeshDataPtr;
+
+/**
+ * A mesh uploaded from MeshData, with its vertex array set up for one
+ * program's attributes.
+ */
+class Mesh {
+public:
+  // The attribute names are "Position", "Normal", "TexCoord" and "Material",
+  // each bound to its location in the program.  Names the mesh has no data
+  // for, or the program doesn't use, are left disabled.
+  Mesh(const MeshData & data, const std::initializer_list<const GLchar*> & names, const ProgramPtr & program);
+
+  void bind();
+  // Draws the level of detail, which LodSelector picks
+  void draw(size_t lod = 0);
+
+  size_t getLodCount() const {
+    return lods.size();
+  }
+
+  float getLodError(size_t lod) const {
+    return lods[lod].error;
+  }
+
+  // The bounding sphere in model space
+  const vec3 & getCenter() const {
+    return center;
+  }
+
+  float getRadius() const {
+    return radius;
+  }
+
+  // Indexed by the Material attribute
+  const std::vector<MeshData::Material> & getMaterials() const {
+    return materials;
+  }
+
+private:
+  oglplus::VertexArray vao;
+  oglplus::Buffer vertexBuffer;
+  oglplus::Buffer indexBuffer;
+  GLenum indexType;
+  std::vector<MeshData::Lod> lods;
+  std::vector<MeshData::Material> materials;
+  vec3 center;
+  float radius;
+};
+
+typedef std::shared_ptr<Mesh> MeshPtr;
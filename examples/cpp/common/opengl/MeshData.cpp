@@ -0,0 +1,498 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+#include <openctmpp.h>
+
+const char MeshData::MAGIC[4] = { 'O', 'M', 'S', 'H' };
+const uint32_t MeshData::VERSION;
+const size_t MeshData::MAX_MATERIAL_NAME;
+
+namespace {
+  const size_t ALIGNMENT = 16;
+
+  size_t align(size_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  // Decoded meshes go in the DecodedCache as mesh files
+  MeshDataPtr findCached(uint64_t key) {
+    ResourceView blob = DecodedCache::instance().find(key);
+    return blob.empty() ? MeshDataPtr() : MeshData::fromFile(blob);
+  }
+
+  void storeCached(const MeshData & mesh, uint64_t key) {
+    std::vector<uint8_t> file = mesh.toFile();
+    DecodedCache::instance().store(key, { ResourceView(file.data(), file.size()) });
+  }
+
+  void computeBounds(MeshData & mesh) {
+    mesh.boundsMin = mesh.boundsMax = vec3();
+    size_t floats = mesh.stride() / sizeof(float);
+    const float * vertex = reinterpret_cast<const float *>(mesh.vertices.data());
+    for (size_t i = 0; i < mesh.vertexCount; ++i, vertex += floats) {
+      vec3 position(vertex[0], vertex[1], vertex[2]);
+      if (0 == i) {
+        mesh.boundsMin = mesh.boundsMax = position;
+      }
+      mesh.boundsMin = glm::min(mesh.boundsMin, position);
+      mesh.boundsMax = glm::max(mesh.boundsMax, position);
+    }
+  }
+
+  // Bounds have to come first, as the simplifier scales its limits by them
+  void optimize(MeshData & mesh, const std::vector<uint32_t> & indices) {
+    MeshOptimizer::Stats stats = MeshOptimizer::optimize(mesh, indices);
+    SAY("Optimized mesh: %u to %u vertices, ACMR %.3f to %.3f",
+      stats.verticesBefore, stats.verticesAfter, stats.acmrBefore, stats.acmrAfter);
+    computeBounds(mesh);
+    MeshSimplifier::generateLods(mesh);
+    std::string levels;
+    for (const MeshData::Lod & lod : mesh.lods) {
+      levels += Platform::format(" %u (%g)", lod.indexCount / 3, lod.error);
+    }
+    SAY("Mesh levels of detail, triangles (error):%s", levels.c_str());
+  }
+
+  // Feeds the importer straight from the resource bytes
+  CTMuint CTMCALL readView(void * buffer, CTMuint count, void * userData) {
+    ResourceView & remaining = *static_cast<ResourceView *>(userData);
+    size_t size = std::min((size_t)count, remaining.size());
+    memcpy(buffer, remaining.data(), size);
+    remaining = remaining.subView(size);
+    return (CTMuint)size;
+  }
+
+  // Splits a view into lines and lines into whitespace separated tokens,
+  // without copying
+  class ObjReader {
+    const char * next;
+    const char * end;
+    const char * lineEnd{ nullptr };
+
+  public:
+    ObjReader(const ResourceView & data) : next(data.chars()), end(data.chars() + data.size()) {}
+
+    bool nextLine() {
+      if (next >= end) {
+        return false;
+      }
+      const char * newline = (const char *)memchr(next, '\n', end - next);
+      lineEnd = newline ? newline : end;
+      return true;
+    }
+
+    // Empty at the end of the line
+    std::string token() {
+      while (next < lineEnd && isspace((unsigned char)*next)) {
+        ++next;
+      }
+      const char * start = next;
+      while (next < lineEnd && !isspace((unsigned char)*next)) {
+        ++next;
+      }
+      return std::string(start, next);
+    }
+
+    // The remainder of the line, trimmed
+    std::string rest() {
+      while (next < lineEnd && isspace((unsigned char)*next)) {
+        ++next;
+      }
+      const char * last = lineEnd;
+      while (last > next && isspace((unsigned char)last[-1])) {
+        --last;
+      }
+      return std::string(next, last);
+    }
+
+    float number() {
+      std::string value = token();
+      return value.empty() ? 0.0f : (float)atof(value.c_str());
+    }
+
+    void skipLine() {
+      next = lineEnd < end ? lineEnd + 1 : end;
+    }
+  };
+
+  // Only the diffuse color matters to the examples
+  void readMaterialLibrary(const ResourceView & data, std::vector<MeshData::Material> & materials) {
+    ObjReader reader(data);
+    MeshData::Material * current = nullptr;
+    while (reader.nextLine()) {
+      std::string command = reader.token();
+      if ("newmtl" == command) {
+        std::string name = reader.rest();
+        current = nullptr;
+        for (MeshData::Material & material : materials) {
+          if (material.name == name) {
+            current = &material;
+          }
+        }
+      } else if ("Kd" == command && current) {
+        current->diffuse.r = reader.number();
+        current->diffuse.g = reader.number();
+        current->diffuse.b = reader.number();
+      } else if ("d" == command && current) {
+        current->diffuse.a = reader.number();
+      }
+      reader.skipLine();
+    }
+  }
+
+  // OBJ indices count from one, or back from the latest element when
+  // negative
+  int objIndex(const std::string & value, size_t count) {
+    int index = atoi(value.c_str());
+    return index < 0 ? (int)count + index : index - 1;
+  }
+}
+
+MeshDataPtr MeshData::load(Resource resource) {
+  ResourceView file = Platform::getDerivedResourceView(resource, ".mesh");
+  if (!file.empty()) {
+    MeshDataPtr result = fromFile(file);
+    if (result) {
+      return result;
+    }
+    SAY_ERR("Ignoring the out of date mesh file for %s", Resources::getResourcePath(resource).c_str());
+  }
+
+  ResourceView data = Platform::getResourceView(resource);
+  std::string name = Platform::getResourceName(resource);
+  if (Platform::hasExtension(name, ".obj")) {
+    std::string directory = name.substr(0, name.find_last_of('/') + 1);
+    return decodeObj(data, [&](const std::string & library) {
+      return Platform::getResourceView(directory + library);
+    });
+  }
+  return decodeCtm(data);
+}
+
+MeshDataPtr MeshData::fromFile(const ResourceView & file) {
+  if (file.size() < sizeof(FileHeader)) {
+    return MeshDataPtr();
+  }
+  const FileHeader & header = *reinterpret_cast<const FileHeader *>(file.data());
+  if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) || VERSION != header.version) {
+    return MeshDataPtr();
+  }
+
+  MeshDataPtr result = std::make_shared<MeshData>();
+  MeshData & mesh = *result;
+  mesh.vertexCount = header.vertexCount;
+  mesh.indexCount = header.indexCount;
+  mesh.hasNormals = 0 != header.hasNormals;
+  mesh.hasTexCoords = 0 != header.hasTexCoords;
+  mesh.hasMaterials = 0 != header.hasMaterials;
+  mesh.indexType = header.indexType;
+  mesh.boundsMin = glm::make_vec3(header.boundsMin);
+  mesh.boundsMax = glm::make_vec3(header.boundsMax);
+  size_t vertexBytes = mesh.stride() * mesh.vertexCount;
+  size_t indexBytes = MeshData::indexSize(mesh.indexType) * mesh.indexCount;
+  size_t materialsEnd = sizeof(FileHeader) + sizeof(FileMaterial) * (size_t)header.materialCount;
+  size_t lodsEnd = materialsEnd + sizeof(FileLod) * (size_t)header.lodCount;
+  if (lodsEnd > header.vertexOffset || header.vertexOffset + vertexBytes > header.indexOffset ||
+      header.indexOffset + indexBytes > file.size()) {
+    return MeshDataPtr();
+  }
+
+  const FileMaterial * materials = reinterpret_cast<const FileMaterial *>(file.data() + sizeof(FileHeader));
+  for (uint32_t i = 0; i < header.materialCount; ++i) {
+    Material material;
+    material.name = std::string(materials[i].name, strnlen(materials[i].name, MAX_MATERIAL_NAME));
+    material.diffuse = glm::make_vec4(materials[i].diffuse);
+    mesh.materials.push_back(material);
+  }
+  const FileLod * lods = reinterpret_cast<const FileLod *>(file.data() + materialsEnd);
+  for (uint32_t i = 0; i < header.lodCount; ++i) {
+    if ((size_t)lods[i].indexOffset + lods[i].indexCount > mesh.indexCount) {
+      return MeshDataPtr();
+    }
+    Lod lod = { lods[i].indexOffset, lods[i].indexCount, lods[i].error };
+    mesh.lods.push_back(lod);
+  }
+  // The file stays mapped as long as the mesh data does
+  mesh.vertices = file.subView(header.vertexOffset, vertexBytes);
+  mesh.indices = file.subView(header.indexOffset, indexBytes);
+  return result;
+}
+
+void MeshData::setIndices(const std::vector<uint32_t> & source) {
+  indexCount = (uint32_t)source.size();
+  if (vertexCount <= 0x10000) {
+    indexType = GL_UNSIGNED_SHORT;
+    std::vector<uint8_t> result(indexCount * sizeof(GLushort));
+    std::copy(source.begin(), source.end(), reinterpret_cast<GLushort *>(result.data()));
+    indices = ResourceView::adopt(std::move(result));
+  } else {
+    indexType = GL_UNSIGNED_INT;
+    std::vector<uint8_t> result(indexCount * sizeof(GLuint));
+    std::copy(source.begin(), source.end(), reinterpret_cast<GLuint *>(result.data()));
+    indices = ResourceView::adopt(std::move(result));
+  }
+}
+
+std::vector<uint32_t> MeshData::getIndices() const {
+  std::vector<uint32_t> result(indexCount);
+  if (GL_UNSIGNED_SHORT == indexType) {
+    const GLushort * source = reinterpret_cast<const GLushort *>(indices.data());
+    std::copy(source, source + indexCount, result.begin());
+  } else {
+    const GLuint * source = reinterpret_cast<const GLuint *>(indices.data());
+    std::copy(source, source + indexCount, result.begin());
+  }
+  return result;
+}
+
+std::vector<uint8_t> MeshData::toFile() const {
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.vertexCount = vertexCount;
+  header.indexCount = indexCount;
+  header.hasNormals = hasNormals ? 1 : 0;
+  header.hasTexCoords = hasTexCoords ? 1 : 0;
+  header.hasMaterials = hasMaterials ? 1 : 0;
+  header.indexType = indexType;
+  header.materialCount = (uint32_t)materials.size();
+  header.lodCount = (uint32_t)lods.size();
+  size_t materialsEnd = sizeof(FileHeader) + sizeof(FileMaterial) * materials.size();
+  header.vertexOffset = (uint32_t)align(materialsEnd + sizeof(FileLod) * lods.size());
+  header.indexOffset = (uint32_t)align(header.vertexOffset + vertices.size());
+  memcpy(header.boundsMin, &boundsMin.x, sizeof(header.boundsMin));
+  memcpy(header.boundsMax, &boundsMax.x, sizeof(header.boundsMax));
+
+  std::vector<uint8_t> result(header.indexOffset + indices.size(), 0);
+  memcpy(result.data(), &header, sizeof(header));
+  FileMaterial * fileMaterials = reinterpret_cast<FileMaterial *>(result.data() + sizeof(FileHeader));
+  for (size_t i = 0; i < materials.size(); ++i) {
+    if (materials[i].name.size() > MAX_MATERIAL_NAME) {
+      FAIL("Material name %s is too long", materials[i].name.c_str());
+    }
+    memcpy(fileMaterials[i].name, materials[i].name.data(), materials[i].name.size());
+    memcpy(fileMaterials[i].diffuse, &materials[i].diffuse.x, sizeof(fileMaterials[i].diffuse));
+  }
+  FileLod * fileLods = reinterpret_cast<FileLod *>(result.data() + materialsEnd);
+  for (size_t i = 0; i < lods.size(); ++i) {
+    fileLods[i].indexOffset = lods[i].indexOffset;
+    fileLods[i].indexCount = lods[i].indexCount;
+    fileLods[i].error = lods[i].error;
+  }
+  memcpy(result.data() + header.vertexOffset, vertices.data(), vertices.size());
+  memcpy(result.data() + header.indexOffset, indices.data(), indices.size());
+  return result;
+}
+
+MeshDataPtr MeshData::decodeCtm(const ResourceView & data) {
+  DecodedCache & cache = DecodedCache::instance();
+  uint64_t key = 0;
+  if (cache.isEnabled()) {
+    key = DecodedCache::key(data, "ctm mesh");
+    MeshDataPtr cached = findCached(key);
+    if (cached) {
+      return cached;
+    }
+  }
+
+  CTMimporter importer;
+  ResourceView remaining = data;
+  importer.LoadCustom(readView, &remaining);
+  MeshDataPtr result = std::make_shared<MeshData>();
+  MeshData & mesh = *result;
+  mesh.vertexCount = importer.GetInteger(CTM_VERTEX_COUNT);
+  mesh.indexCount = importer.GetInteger(CTM_TRIANGLE_COUNT) * 3;
+  mesh.hasNormals = 0 != importer.GetInteger(CTM_HAS_NORMALS);
+  mesh.hasTexCoords = 0 != importer.GetInteger(CTM_UV_MAP_COUNT);
+
+  // The one copy out of the importer, straight into the final layout
+  const float * positions = importer.GetFloatArray(CTM_VERTICES);
+  const float * normals = mesh.hasNormals ? importer.GetFloatArray(CTM_NORMALS) : nullptr;
+  const float * texCoords = mesh.hasTexCoords ? importer.GetFloatArray(CTM_UV_MAP_1) : nullptr;
+  std::vector<uint8_t> vertices(mesh.stride() * mesh.vertexCount);
+  float * out = reinterpret_cast<float *>(vertices.data());
+  for (size_t i = 0; i < mesh.vertexCount; ++i) {
+    *out++ = positions[i * 3 + 0];
+    *out++ = positions[i * 3 + 1];
+    *out++ = positions[i * 3 + 2];
+    if (normals) {
+      *out++ = normals[i * 3 + 0];
+      *out++ = normals[i * 3 + 1];
+      *out++ = normals[i * 3 + 2];
+    }
+    if (texCoords) {
+      *out++ = texCoords[i * 2 + 0];
+      *out++ = texCoords[i * 2 + 1];
+    }
+  }
+  mesh.vertices = ResourceView::adopt(std::move(vertices));
+  const CTMuint * indices = importer.GetIntegerArray(CTM_INDICES);
+  optimize(mesh, std::vector<uint32_t>(indices, indices + mesh.indexCount));
+
+  if (cache.isEnabled()) {
+    storeCached(mesh, key);
+  }
+  return result;
+}
+
+MeshDataPtr MeshData::decodeObj(const ResourceView & data, const Opener & open) {
+  // The material libraries are read first, as their colors go into the
+  // mesh and so have to be part of the cache key
+  std::vector<ResourceView> libraries;
+  if (open) {
+    ObjReader reader(data);
+    while (reader.nextLine()) {
+      if ("mtllib" == reader.token()) {
+        libraries.push_back(open(reader.rest()));
+      }
+      reader.skipLine();
+    }
+  }
+
+  DecodedCache & cache = DecodedCache::instance();
+  uint64_t key = 0;
+  if (cache.isEnabled()) {
+    key = DecodedCache::key(data, "obj mesh");
+    for (const ResourceView & library : libraries) {
+      key = key * 1099511628211ULL ^ DecodedCache::key(library, "obj materials");
+    }
+    MeshDataPtr cached = findCached(key);
+    if (cached) {
+      return cached;
+    }
+  }
+
+  std::vector<vec3> positions, normals;
+  std::vector<vec2> texCoords;
+  MeshDataPtr result = std::make_shared<MeshData>();
+  MeshData & mesh = *result;
+  int material = -1;
+
+  // Face corners sharing every attribute share a vertex
+  typedef std::array<int, 4> Corner;
+  std::map<Corner, uint32_t> corners;
+  std::vector<Corner> vertices;
+  std::vector<uint32_t> indices;
+
+  ObjReader reader(data);
+  while (reader.nextLine()) {
+    std::string command = reader.token();
+    if ("v" == command) {
+      float x = reader.number(), y = reader.number(), z = reader.number();
+      positions.push_back(vec3(x, y, z));
+    } else if ("vn" == command) {
+      float x = reader.number(), y = reader.number(), z = reader.number();
+      normals.push_back(vec3(x, y, z));
+    } else if ("vt" == command) {
+      float u = reader.number(), v = reader.number();
+      texCoords.push_back(vec2(u, v));
+    } else if ("usemtl" == command) {
+      // Numbered in order of first use
+      std::string name = reader.rest();
+      material = -1;
+      for (size_t i = 0; i < mesh.materials.size(); ++i) {
+        if (mesh.materials[i].name == name) {
+          material = (int)i;
+        }
+      }
+      if (material < 0) {
+        material = (int)mesh.materials.size();
+        mesh.materials.push_back(Material());
+        mesh.materials.back().name = name;
+      }
+    } else if ("f" == command) {
+      // Polygons become triangle fans
+      std::vector<uint32_t> face;
+      for (std::string token = reader.token(); !token.empty(); token = reader.token()) {
+        Corner corner = { { -1, -1, -1, material } };
+        size_t first = token.find('/');
+        corner[0] = objIndex(token.substr(0, first), positions.size());
+        if (std::string::npos != first) {
+          size_t second = token.find('/', first + 1);
+          std::string texCoord = token.substr(first + 1, second - first - 1);
+          if (!texCoord.empty()) {
+            corner[1] = objIndex(texCoord, texCoords.size());
+          }
+          if (std::string::npos != second) {
+            corner[2] = objIndex(token.substr(second + 1), normals.size());
+          }
+        }
+        if (corner[0] < 0 || corner[0] >= (int)positions.size() ||
+            corner[1] >= (int)texCoords.size() || corner[2] >= (int)normals.size()) {
+          FAIL("OBJ face refers to a missing vertex: %s", token.c_str());
+        }
+        auto itr = corners.find(corner);
+        if (corners.end() == itr) {
+          itr = corners.insert({ corner, (uint32_t)vertices.size() }).first;
+          vertices.push_back(corner);
+        }
+        face.push_back(itr->second);
+      }
+      for (size_t i = 2; i < face.size(); ++i) {
+        indices.push_back(face[0]);
+        indices.push_back(face[i - 1]);
+        indices.push_back(face[i]);
+      }
+    }
+    reader.skipLine();
+  }
+
+  mesh.vertexCount = (uint32_t)vertices.size();
+  mesh.indexCount = (uint32_t)indices.size();
+  mesh.hasNormals = !normals.empty();
+  mesh.hasTexCoords = !texCoords.empty();
+  mesh.hasMaterials = !mesh.materials.empty();
+  std::vector<uint8_t> interleaved(mesh.stride() * mesh.vertexCount);
+  float * out = reinterpret_cast<float *>(interleaved.data());
+  for (const Corner & corner : vertices) {
+    const vec3 & position = positions[corner[0]];
+    *out++ = position.x;
+    *out++ = position.y;
+    *out++ = position.z;
+    if (mesh.hasNormals) {
+      vec3 normal = corner[2] < 0 ? vec3() : normals[corner[2]];
+      *out++ = normal.x;
+      *out++ = normal.y;
+      *out++ = normal.z;
+    }
+    if (mesh.hasTexCoords) {
+      vec2 texCoord = corner[1] < 0 ? vec2() : texCoords[corner[1]];
+      *out++ = texCoord.x;
+      *out++ = texCoord.y;
+    }
+    if (mesh.hasMaterials) {
+      *out++ = (float)std::max(corner[3], 0);
+    }
+  }
+  mesh.vertices = ResourceView::adopt(std::move(interleaved));
+  optimize(mesh, indices);
+
+  for (const ResourceView & library : libraries) {
+    if (!library.empty()) {
+      readMaterialLibrary(library, mesh.materials);
+    }
+  }
+
+  if (cache.isEnabled()) {
+    storeCached(mesh, key);
+  }
+  return result;
+}
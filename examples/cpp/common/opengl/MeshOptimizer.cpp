@@ -0,0 +1,239 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const int MeshOptimizer::CACHE_SIZE;
+const int MeshOptimizer::FIFO_SIZE;
+
+namespace {
+  // The tuning from Forsyth's paper
+  const float CACHE_DECAY_POWER = 1.5f;
+  const float LAST_TRIANGLE_SCORE = 0.75f;
+  const float VALENCE_BOOST_SCALE = 2.0f;
+  const float VALENCE_BOOST_POWER = 0.5f;
+
+  struct VertexState {
+    int cachePosition{ -1 };
+    // Triangles not yet emitted, the first ones in its adjacency range
+    uint32_t remaining{ 0 };
+    uint32_t adjacency{ 0 };
+    float score{ 0 };
+  };
+
+  float vertexScore(const VertexState & vertex) {
+    if (0 == vertex.remaining) {
+      return -1.0f;
+    }
+    float score = 0;
+    if (vertex.cachePosition >= 0) {
+      if (vertex.cachePosition < 3) {
+        // Favouring the triangle just emitted leads to strips, which are
+        // worse than fans in an LRU cache, so the last three get a fixed score
+        score = LAST_TRIANGLE_SCORE;
+      } else {
+        float scale = 1.0f / (MeshOptimizer::CACHE_SIZE - 3);
+        score = powf(1.0f - (vertex.cachePosition - 3) * scale, CACHE_DECAY_POWER);
+      }
+    }
+    // Vertices with few triangles left are finished off first, so they
+    // don't have to come back into the cache later
+    return score + VALENCE_BOOST_SCALE * powf((float)vertex.remaining, -VALENCE_BOOST_POWER);
+  }
+}
+
+MeshOptimizer::Stats MeshOptimizer::optimize(MeshData & mesh, const std::vector<uint32_t> & indices) {
+  PROFILE_ZONE("MeshOptimizer::optimize");
+  Stats stats;
+  stats.verticesBefore = mesh.vertexCount;
+  stats.trianglesBefore = (uint32_t)(indices.size() / 3);
+  stats.acmrBefore = acmr(indices, mesh.vertexCount);
+
+  std::vector<uint32_t> result = indices;
+  deduplicate(mesh, result);
+  result = orderTriangles(result, mesh.vertexCount);
+  orderVertices(mesh, result);
+  mesh.setIndices(result);
+
+  stats.verticesAfter = mesh.vertexCount;
+  stats.trianglesAfter = (uint32_t)(result.size() / 3);
+  stats.acmrAfter = acmr(result, mesh.vertexCount);
+  return stats;
+}
+
+float MeshOptimizer::acmr(const std::vector<uint32_t> & indices, size_t vertexCount, int cacheSize) {
+  if (indices.size() < 3) {
+    return 0;
+  }
+  // A vertex is in the FIFO while fewer than cacheSize misses have
+  // happened since it went in
+  std::vector<int64_t> entered(vertexCount, INT64_MIN / 2);
+  int64_t misses = 0;
+  for (uint32_t index : indices) {
+    if (misses - entered[index] >= cacheSize) {
+      entered[index] = misses++;
+    }
+  }
+  return (float)misses / (float)(indices.size() / 3);
+}
+
+void MeshOptimizer::deduplicate(MeshData & mesh, std::vector<uint32_t> & indices) {
+  size_t stride = mesh.stride();
+  std::unordered_map<std::string, uint32_t> unique;
+  std::vector<uint32_t> remap(mesh.vertexCount);
+  std::vector<uint8_t> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+    const uint8_t * vertex = mesh.vertices.data() + i * stride;
+    auto inserted = unique.insert({ std::string((const char *)vertex, stride), (uint32_t)unique.size() });
+    if (inserted.second) {
+      vertices.insert(vertices.end(), vertex, vertex + stride);
+    }
+    remap[i] = inserted.first->second;
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+    if (a == b || b == c || c == a) {
+      continue;
+    }
+    indices[count++] = a;
+    indices[count++] = b;
+    indices[count++] = c;
+  }
+  indices.resize(count);
+
+  if (unique.size() != mesh.vertexCount) {
+    mesh.vertexCount = (uint32_t)unique.size();
+    mesh.vertices = ResourceView::adopt(std::move(vertices));
+  }
+}
+
+std::vector<uint32_t> MeshOptimizer::orderTriangles(const std::vector<uint32_t> & indices, size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  std::vector<VertexState> vertices(vertexCount);
+  for (uint32_t index : indices) {
+    ++vertices[index].remaining;
+  }
+  uint32_t offset = 0;
+  for (VertexState & vertex : vertices) {
+    vertex.adjacency = offset;
+    offset += vertex.remaining;
+    vertex.score = vertexScore(vertex);
+  }
+  std::vector<uint32_t> adjacency(offset);
+  {
+    std::vector<uint32_t> filled(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+      uint32_t index = indices[i];
+      adjacency[vertices[index].adjacency + filled[index]++] = (uint32_t)(i / 3);
+    }
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  int64_t best = -1;
+  float bestScore = -1;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    float score = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score +
+      vertices[indices[t * 3 + 2]].score;
+    if (score > bestScore) {
+      bestScore = score;
+      best = t;
+    }
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  std::vector<uint32_t> cache, newCache;
+  size_t nextUnemitted = 0;
+  while (result.size() < triangleCount * 3) {
+    if (best < 0) {
+      // Nothing in the cache has triangles left, so start on the next
+      // piece of the mesh
+      while (emitted[nextUnemitted]) {
+        ++nextUnemitted;
+      }
+      best = nextUnemitted;
+    }
+    emitted[best] = true;
+    const uint32_t * triangle = &indices[best * 3];
+    newCache.assign(triangle, triangle + 3);
+    for (int i = 0; i < 3; ++i) {
+      result.push_back(triangle[i]);
+      // Move the triangle past the end of the vertex's remaining ones
+      VertexState & vertex = vertices[triangle[i]];
+      uint32_t * begin = &adjacency[vertex.adjacency];
+      uint32_t * last = begin + vertex.remaining - 1;
+      *std::find(begin, last + 1, (uint32_t)best) = *last;
+      *last = (uint32_t)best;
+      --vertex.remaining;
+    }
+    for (uint32_t index : cache) {
+      if (index != triangle[0] && index != triangle[1] && index != triangle[2]) {
+        newCache.push_back(index);
+      }
+    }
+
+    // Rescore everything that moved, including the vertices that just fell
+    // out of the cache, then pick the best of their triangles
+    for (size_t i = 0; i < newCache.size(); ++i) {
+      VertexState & vertex = vertices[newCache[i]];
+      vertex.cachePosition = i < (size_t)CACHE_SIZE ? (int)i : -1;
+      vertex.score = vertexScore(vertex);
+    }
+    best = -1;
+    bestScore = -1;
+    for (uint32_t index : newCache) {
+      const VertexState & vertex = vertices[index];
+      for (uint32_t i = 0; i < vertex.remaining; ++i) {
+        uint32_t t = adjacency[vertex.adjacency + i];
+        float score = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score +
+          vertices[indices[t * 3 + 2]].score;
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+    if (newCache.size() > (size_t)CACHE_SIZE) {
+      newCache.resize(CACHE_SIZE);
+    }
+    cache.swap(newCache);
+  }
+  return result;
+}
+
+void MeshOptimizer::orderVertices(MeshData & mesh, std::vector<uint32_t> & indices) {
+  size_t stride = mesh.stride();
+  std::vector<uint32_t> remap(mesh.vertexCount, UINT32_MAX);
+  std::vector<uint8_t> vertices;
+  vertices.reserve(mesh.vertices.size());
+  uint32_t next = 0;
+  for (uint32_t & index : indices) {
+    if (UINT32_MAX == remap[index]) {
+      remap[index] = next++;
+      const uint8_t * vertex = mesh.vertices.data() + index * stride;
+      vertices.insert(vertices.end(), vertex, vertex + stride);
+    }
+    index = remap[index];
+  }
+  // Vertices no triangle uses are dropped
+  mesh.vertexCount = next;
+  mesh.vertices = ResourceView::adopt(std::move(vertices));
+}
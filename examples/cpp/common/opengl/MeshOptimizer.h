@@ -0,0 +1,62 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Reorders a mesh for the GPU, run on every mesh as it is decoded, so both
+ * the MeshConverter output and meshes decoded at runtime get it.
+ *
+ *  - Vertices with identical bytes are merged, and degenerate triangles
+ *    dropped.
+ *  - Triangles are ordered for the post-transform vertex cache, with Tom
+ *    Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ *  - Vertices are ordered by first use, so vertex fetches walk the buffer
+ *    forwards.
+ *  - Indices drop to 16 bits when every vertex fits.
+ *
+ * ACMR, the average number of vertices shaded per triangle, is measured
+ * with a FIFO cache of FIFO_SIZE entries, which is roughly what current
+ * hardware behaves like.  Lower is better, 0.5 is the ideal for a regular
+ * grid and 3 is no reuse at all.
+ */
+class MeshOptimizer {
+public:
+  // The LRU cache the triangle order is optimised for
+  static const int CACHE_SIZE = 32;
+  static const int FIFO_SIZE = 16;
+
+  struct Stats {
+    uint32_t verticesBefore{ 0 };
+    uint32_t verticesAfter{ 0 };
+    uint32_t trianglesBefore{ 0 };
+    uint32_t trianglesAfter{ 0 };
+    float acmrBefore{ 0 };
+    float acmrAfter{ 0 };
+  };
+
+  // Replaces the vertices and indices of the mesh
+  static Stats optimize(MeshData & mesh, const std::vector<uint32_t> & indices);
+
+  static float acmr(const std::vector<uint32_t> & indices, size_t vertexCount, int cacheSize = FIFO_SIZE);
+  // Merges vertices with identical bytes and drops the triangles left degenerate
+  static void deduplicate(MeshData & mesh, std::vector<uint32_t> & indices);
+  static std::vector<uint32_t> orderTriangles(const std::vector<uint32_t> & indices, size_t vertexCount);
+  // Renumbers the vertices in order of first use
+  static void orderVertices(MeshData & mesh, std::vector<uint32_t> & indices);
+};
@@ -0,0 +1,325 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const size_t MeshSimplifier::MAX_LODS;
+const uint32_t MeshSimplifier::MIN_TRIANGLES;
+const float MeshSimplifier::MIN_REDUCTION = 0.25f;
+
+namespace {
+  // The most a collapse may turn a triangle, about 75 degrees
+  const float MAX_TURN_COSINE = 0.25f;
+
+  // A symmetric 4x4 matrix, the upper triangle row by row
+  struct Quadric {
+    double a[10];
+    // How many planes went in
+    double weight;
+
+    Quadric() : weight(0) {
+      std::fill(a, a + 10, 0.0);
+    }
+
+    void addPlane(const vec3 & n, float d) {
+      a[0] += n.x * n.x; a[1] += n.x * n.y; a[2] += n.x * n.z; a[3] += n.x * d;
+      a[4] += n.y * n.y; a[5] += n.y * n.z; a[6] += n.y * d;
+      a[7] += n.z * n.z; a[8] += n.z * d;
+      a[9] += d * d;
+      weight += 1;
+    }
+
+    void add(const Quadric & other) {
+      for (int i = 0; i < 10; ++i) {
+        a[i] += other.a[i];
+      }
+      weight += other.weight;
+    }
+
+    // The sum of the squared distances from the point to the planes
+    double evaluate(const vec3 & p) const {
+      double x = p.x, y = p.y, z = p.z;
+      return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+        a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+        a[7] * z * z + 2 * a[8] * z + a[9];
+    }
+  };
+
+  struct Collapse {
+    double cost;
+    // The mean squared distance to the planes, as the sum overstates how
+    // far the surface moves where many planes meet
+    double error;
+    uint32_t from;
+    uint32_t to;
+
+    bool operator <(const Collapse & other) const {
+      return cost < other.cost;
+    }
+  };
+
+  // Collapses edges, keeping the quadrics and the error between calls so a
+  // chain of calls builds a chain of levels
+  class Collapser {
+    std::vector<vec3> positions;
+    // Vertices sharing a position share an id, which the quadrics use
+    std::vector<uint32_t> positionIds;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> locked;
+    std::vector<uint32_t> indices;
+    double maxError{ 0 };
+
+  public:
+    Collapser(const MeshData & mesh, const std::vector<uint32_t> & source) : indices(source) {
+      size_t floats = mesh.stride() / sizeof(float);
+      const float * vertex = reinterpret_cast<const float *>(mesh.vertices.data());
+      std::map<std::array<float, 3>, uint32_t> ids;
+      std::vector<uint32_t> sharing;
+      for (uint32_t i = 0; i < mesh.vertexCount; ++i, vertex += floats) {
+        positions.push_back(vec3(vertex[0], vertex[1], vertex[2]));
+        std::array<float, 3> key = { { vertex[0], vertex[1], vertex[2] } };
+        auto inserted = ids.insert({ key, (uint32_t)ids.size() });
+        positionIds.push_back(inserted.first->second);
+        if (inserted.second) {
+          sharing.push_back(0);
+        }
+        ++sharing[inserted.first->second];
+      }
+
+      // Seams, where a position has several vertices
+      locked.resize(mesh.vertexCount);
+      for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+        locked[i] = sharing[positionIds[i]] > 1;
+      }
+      // Borders, where an edge between two positions has one triangle, or
+      // where the mesh isn't manifold
+      std::map<std::pair<uint32_t, uint32_t>, int> edges;
+      for (size_t t = 0; t < indices.size(); t += 3) {
+        for (int i = 0; i < 3; ++i) {
+          uint32_t a = positionIds[indices[t + i]], b = positionIds[indices[t + (i + 1) % 3]];
+          ++edges[std::make_pair(std::min(a, b), std::max(a, b))];
+        }
+      }
+      std::vector<bool> borderPositions(sharing.size(), false);
+      for (const auto & edge : edges) {
+        if (2 != edge.second) {
+          borderPositions[edge.first.first] = borderPositions[edge.first.second] = true;
+        }
+      }
+
+      quadrics.resize(sharing.size());
+      for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+        if (borderPositions[positionIds[i]]) {
+          locked[i] = true;
+        }
+      }
+      for (size_t t = 0; t < indices.size(); t += 3) {
+        const vec3 & p0 = positions[indices[t]];
+        vec3 normal = glm::cross(positions[indices[t + 1]] - p0, positions[indices[t + 2]] - p0);
+        float length = glm::length(normal);
+        if (length <= 0) {
+          continue;
+        }
+        normal /= length;
+        for (int i = 0; i < 3; ++i) {
+          quadrics[positionIds[indices[t + i]]].addPlane(normal, -glm::dot(normal, p0));
+        }
+      }
+    }
+
+    const std::vector<uint32_t> & getIndices() const {
+      return indices;
+    }
+
+    // The largest collapse so far, as a distance
+    float getError() const {
+      return (float)sqrt(maxError);
+    }
+
+    void simplify(size_t targetTriangles) {
+      while (indices.size() / 3 > targetTriangles) {
+        // Each collapse inside the mesh removes two triangles
+        size_t excess = indices.size() / 3 - targetTriangles;
+        if (!pass(excess / 2 + 1)) {
+          break;
+        }
+      }
+    }
+
+  private:
+    // An edge whose ends share more than the two neighbours across it would
+    // fold the surface onto itself when it collapses
+    bool keepsManifold(const uint32_t * fromTriangles, uint32_t fromCount,
+        const uint32_t * toTriangles, uint32_t toCount) const {
+      std::vector<uint32_t> fromNeighbours, toNeighbours;
+      for (uint32_t i = 0; i < fromCount; ++i) {
+        for (int k = 0; k < 3; ++k) {
+          fromNeighbours.push_back(positionIds[indices[fromTriangles[i] * 3 + k]]);
+        }
+      }
+      for (uint32_t i = 0; i < toCount; ++i) {
+        for (int k = 0; k < 3; ++k) {
+          toNeighbours.push_back(positionIds[indices[toTriangles[i] * 3 + k]]);
+        }
+      }
+      std::sort(fromNeighbours.begin(), fromNeighbours.end());
+      fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+      std::sort(toNeighbours.begin(), toNeighbours.end());
+      toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+      std::vector<uint32_t> shared;
+      std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(),
+        toNeighbours.begin(), toNeighbours.end(), std::back_inserter(shared));
+      // Both ends are in both lists, as well as the two across the edge
+      return shared.size() <= 4;
+    }
+
+    bool flips(uint32_t from, uint32_t to, const uint32_t * triangles, uint32_t count) const {
+      for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t * triangle = &indices[triangles[i] * 3];
+        vec3 before[3], after[3];
+        bool removed = false;
+        for (int k = 0; k < 3; ++k) {
+          before[k] = after[k] = positions[triangle[k]];
+          if (triangle[k] == from) {
+            after[k] = positions[to];
+          } else if (positionIds[triangle[k]] == positionIds[to]) {
+            removed = true;
+          }
+        }
+        if (removed) {
+          continue;
+        }
+        vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        // Turning a long way is as bad as flipping, as it leaves triangles
+        // standing on edge
+        if (glm::dot(normalBefore, normalAfter) <= MAX_TURN_COSINE * glm::length(normalBefore) * glm::length(normalAfter)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Collapses as many independent edges as it can, cheapest first
+    size_t pass(size_t maxCollapses) {
+      size_t vertexCount = positions.size();
+      std::vector<uint32_t> offsets(vertexCount + 1, 0);
+      for (uint32_t index : indices) {
+        ++offsets[index + 1];
+      }
+      for (size_t i = 0; i < vertexCount; ++i) {
+        offsets[i + 1] += offsets[i];
+      }
+      std::vector<uint32_t> adjacency(indices.size());
+      {
+        std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+          adjacency[filled[indices[i]]++] = (uint32_t)(i / 3);
+        }
+      }
+
+      std::vector<Collapse> collapses;
+      for (size_t t = 0; t < indices.size(); t += 3) {
+        for (int i = 0; i < 3; ++i) {
+          for (int j = 1; j < 3; ++j) {
+            uint32_t from = indices[t + i], to = indices[t + (i + j) % 3];
+            if (locked[from] || positionIds[from] == positionIds[to]) {
+              continue;
+            }
+            Quadric combined = quadrics[positionIds[from]];
+            combined.add(quadrics[positionIds[to]]);
+            double cost = std::max(0.0, combined.evaluate(positions[to]));
+            Collapse collapse = { cost, combined.weight > 0 ? cost / combined.weight : 0, from, to };
+            collapses.push_back(collapse);
+          }
+        }
+      }
+      std::sort(collapses.begin(), collapses.end());
+
+      std::vector<uint32_t> remap(vertexCount);
+      for (uint32_t i = 0; i < vertexCount; ++i) {
+        remap[i] = i;
+      }
+      std::vector<bool> touched(vertexCount, false);
+      size_t collapsed = 0;
+      for (const Collapse & collapse : collapses) {
+        if (collapsed >= maxCollapses) {
+          break;
+        }
+        if (touched[collapse.from] || touched[collapse.to]) {
+          continue;
+        }
+        const uint32_t * triangles = &adjacency[offsets[collapse.from]];
+        uint32_t count = offsets[collapse.from + 1] - offsets[collapse.from];
+        const uint32_t * toTriangles = &adjacency[offsets[collapse.to]];
+        uint32_t toCount = offsets[collapse.to + 1] - offsets[collapse.to];
+        if (!keepsManifold(triangles, count, toTriangles, toCount) ||
+            flips(collapse.from, collapse.to, triangles, count)) {
+          continue;
+        }
+        remap[collapse.from] = collapse.to;
+        quadrics[positionIds[collapse.to]].add(quadrics[positionIds[collapse.from]]);
+        maxError = std::max(maxError, collapse.error);
+        // Nothing around the collapse can change again this pass, as the
+        // adjacency and the flip checks would be out of date
+        for (uint32_t i = 0; i < count; ++i) {
+          for (int k = 0; k < 3; ++k) {
+            touched[indices[triangles[i] * 3 + k]] = true;
+          }
+        }
+        ++collapsed;
+      }
+
+      size_t kept = 0;
+      for (size_t t = 0; t < indices.size(); t += 3) {
+        uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+        if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[c] == positionIds[a]) {
+          continue;
+        }
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+      }
+      indices.resize(kept);
+      return collapsed;
+    }
+  };
+}
+
+void MeshSimplifier::generateLods(MeshData & mesh) {
+  PROFILE_ZONE("MeshSimplifier::generateLods");
+  std::vector<uint32_t> all = mesh.getIndices();
+  MeshData::Lod full = { 0, (uint32_t)all.size(), 0 };
+  mesh.lods.assign(1, full);
+
+  Collapser collapser(mesh, all);
+  size_t triangles = all.size() / 3;
+  while (mesh.lods.size() < MAX_LODS && triangles / 2 >= MIN_TRIANGLES) {
+    collapser.simplify(triangles / 2);
+    size_t remaining = collapser.getIndices().size() / 3;
+    if (remaining > triangles * (1.0f - MIN_REDUCTION)) {
+      break;
+    }
+    std::vector<uint32_t> level = MeshOptimizer::orderTriangles(collapser.getIndices(), mesh.vertexCount);
+    MeshData::Lod lod = { (uint32_t)all.size(), (uint32_t)level.size(), collapser.getError() };
+    all.insert(all.end(), level.begin(), level.end());
+    mesh.lods.push_back(lod);
+    triangles = remaining;
+  }
+  mesh.setIndices(all);
+}
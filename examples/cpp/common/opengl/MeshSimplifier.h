@@ -0,0 +1,46 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Builds the levels of detail of a mesh, run on every mesh as it is
+ * decoded after the MeshOptimizer.  Each level has about half the
+ * triangles of the one before, down to MIN_TRIANGLES, and they all index
+ * the same vertices, so a level costs only its indices.
+ *
+ * Simplification collapses edges in order of quadric error (Garland and
+ * Heckbert), moving a vertex onto one of its neighbours so no new
+ * vertices are needed.  Vertices on borders and on attribute seams, where
+ * several vertices share a position, never move, which keeps the outline
+ * and the texture mapping intact at the cost of simplifying less around
+ * them.  Collapses that would flip a triangle over are skipped.
+ *
+ * Each level records its error as a distance in model units, which
+ * LodSelector turns into pixels.
+ */
+class MeshSimplifier {
+public:
+  static const size_t MAX_LODS = 6;
+  static const uint32_t MIN_TRIANGLES = 64;
+  // A level must drop at least this share of the triangles to be kept
+  static const float MIN_REDUCTION;
+
+  // Replaces the mesh's indices with those of all its levels
+  static void generateLods(MeshData & mesh);
+};
@@ -0,0 +1,252 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const int ShaderPreprocessor::MAX_DEPTH;
+
+static bool startsWith(const std::string & line, size_t offset, const char * prefix) {
+  return 0 == line.compare(offset, strlen(prefix), prefix);
+}
+
+// The directive of a line, with its leading '#' and whitespace skipped, or
+// npos if the line isn't one
+static size_t directive(const std::string & line) {
+  size_t hash = line.find_first_not_of(" \t");
+  if (std::string::npos == hash || '#' != line[hash]) {
+    return std::string::npos;
+  }
+  return line.find_first_not_of(" \t", hash + 1);
+}
+
+static std::vector<std::string> splitLines(const std::string & source) {
+  std::vector<std::string> result;
+  std::istringstream in(source);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && '\r' == line.back()) {
+      line.pop_back();
+    }
+    result.push_back(line);
+  }
+  return result;
+}
+
+static std::string directoryOf(const std::string & path) {
+  size_t slash = path.find_last_of('/');
+  return std::string::npos == slash ? std::string() : path.substr(0, slash + 1);
+}
+
+ShaderPreprocessor::ShaderPreprocessor()
+  : reader([](const std::string & path, std::string & result) {
+    ResourceView view = Platform::getResourceView(path);
+    if (view.empty()) {
+      return false;
+    }
+    result = view.toString();
+    return true;
+  }) {
+}
+
+ShaderPreprocessor::ShaderPreprocessor(Reader reader) : reader(reader) {
+}
+
+ShaderPreprocessor::Reader ShaderPreprocessor::noIncludes() {
+  return [](const std::string &, std::string &) {
+    return false;
+  };
+}
+
+bool ShaderPreprocessor::process(const std::string & path, const std::string & source,
+    std::string & result, const Defines & defines) {
+  PROFILE_ZONE("ShaderPreprocessor::process", path);
+  files.clear();
+  error.clear();
+  result.clear();
+  if (!expand(path, source, &defines, 0, result)) {
+    result.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ShaderPreprocessor::resolve(const std::string & from, const std::string & include,
+    std::string & resolved, std::string & source) {
+  std::string relative = directoryOf(from) + include;
+  if (reader(relative, source)) {
+    resolved = relative;
+    return true;
+  }
+  if (reader(include, source)) {
+    resolved = include;
+    return true;
+  }
+  error = Platform::format("Unable to find %s, included from %s", include.c_str(), from.c_str());
+  return false;
+}
+
+bool ShaderPreprocessor::expand(const std::string & path, const std::string & source,
+    const Defines * defines, int depth, std::string & out) {
+  if (depth > MAX_DEPTH) {
+    error = Platform::format("Includes nested too deeply in %s", path.c_str());
+    return false;
+  }
+  int index = (int)files.size();
+  files.push_back(path);
+  std::vector<std::string> lines = splitLines(source);
+
+  // Defines go after #version, which has to come first, or at the very top
+  // of a shader without one
+  bool hasVersion = false;
+  for (const std::string & line : lines) {
+    size_t offset = directive(line);
+    if (std::string::npos != offset && startsWith(line, offset, "version")) {
+      hasVersion = true;
+      break;
+    }
+  }
+  std::string injected;
+  if (defines && !defines->empty()) {
+    for (const auto & define : *defines) {
+      injected += "#define " + define.first + " " + define.second + "\n";
+    }
+  }
+  if (!hasVersion && !injected.empty()) {
+    out += injected + Platform::format("#line 1 %d\n", index);
+  }
+
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const std::string & line = lines[i];
+    int nextLine = (int)i + 2;
+    size_t offset = directive(line);
+    if (std::string::npos == offset) {
+      out += line + "\n";
+    } else if (startsWith(line, offset, "version")) {
+      // Only the top level file gets to declare the version
+      if (0 == depth) {
+        out += line + "\n";
+        if (!injected.empty()) {
+          out += injected + Platform::format("#line %d %d\n", nextLine, index);
+        }
+      } else {
+        out += "\n";
+      }
+    } else if (startsWith(line, offset, "pragma") &&
+        std::string::npos != line.find("permutation", offset)) {
+      out += "\n";
+    } else if (startsWith(line, offset, "include")) {
+      size_t open = line.find_first_of("\"<", offset);
+      size_t close = std::string::npos == open ? open : line.find_first_of("\">", open + 1);
+      if (std::string::npos == close) {
+        error = Platform::format("Malformed include in %s line %d", path.c_str(), (int)i + 1);
+        return false;
+      }
+      std::string included, includedPath;
+      if (!resolve(path, line.substr(open + 1, close - open - 1), includedPath, included)) {
+        return false;
+      }
+      if (files.end() == std::find(files.begin(), files.end(), includedPath)) {
+        out += Platform::format("#line 1 %d\n", (int)files.size());
+        if (!expand(includedPath, included, nullptr, depth + 1, out)) {
+          return false;
+        }
+        out += Platform::format("#line %d %d\n", nextLine, index);
+      } else {
+        out += "\n";
+      }
+    } else {
+      out += line + "\n";
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> ShaderPreprocessor::declaredFlags(const std::string & source) {
+  std::vector<std::string> result;
+  for (const std::string & line : splitLines(source)) {
+    size_t offset = directive(line);
+    if (std::string::npos == offset || !startsWith(line, offset, "pragma")) {
+      continue;
+    }
+    std::istringstream tokens(line.substr(offset + strlen("pragma")));
+    std::string token;
+    if (!(tokens >> token) || "permutation" != token) {
+      continue;
+    }
+    while (tokens >> token) {
+      if (result.end() == std::find(result.begin(), result.end(), token)) {
+        result.push_back(token);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<ShaderPreprocessor::Flags> ShaderPreprocessor::permutations(const std::vector<std::string> & flags) {
+  std::vector<Flags> result;
+  size_t count = (size_t)1 << flags.size();
+  for (size_t mask = 0; mask < count; ++mask) {
+    Flags permutation;
+    for (size_t i = 0; i < flags.size(); ++i) {
+      if (mask & ((size_t)1 << i)) {
+        permutation.insert(flags[i]);
+      }
+    }
+    result.push_back(permutation);
+  }
+  return result;
+}
+
+ShaderPreprocessor::Defines ShaderPreprocessor::definesFor(const Flags & flags) {
+  Defines result;
+  for (const std::string & flag : flags) {
+    result[flag] = "1";
+  }
+  return result;
+}
+
+std::string ShaderPreprocessor::extension(const Flags & flags) {
+  std::string result;
+  for (const std::string & flag : flags) {
+    result += "." + flag;
+  }
+  return result + ".glsl";
+}
+
+namespace oria {
+
+  std::string loadShaderSource(Resource resource, const ShaderPreprocessor::Flags & flags) {
+#ifndef RIFT_DEBUG
+    // Debug builds always preprocess, as the baked copy in the archive
+    // goes stale as soon as the shader is edited on disk
+    ResourceView baked = Platform::getDerivedResourceView(resource, ShaderPreprocessor::extension(flags));
+    if (!baked.empty()) {
+      return baked.toString();
+    }
+#endif
+    // Resource shaders ship with the build, so a broken one is a bug
+    ShaderPreprocessor preprocessor;
+    std::string result;
+    if (!preprocessor.process(Platform::getResourceName(resource),
+        Platform::getResourceString(resource), result, ShaderPreprocessor::definesFor(flags))) {
+      FAIL("%s", preprocessor.getError().c_str());
+    }
+    return result;
+  }
+
+}
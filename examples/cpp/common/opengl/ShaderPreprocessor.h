@@ -0,0 +1,100 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Expands GLSL before it reaches the driver.  #include "file" pulls in
+ * another shader file, defines are injected right after the #version line,
+ * and a shader can declare the flags it is specialised on with
+ *
+ *   #pragma permutation LIT INSTANCED
+ *
+ * so each combination of them is its own program, picked with #ifdef
+ * rather than a branch at runtime.
+ *
+ * The ShaderBaker tool expands every permutation of the shaders at build
+ * time into the resource archive, as derived resources named like
+ * "shaders/Lit.vs.INSTANCED.LIT.glsl".  oria::loadShaderSource prefers
+ * those in release builds and falls back to expanding the source itself.
+ * Debug builds always expand the source, so shaders edited on disk work
+ * without rebuilding the archive.
+ *
+ * Includes are looked for next to the including file, then from the
+ * resource root, and each file is only included once.  #line directives
+ * keep compiler messages accurate: the source string number of a message
+ * is the index of its file in getFiles().
+ */
+class ShaderPreprocessor {
+public:
+  static const int MAX_DEPTH = 16;
+
+  typedef std::set<std::string> Flags;
+  typedef std::map<std::string, std::string> Defines;
+  // Reads a file by its path relative to the resource root, returning false
+  // if there is no such file
+  typedef std::function<bool(const std::string & path, std::string & result)> Reader;
+
+  // Reads through Platform, from the archive or the resource directory
+  ShaderPreprocessor();
+  ShaderPreprocessor(Reader reader);
+
+  // Returns false if an include is missing, malformed or nested too deeply,
+  // with the reason in getError().  Shaders can come from a user, so this
+  // never FAILs.
+  bool process(const std::string & path, const std::string & source,
+    std::string & result, const Defines & defines = Defines());
+
+  // The files of the last process() call, the top level one first
+  const std::vector<std::string> & getFiles() const {
+    return files;
+  }
+
+  const std::string & getError() const {
+    return error;
+  }
+
+  // A reader that finds nothing, so source typed into an editor can't pull
+  // in arbitrary files
+  static Reader noIncludes();
+
+  // The flags a source declares, in order
+  static std::vector<std::string> declaredFlags(const std::string & source);
+  // Every combination of the flags, starting with none of them
+  static std::vector<Flags> permutations(const std::vector<std::string> & flags);
+  // Each flag defined as 1
+  static Defines definesFor(const Flags & flags);
+  // The extension of the derived resource holding a permutation
+  static std::string extension(const Flags & flags);
+
+private:
+  bool expand(const std::string & path, const std::string & source, const Defines * defines,
+    int depth, std::string & out);
+  bool resolve(const std::string & from, const std::string & include,
+    std::string & resolved, std::string & source);
+
+  Reader reader;
+  std::vector<std::string> files;
+  std::string error;
+};
+
+namespace oria {
+  // A resource shader with the flags defined and its includes resolved
+  std::string loadShaderSource(Resource resource,
+    const ShaderPreprocessor::Flags & flags = ShaderPreprocessor::Flags());
+}
@@ -19,24 +19,226 @@
 
 #include "Common.h"
 
+const size_t UniformTable::MAX_CACHED_SIZE;
+
+namespace {
+  struct TableEntry {
+    std::weak_ptr<oglplus::Program> program;
+    UniformTable::Pointer table;
+  };
+  typedef std::unordered_map<const oglplus::Program *, TableEntry> TableMap;
+
+  // Programs can be linked on a worker with a shared context
+  std::mutex tablesMutex;
+
+  TableMap & tables() {
+    static TableMap tables;
+    static bool registeredShutdown = false;
+    if (!registeredShutdown) {
+      Platform::addShutdownHook([&] {
+        tables.clear();
+      });
+      registeredShutdown = true;
+    }
+    return tables;
+  }
+}
+
+UniformTable::Pointer UniformTable::forProgram(const ProgramPtr & program) {
+  {
+    std::lock_guard<std::mutex> guard(tablesMutex);
+    TableMap & map = tables();
+    TableMap::const_iterator itr = map.find(program.get());
+    // A program freed and another allocated in its place leaves the
+    // pointer matching, but not the weak reference
+    if (itr != map.end() && itr->second.program.lock() == program) {
+      return itr->second.table;
+    }
+  }
+  return resolve(program);
+}
+
+UniformTable::Pointer UniformTable::resolve(const ProgramPtr & program) {
+  PROFILE_ZONE("UniformTable::resolve");
+  Pointer result(new UniformTable());
+  GLuint name = oglplus::GetName(*program);
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(name, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(name, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<GLchar> buffer(std::max(maxLength, 1));
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(name, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+    std::string uniform(buffer.data(), length);
+    Slot slot;
+    slot.location = glGetUniformLocation(name, uniform.c_str());
+    // Members of uniform blocks have no location
+    if (slot.location < 0) {
+      continue;
+    }
+    int index = (int)result->slots.size();
+    result->slots.push_back(slot);
+    result->names[uniform] = index;
+    // Arrays are reported as "Name[0]", but are also found by "Name"
+    size_t bracket = uniform.find('[');
+    if (std::string::npos != bracket) {
+      result->names[uniform.substr(0, bracket)] = index;
+    }
+  }
+  result->modelView = result->find("ModelView");
+  result->projection = result->find("Projection");
+  result->lights.ambient = result->find("Ambient");
+  result->lights.count = result->find("LightCount");
+  result->lights.colors = result->find("LightColor");
+  result->lights.positions = result->find("LightPosition");
+  GLuint block = glGetUniformBlockIndex(name, FrameUniforms::BLOCK_NAME);
+  if (GL_INVALID_INDEX != block) {
+    glUniformBlockBinding(name, block, FrameUniforms::BINDING);
+    result->frameBlock = true;
+  }
+
+  std::lock_guard<std::mutex> guard(tablesMutex);
+  TableMap & map = tables();
+  for (TableMap::iterator itr = map.begin(); itr != map.end(); ) {
+    if (itr->second.program.expired()) {
+      itr = map.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  TableEntry & entry = map[program.get()];
+  entry.program = program;
+  entry.table = result;
+  return result;
+}
+
+int UniformTable::find(const std::string & name) const {
+  std::unordered_map<std::string, int>::const_iterator itr = names.find(name);
+  return itr == names.end() ? -1 : itr->second;
+}
+
+bool UniformTable::update(int index, const void * value, size_t size) {
+  Slot & slot = slots[index];
+  if (size > MAX_CACHED_SIZE) {
+    slot.size = 0;
+    return true;
+  }
+  if (slot.size == size && 0 == memcmp(slot.value, value, size)) {
+    return false;
+  }
+  memcpy(slot.value, value, size);
+  slot.size = size;
+  return true;
+}
+
 namespace oria {
 
-  void compileProgram(ProgramPtr & result, std::string vs, std::string fs) {
+  static bool hasProgramBinary() {
+    static GLint formats = -1;
+    if (formats < 0) {
+      formats = 0;
+      // Some drivers expose the entry points but no formats to use them with
+      if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+      }
+    }
+    return formats > 0;
+  }
+
+  static std::string glString(GLenum name) {
+    const GLubyte * result = glGetString(name);
+    return result ? std::string((const char *)result) : std::string();
+  }
+
+  uint64_t programBinaryKey(const ResourceView & vs, const ResourceView & fs) {
+    // A binary is only good for the driver build that produced it
+    static const std::string driver = glString(GL_VENDOR) + ":" +
+      glString(GL_RENDERER) + ":" + glString(GL_VERSION);
+    return DecodedCache::key(vs, Platform::format("program %016" PRIx64 " ",
+      ResourceArchive::hash(fs.data(), fs.size())) + driver);
+  }
+
+  bool loadProgramBinary(ProgramPtr & result, uint64_t key) {
+    DecodedCache & cache = DecodedCache::instance();
+    if (!cache.isEnabled() || !hasProgramBinary()) {
+      return false;
+    }
+    ResourceView blob = cache.find(key);
+    if (blob.size() <= sizeof(GLenum)) {
+      return false;
+    }
+    PROFILE_ZONE("loadProgramBinary");
+    GLenum format = *reinterpret_cast<const GLenum *>(blob.data());
+    ProgramPtr program(new oglplus::Program());
+    GLuint name = oglplus::GetName(*program);
+    glProgramBinary(name, format, blob.data() + sizeof(GLenum), (GLsizei)(blob.size() - sizeof(GLenum)));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(name, GL_LINK_STATUS, &linked);
+    if (GL_TRUE != linked) {
+      // Rejected after a driver update, say.  The caller compiles from
+      // source and stores a fresh binary over this one.
+      return false;
+    }
+    result = program;
+    UniformTable::resolve(result);
+    return true;
+  }
+
+  void prepareProgramBinary(ProgramPtr & program) {
+    if (DecodedCache::instance().isEnabled() && hasProgramBinary()) {
+      glProgramParameteri(oglplus::GetName(*program), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+  }
+
+  void storeProgramBinary(const ProgramPtr & program, uint64_t key) {
+    DecodedCache & cache = DecodedCache::instance();
+    if (!cache.isEnabled() || !hasProgramBinary()) {
+      return;
+    }
+    GLuint name = oglplus::GetName(*program);
+    GLint length = 0;
+    glGetProgramiv(name, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+      return;
+    }
+    GLenum format = 0;
+    std::vector<uint8_t> binary(length);
+    glGetProgramBinary(name, length, &length, &format, binary.data());
+    if (length <= 0) {
+      return;
+    }
+    cache.store(key, {
+      ResourceView(&format, sizeof(format)),
+      ResourceView(binary.data(), length)
+    });
+  }
+
+  void compileProgram(ProgramPtr & result, const ResourceView & vs, const ResourceView & fs) {
+    PROFILE_ZONE("compileProgram");
     using namespace oglplus;
+    uint64_t key = programBinaryKey(vs, fs);
+    if (loadProgramBinary(result, key)) {
+      return;
+    }
     try {
       result = ProgramPtr(new Program());
       // attach the shaders to the program
       result->AttachShader(
         VertexShader()
-        .Source(GLSLSource(vs))
+        .Source(GLSLSource(StrCRef(vs.chars(), vs.size())))
         .Compile()
         );
       result->AttachShader(
         FragmentShader()
-        .Source(GLSLSource(fs))
+        .Source(GLSLSource(StrCRef(fs.chars(), fs.size())))
         .Compile()
         );
+      prepareProgramBinary(result);
       result->Link();
+      storeProgramBinary(result, key);
+      UniformTable::resolve(result);
     } catch (ProgramBuildError & err) {
       SAY_ERR((const char*)err.Message);
       result.reset();
@@ -45,6 +247,10 @@ namespace oria {
 
 
   ProgramPtr loadProgram(Resource vs, Resource fs) {
+    return loadProgram(vs, fs, ShaderPreprocessor::Flags());
+  }
+
+  ProgramPtr loadProgram(Resource vs, Resource fs, const ShaderPreprocessor::Flags & flags) {
     typedef std::unordered_map<std::string, ProgramPtr> ProgramMap;
 
     static ProgramMap programs;
@@ -57,12 +263,16 @@ namespace oria {
     }
 
     std::string key = Resources::getResourcePath(vs) + ":" +
-      Resources::getResourcePath(fs);
+      Resources::getResourcePath(fs) + ShaderPreprocessor::extension(flags);
     if (!programs.count(key)) {
+      PROFILE_ZONE("loadProgram", key);
+      // Camera and lights come from the shared block rather than per draw
+      std::string vsSource = FrameUniforms::promote(loadShaderSource(vs, flags));
+      std::string fsSource = FrameUniforms::promote(loadShaderSource(fs, flags));
       ProgramPtr result;
       compileProgram(result,
-        Platform::getResourceString(vs),
-        Platform::getResourceString(fs));
+        ResourceView(vsSource.data(), vsSource.size()),
+        ResourceView(fsSource.data(), fsSource.size()));
       // FIXME
       // Caching shaders is problematic, since it requires you to set ALL 
       // uniforms any time you use the shader, because you don't know if you're 
@@ -79,10 +289,13 @@ namespace oria {
   }
 
   ProgramPtr loadProgram(const std::string & vsFile, const std::string & fsFile) {
+    PROFILE_ZONE("loadProgram", vsFile + ":" + fsFile);
+    std::string vs = oria::readFile(vsFile);
+    std::string fs = oria::readFile(fsFile);
     ProgramPtr result;
     compileProgram(result,
-      oria::readFile(vsFile),
-      oria::readFile(fsFile));
+      ResourceView(vs.data(), vs.size()),
+      ResourceView(fs.data(), fs.size()));
     return result;
   }
 
@@ -96,4 +309,31 @@ namespace oria {
     return activeUniforms;
   }
 
+  void uploadUniform(GLint location, GLsizei count, const GLint * values) {
+    glUniform1iv(location, count, values);
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const GLuint * values) {
+    glUniform1uiv(location, count, values);
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const GLfloat * values) {
+    glUniform1fv(location, count, values);
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const vec2 * values) {
+    glUniform2fv(location, count, glm::value_ptr(*values));
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const vec3 * values) {
+    glUniform3fv(location, count, glm::value_ptr(*values));
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const vec4 * values) {
+    glUniform4fv(location, count, glm::value_ptr(*values));
+  }
+
+  void uploadUniform(GLint location, GLsizei count, const mat4 * values) {
+    glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(*values));
+  }
 }
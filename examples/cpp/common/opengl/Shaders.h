@@ -26,7 +26,151 @@ typedef std::shared_ptr<oglplus::Program> ProgramPtr;
 typedef std::map<std::string, GLuint> UniformMap;
 
 namespace oria {
+  // Null if the shaders fail to compile or link, with the log written out.
+  // Linked programs are kept as binaries in the DecodedCache, so later runs
+  // skip compilation entirely.
+  void compileProgram(ProgramPtr & result, const ResourceView & vs, const ResourceView & fs);
   ProgramPtr loadProgram(Resource vs, Resource fs);
+  // The permutation of the shaders with the flags defined, see ShaderPreprocessor
+  ProgramPtr loadProgram(Resource vs, Resource fs, const ShaderPreprocessor::Flags & flags);
   ProgramPtr loadProgram(const std::string & vsFile, const std::string & fsFile);
   UniformMap getActiveUniforms(ProgramPtr & program);
+
+  // The pieces of compileProgram, for code that builds its own programs.
+  // Keys cover both sources and the driver, whose binaries don't carry over.
+  uint64_t programBinaryKey(const ResourceView & vs, const ResourceView & fs);
+  // False on a miss, or when the driver rejects the stored binary
+  bool loadProgramBinary(ProgramPtr & result, uint64_t key);
+  // Must come before linking for the driver to keep the binary
+  void prepareProgramBinary(ProgramPtr & program);
+  void storeProgramBinary(const ProgramPtr & program, uint64_t key);
 }
+
+/**
+ * The uniforms of a linked program, with their locations looked up once
+ * and the last value uploaded to each remembered.  Setting a uniform
+ * through a UniformHandle then costs no string lookup, and setting the
+ * value it already holds costs no GL call at all.
+ *
+ * compileProgram builds the table as soon as a program links; programs
+ * linked elsewhere get theirs on first use.  Values written behind the
+ * table's back, through oglplus::Uniform say, leave it stale, so code
+ * using a program should stick to handles.
+ */
+class UniformTable {
+public:
+  // Values larger than this, like arrays, are always uploaded
+  static const size_t MAX_CACHED_SIZE = sizeof(mat4);
+  typedef std::shared_ptr<UniformTable> Pointer;
+
+  // The table for a program, rebuilt if the program has been replaced
+  static Pointer forProgram(const ProgramPtr & program);
+  // Rebuilds the table of a program that has just been linked
+  static Pointer resolve(const ProgramPtr & program);
+
+  // The slot for a uniform, or -1 for one the program doesn't use
+  int find(const std::string & name) const;
+
+  GLint location(int slot) const {
+    return slots[slot].location;
+  }
+
+  // False if the slot already holds these bytes, otherwise records them
+  bool update(int slot, const void * value, size_t size);
+
+  void invalidate(int slot) {
+    slots[slot].size = 0;
+  }
+
+  // Every draw sets these, so they skip the name lookup
+  int getModelView() const {
+    return modelView;
+  }
+
+  int getProjection() const {
+    return projection;
+  }
+
+  // The loose light uniforms of programs without the frame block
+  struct LightSlots {
+    int ambient{ -1 };
+    int count{ -1 };
+    int colors{ -1 };
+    int positions{ -1 };
+  };
+
+  const LightSlots & getLights() const {
+    return lights;
+  }
+
+  // Whether the program reads camera and light state from FrameUniforms
+  bool hasFrameBlock() const {
+    return frameBlock;
+  }
+
+private:
+  struct Slot {
+    GLint location;
+    size_t size{ 0 };
+    uint8_t value[MAX_CACHED_SIZE];
+  };
+
+  std::vector<Slot> slots;
+  std::unordered_map<std::string, int> names;
+  int modelView{ -1 };
+  int projection{ -1 };
+  LightSlots lights;
+  bool frameBlock{ false };
+};
+
+namespace oria {
+  // Uploads to the program in use
+  void uploadUniform(GLint location, GLsizei count, const GLint * values);
+  void uploadUniform(GLint location, GLsizei count, const GLuint * values);
+  void uploadUniform(GLint location, GLsizei count, const GLfloat * values);
+  void uploadUniform(GLint location, GLsizei count, const vec2 * values);
+  void uploadUniform(GLint location, GLsizei count, const vec3 * values);
+  void uploadUniform(GLint location, GLsizei count, const vec4 * values);
+  void uploadUniform(GLint location, GLsizei count, const mat4 * values);
+}
+
+// A typed uniform of one program.  Like oglplus::Uniform, setting it
+// writes to the program currently in use.  Handles for uniforms the
+// program doesn't use are inactive and ignore sets.
+template <typename T>
+class UniformHandle {
+public:
+  UniformHandle() {}
+
+  UniformHandle(const ProgramPtr & program, const std::string & name)
+    : table(UniformTable::forProgram(program)) {
+    slot = table->find(name);
+  }
+
+  UniformHandle(const UniformTable::Pointer & table, int slot)
+    : table(table), slot(slot) {
+  }
+
+  bool isActive() const {
+    return slot >= 0;
+  }
+
+  void set(const T & value) {
+    if (slot >= 0 && table->update(slot, &value, sizeof(T))) {
+      oria::uploadUniform(table->location(slot), 1, &value);
+    }
+  }
+
+  void setValues(GLsizei count, const T * values) {
+    if (slot >= 0) {
+      table->invalidate(slot);
+      oria::uploadUniform(table->location(slot), count, values);
+    }
+  }
+
+private:
+  UniformTable::Pointer table;
+  int slot{ -1 };
+};
+
+typedef UniformHandle<mat4> Mat4Handle;
@@ -0,0 +1,366 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const GLsizei TextureAtlas::DEFAULT_SIZE;
+const GLsizei TextureAtlas::DEFAULT_MAX_LAYERS;
+const GLsizei TextureAtlas::MAX_IMAGE_SIZE;
+const GLsizei TextureAtlas::PADDING;
+
+// The atlas bound to GL_TEXTURE_2D_ARRAY, tracked here so drawing a region
+// doesn't have to query the binding.  Nothing else in the tree binds array
+// textures, and the Atlas sampler reads unit 0, which every draw leaves
+// active.  Only the context drawing the UI uses the atlases.
+static GLuint boundAtlas = 0;
+
+static void bindAtlas(GLuint name) {
+  if (name != boundAtlas) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, name);
+    boundAtlas = name;
+  }
+}
+
+TextureAtlas::TextureAtlas(GLsizei size, GLsizei maxLayers) : size(size), maxLayers(maxLayers) {
+  texture = TexturePtr(new oglplus::Texture());
+  bindAtlas(oglplus::GetName(*texture));
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+  grow();
+}
+
+// Storage is mutable, as immutable storage can't change its layer count.
+// Reallocating discards the old layers, so they're parked in a scratch
+// texture and copied back on the GPU.  Drivers without glCopyImageSubData
+// take a round trip through client memory instead.
+void TextureAtlas::grow() {
+  PROFILE_ZONE("TextureAtlas::grow");
+  GLsizei count = (GLsizei)layers.size();
+  GLuint name = oglplus::GetName(*texture);
+  bindAtlas(name);
+  if (!count) {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  } else if (GLEW_VERSION_4_3 || GLEW_ARB_copy_image) {
+    GLuint scratch = 0;
+    glGenTextures(1, &scratch);
+    bindAtlas(scratch);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, count, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glCopyImageSubData(name, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+      scratch, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, count);
+    bindAtlas(name);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, count + 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glCopyImageSubData(scratch, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+      name, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, count);
+    glDeleteTextures(1, &scratch);
+  } else {
+    std::vector<uint8_t> previous((size_t)size * size * 4 * count);
+    // Rows of RGBA8 are always 4 byte aligned, but the caller's packing
+    // state is put back as it was
+    GLint packAlignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, previous.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, count + 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, count,
+      GL_RGBA, GL_UNSIGNED_BYTE, previous.data());
+  }
+  layers.push_back(Skyline({ { 0, 0, size } }));
+}
+
+// The height the image would sit at if its left edge were at the node
+bool TextureAtlas::fit(const Skyline & skyline, size_t index, GLsizei width, GLsizei height, GLsizei & outY) const {
+  GLsizei x = skyline[index].x;
+  if (x + width > size) {
+    return false;
+  }
+  GLsizei y = 0;
+  for (GLsizei remaining = width; remaining > 0; remaining -= skyline[index++].width) {
+    y = std::max(y, skyline[index].y);
+    if (y + height > size) {
+      return false;
+    }
+  }
+  outY = y;
+  return true;
+}
+
+bool TextureAtlas::pack(Skyline & skyline, GLsizei width, GLsizei height, GLsizei & outX, GLsizei & outY) {
+  size_t best = skyline.size();
+  GLsizei bestTop = size + 1, bestWidth = size + 1;
+  for (size_t i = 0; i < skyline.size(); ++i) {
+    GLsizei y;
+    if (!fit(skyline, i, width, height, y)) {
+      continue;
+    }
+    // Lowest top edge first, then the narrowest ledge, to keep it flat
+    if (y + height < bestTop || (y + height == bestTop && skyline[i].width < bestWidth)) {
+      best = i;
+      bestTop = y + height;
+      bestWidth = skyline[i].width;
+      outY = y;
+    }
+  }
+  if (best == skyline.size()) {
+    return false;
+  }
+
+  outX = skyline[best].x;
+  Node added = { outX, outY + height, width };
+  skyline.insert(skyline.begin() + best, added);
+  // Trim or drop the nodes now underneath the new one
+  for (size_t i = best + 1; i < skyline.size(); ) {
+    Node & node = skyline[i];
+    GLsizei covered = added.x + added.width - node.x;
+    if (covered <= 0) {
+      break;
+    }
+    if (covered < node.width) {
+      node.x += covered;
+      node.width -= covered;
+      break;
+    }
+    skyline.erase(skyline.begin() + i);
+  }
+  // Merge neighbours at the same height
+  for (size_t i = 0; i + 1 < skyline.size(); ) {
+    if (skyline[i].y == skyline[i + 1].y) {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    } else {
+      ++i;
+    }
+  }
+  return true;
+}
+
+TextureAtlas::Region TextureAtlas::add(const uvec2 & imageSize, const uint8_t * rgba) {
+  PROFILE_ZONE("TextureAtlas::add");
+  Region result;
+  if (imageSize.x > (GLuint)MAX_IMAGE_SIZE || imageSize.y > (GLuint)MAX_IMAGE_SIZE) {
+    return result;
+  }
+  GLsizei width = imageSize.x + PADDING * 2, height = imageSize.y + PADDING * 2;
+  GLsizei x = 0, y = 0;
+  for (size_t layer = 0; ; ++layer) {
+    if (layer == layers.size()) {
+      if ((GLsizei)layers.size() >= maxLayers) {
+        return result;
+      }
+      grow();
+    }
+    if (pack(layers[layer], width, height, x, y)) {
+      result.layer = (GLint)layer;
+      break;
+    }
+  }
+
+  // The gutter repeats the nearest edge pixel
+  std::vector<uint8_t> padded((size_t)width * height * 4);
+  for (GLsizei row = 0; row < height; ++row) {
+    GLsizei sourceRow = std::min(std::max(row - PADDING, 0), (GLsizei)imageSize.y - 1);
+    const uint8_t * source = rgba + (size_t)sourceRow * imageSize.x * 4;
+    uint8_t * out = &padded[(size_t)row * width * 4];
+    for (GLsizei column = 0; column < PADDING; ++column) {
+      memcpy(out + column * 4, source, 4);
+      memcpy(out + (PADDING + imageSize.x + column) * 4, source + (imageSize.x - 1) * 4, 4);
+    }
+    memcpy(out + PADDING * 4, source, imageSize.x * 4);
+  }
+
+  bindAtlas(oglplus::GetName(*texture));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, result.layer, width, height, 1,
+    GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+  usedArea += (size_t)width * height;
+
+  result.texture = texture;
+  result.size = imageSize;
+  result.transform = vec4(
+    (float)(x + PADDING) / size, (float)(y + PADDING) / size,
+    (float)imageSize.x / size, (float)imageSize.y / size);
+  return result;
+}
+
+TextureAtlas::Region TextureAtlas::add(const ImagePtr & image) {
+  using namespace oglplus;
+  uvec2 imageSize(image->Width(), image->Height());
+  if (image->Type() != PixelDataType::UnsignedByte || !imageSize.x || !imageSize.y) {
+    return Region();
+  }
+
+  const uint8_t * pixels = (const uint8_t *)image->RawData();
+  std::vector<uint8_t> rgba(imageSize.x * imageSize.y * 4);
+  size_t rowBytes = imageSize.x * image->Channels();
+  switch (image->Format()) {
+  case PixelDataFormat::RGBA:
+    ImageKernels::blit(pixels, rowBytes, rgba.data(), rowBytes, rowBytes, imageSize.y);
+    break;
+  case PixelDataFormat::BGRA:
+    ImageKernels::bgraToRgba(pixels, rowBytes, rgba.data(), imageSize.x * 4, imageSize.x, imageSize.y);
+    break;
+  case PixelDataFormat::RGB:
+    ImageKernels::rgbToRgba(pixels, rowBytes, rgba.data(), imageSize.x * 4, imageSize.x, imageSize.y);
+    break;
+  case PixelDataFormat::BGR:
+    ImageKernels::bgrToRgba(pixels, rowBytes, rgba.data(), imageSize.x * 4, imageSize.x, imageSize.y);
+    break;
+  default:
+    return Region();
+  }
+  return add(imageSize, rgba.data());
+}
+
+float TextureAtlas::getOccupancy() const {
+  return (float)usedArea / ((float)size * size * layers.size());
+}
+
+namespace oria {
+
+  typedef std::shared_ptr<TextureAtlas> TextureAtlasPtr;
+
+  static std::vector<TextureAtlasPtr> & sharedAtlases() {
+    static std::vector<TextureAtlasPtr> atlases;
+    static bool registeredShutdown = false;
+    if (!registeredShutdown) {
+      Platform::addShutdownHook([&] {
+        atlases.clear();
+        // The names may be reused once the textures are gone
+        boundAtlas = 0;
+      });
+      registeredShutdown = true;
+    }
+    return atlases;
+  }
+
+  // Tries each shared atlas in turn, starting a new one once they're full
+  template <typename F>
+  static TextureAtlas::Region addShared(const uvec2 & size, F add) {
+    TextureAtlas::Region result;
+    if (size.x > (GLuint)TextureAtlas::MAX_IMAGE_SIZE || size.y > (GLuint)TextureAtlas::MAX_IMAGE_SIZE) {
+      return result;
+    }
+    std::vector<TextureAtlasPtr> & atlases = sharedAtlases();
+    for (const TextureAtlasPtr & atlas : atlases) {
+      result = add(*atlas);
+      if (result.valid()) {
+        return result;
+      }
+    }
+    atlases.push_back(TextureAtlasPtr(new TextureAtlas()));
+    return add(*atlases.back());
+  }
+
+  TextureAtlas::Region addAtlasRegion(const uvec2 & size, const uint8_t * rgba) {
+    return addShared(size, [&](TextureAtlas & atlas) {
+      return atlas.add(size, rgba);
+    });
+  }
+
+  TextureAtlas::Region loadAtlasRegion(Resource resource) {
+    static std::map<Resource, TextureAtlas::Region> regions;
+    static bool registeredShutdown = false;
+    if (!registeredShutdown) {
+      Platform::addShutdownHook([&] {
+        regions.clear();
+      });
+      registeredShutdown = true;
+    }
+
+    if (regions.count(resource)) {
+      return regions[resource];
+    }
+    ImagePtr image = loadImage(resource);
+    uvec2 size(image->Width(), image->Height());
+    TextureAtlas::Region result = addShared(size, [&](TextureAtlas & atlas) {
+      return atlas.add(image);
+    });
+    if (!result.valid()) {
+      FAIL("Unable to pack %s into a texture atlas, images over %d pixels need a texture of their own",
+        Resources::getResourcePath(resource).c_str(), TextureAtlas::MAX_IMAGE_SIZE);
+    }
+    regions[resource] = result;
+    return result;
+  }
+
+  static const char * ATLAS_VS = R"SHADER(
+uniform mat4 ModelView = mat4(1);
+uniform vec4 AtlasTransform = vec4(0, 0, 1, 1);
+
+in vec4 Position;
+in vec2 TexCoord;
+
+out vec2 vTexCoord;
+
+void main() {
+  vTexCoord = AtlasTransform.xy + TexCoord * AtlasTransform.zw;
+  gl_Position = Projection * ModelView * Position;
+}
+)SHADER";
+
+  static const char * ATLAS_FS = R"SHADER(#version 330
+uniform sampler2DArray Atlas;
+uniform float AtlasLayer = 0;
+
+in vec2 vTexCoord;
+
+out vec4 FragColor;
+
+void main() {
+  FragColor = texture(Atlas, vec3(vTexCoord, AtlasLayer));
+}
+)SHADER";
+
+  ProgramPtr loadAtlasProgram() {
+    ProgramPtr result;
+    // Projection comes from the shared block
+    static const std::string vs = std::string("#version 330\n") +
+      FrameUniforms::DECLARATION + ATLAS_VS;
+    compileProgram(result,
+      ResourceView(vs.data(), vs.size()),
+      ResourceView(ATLAS_FS, strlen(ATLAS_FS)));
+    return result;
+  }
+
+  void renderGeometry(ShapeWrapperPtr & shape, ProgramPtr & program, const TextureAtlas::Region & region) {
+    using namespace oglplus;
+    // Regions of one atlas draw back to back without rebinding
+    bindAtlas(GetName(*region.texture));
+    // Callers keep a program each and draw with it over and over, so the
+    // handles of the last one are kept
+    static const oglplus::Program * handlesProgram = nullptr;
+    static std::weak_ptr<oglplus::Program> handlesOwner;
+    static UniformHandle<GLfloat> layerUniform;
+    static UniformHandle<vec4> transformUniform;
+    if (handlesProgram != program.get() || handlesOwner.expired()) {
+      handlesProgram = program.get();
+      handlesOwner = program;
+      layerUniform = UniformHandle<GLfloat>(program, "AtlasLayer");
+      transformUniform = UniformHandle<vec4>(program, "AtlasTransform");
+    }
+    renderGeometry(shape, program, [&] {
+      layerUniform.set((GLfloat)region.layer);
+      transformUniform.set(region.transform);
+    });
+  }
+}
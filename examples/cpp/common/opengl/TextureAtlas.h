@@ -0,0 +1,105 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Packs small images into the layers of a single 2D array texture, so
+ * anything drawn with them can share one texture binding.
+ *
+ * Each layer is packed with a skyline, placing every image at the lowest
+ * spot it fits.  Images are surrounded by a gutter of their own edge
+ * pixels, so linear filtering never picks up a neighbour.  There are no
+ * mipmaps, so the atlas suits images drawn at roughly their own size, not
+ * tiled or heavily minified ones.
+ *
+ * The atlas starts with a single layer and adds one whenever an image
+ * doesn't fit the ones it has, up to a maximum.  Images larger than
+ * MAX_IMAGE_SIZE are refused, as they gain nothing from sharing a binding
+ * and would waste most of a layer; give them a texture of their own.
+ */
+class TextureAtlas {
+public:
+  static const GLsizei DEFAULT_SIZE = 1024;
+  static const GLsizei DEFAULT_MAX_LAYERS = 8;
+  static const GLsizei MAX_IMAGE_SIZE = 256;
+  static const GLsizei PADDING = 2;
+
+  // Where an image ended up
+  struct Region {
+    TexturePtr texture;
+    GLint layer{ -1 };
+    // Maps the image's own texture coordinates into the layer, as
+    // xy + uv * zw
+    vec4 transform;
+    uvec2 size;
+
+    bool valid() const {
+      return layer >= 0;
+    }
+  };
+
+  TextureAtlas(GLsizei size = DEFAULT_SIZE, GLsizei maxLayers = DEFAULT_MAX_LAYERS);
+
+  // Invalid if the image is too large, the atlas is full or the format is
+  // one it can't hold.  Must be called on the thread owning the context.
+  Region add(const ImagePtr & image);
+  // Tightly packed RGBA8 pixels
+  Region add(const uvec2 & size, const uint8_t * rgba);
+
+  const TexturePtr & getTexture() const {
+    return texture;
+  }
+  // The fraction of the allocated layers' area taken by images and their
+  // gutters
+  float getOccupancy() const;
+
+private:
+  struct Node {
+    GLsizei x;
+    GLsizei y;
+    GLsizei width;
+  };
+  typedef std::vector<Node> Skyline;
+
+  bool fit(const Skyline & skyline, size_t index, GLsizei width, GLsizei height, GLsizei & outY) const;
+  bool pack(Skyline & skyline, GLsizei width, GLsizei height, GLsizei & outX, GLsizei & outY);
+  // Adds a layer, keeping the texture object so existing regions stay valid
+  void grow();
+
+  GLsizei size;
+  GLsizei maxLayers;
+  TexturePtr texture;
+  std::vector<Skyline> layers;
+  size_t usedArea{ 0 };
+};
+
+namespace oria {
+  // A resource image packed into a shared atlas, one of several if they
+  // fill up.  Cached, so asking again returns the same region.  FAILs for
+  // images over TextureAtlas::MAX_IMAGE_SIZE.
+  TextureAtlas::Region loadAtlasRegion(Resource resource);
+  // Tightly packed RGBA8 pixels packed into the shared atlases, for images
+  // that don't come straight from a resource
+  TextureAtlas::Region addAtlasRegion(const uvec2 & size, const uint8_t * rgba);
+  // Draws like the textured shader, but from an atlas region
+  ProgramPtr loadAtlasProgram();
+  // Binds the region's atlas, if it isn't already, and passes the layer
+  // and transform to the AtlasLayer and AtlasTransform uniforms
+  void renderGeometry(ShapeWrapperPtr & shape, ProgramPtr & program, const TextureAtlas::Region & region);
+}
@@ -0,0 +1,188 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const size_t TextureResidency::DEFAULT_BUDGET;
+
+TextureResidency & TextureResidency::instance() {
+  static TextureResidency INSTANCE;
+  static bool registeredShutdown = false;
+  if (!registeredShutdown) {
+    Platform::addShutdownHook([&] {
+      Stats stats = INSTANCE.getStats();
+      SAY("Texture residency: %d textures in %.1f MB, hit rate %.2f, %d evictions",
+        (int)stats.residentCount, stats.residentBytes / (1024.0 * 1024.0), stats.hitRate(), (int)stats.evictions);
+      INSTANCE.clear();
+    });
+    registeredShutdown = true;
+  }
+  return INSTANCE;
+}
+
+TextureResidency::TextureResidency() {
+  const char * env = getenv("ORIA_TEXTURE_BUDGET_MB");
+  if (env && *env) {
+    budget = (size_t)strtoull(env, nullptr, 10) * 1024 * 1024;
+  }
+}
+
+static GLenum bindingFor(GLenum target) {
+  return GL_TEXTURE_CUBE_MAP == target ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D;
+}
+
+size_t TextureResidency::textureBytes(GLenum target, const TexturePtr & texture) {
+  if (!texture) {
+    return 0;
+  }
+  GLint previous = 0;
+  glGetIntegerv(bindingFor(target), &previous);
+  glBindTexture(target, oglplus::GetName(*texture));
+
+  size_t result = 0;
+  int faces = GL_TEXTURE_CUBE_MAP == target ? 6 : 1;
+  GLenum levelTarget = GL_TEXTURE_CUBE_MAP == target ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+  for (GLint level = 0; ; ++level) {
+    GLint width = 0, height = 0, compressed = GL_FALSE;
+    glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+    if (!width || !height) {
+      break;
+    }
+    glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+    size_t levelBytes = 0;
+    if (compressed) {
+      GLint size = 0;
+      glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+      levelBytes = size;
+    } else {
+      // Sum of the component sizes, whatever the format
+      static const GLenum COMPONENTS[] = {
+        GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+        GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE
+      };
+      GLint bits = 0;
+      for (GLenum component : COMPONENTS) {
+        GLint componentBits = 0;
+        glGetTexLevelParameteriv(levelTarget, level, component, &componentBits);
+        bits += componentBits;
+      }
+      levelBytes = (size_t)width * height * ((bits + 7) / 8);
+    }
+    result += levelBytes * faces;
+    // Mutable textures report whatever levels were specified, so stop at 1x1
+    if (1 == width && 1 == height) {
+      break;
+    }
+  }
+
+  glBindTexture(target, previous);
+  return result;
+}
+
+TextureInfo TextureResidency::acquire(const std::string & name, GLenum target, Loader loader) {
+  auto itr = entries.find(name);
+  if (itr != entries.end()) {
+    ++hits;
+    useOrder.splice(useOrder.begin(), useOrder, itr->second.used);
+    return itr->second.info;
+  }
+
+  ++misses;
+  PROFILE_ZONE("TextureResidency::load", name);
+  Entry entry;
+  entry.info = loader();
+  if (!entry.info.tex) {
+    return entry.info;
+  }
+  entry.bytes = textureBytes(target, entry.info.tex);
+  useOrder.push_front(name);
+  entry.used = useOrder.begin();
+  residentBytes += entry.bytes;
+  TextureInfo result = entry.info;
+  textureNames[oglplus::GetName(*entry.info.tex)] = name;
+  entries[name] = entry;
+  trim();
+  return result;
+}
+
+void TextureResidency::touch(const TexturePtr & texture) {
+  if (!texture) {
+    return;
+  }
+  auto name = textureNames.find(oglplus::GetName(*texture));
+  if (name == textureNames.end()) {
+    return;
+  }
+  Entry & entry = entries[name->second];
+  useOrder.splice(useOrder.begin(), useOrder, entry.used);
+}
+
+bool TextureResidency::isResident(const std::string & name) const {
+  return entries.count(name) > 0;
+}
+
+void TextureResidency::evict(const std::string & name) {
+  auto itr = entries.find(name);
+  if (itr == entries.end()) {
+    return;
+  }
+  residentBytes -= itr->second.bytes;
+  textureNames.erase(oglplus::GetName(*itr->second.info.tex));
+  useOrder.erase(itr->second.used);
+  entries.erase(itr);
+}
+
+void TextureResidency::clear() {
+  entries.clear();
+  textureNames.clear();
+  useOrder.clear();
+  residentBytes = 0;
+}
+
+void TextureResidency::setBudget(size_t bytes) {
+  budget = bytes;
+  trim();
+}
+
+void TextureResidency::trim() {
+  // The caller of acquire holds the newest texture, so it's never a candidate
+  auto itr = useOrder.end();
+  while (residentBytes > budget && itr != useOrder.begin()) {
+    --itr;
+    Entry & entry = entries[*itr];
+    if (entry.info.tex.use_count() > 1) {
+      continue;
+    }
+    std::string name = *itr;
+    ++itr;
+    evict(name);
+    ++evictions;
+  }
+}
+
+TextureResidency::Stats TextureResidency::getStats() const {
+  Stats result;
+  result.residentBytes = residentBytes;
+  result.residentCount = entries.size();
+  result.budgetBytes = budget;
+  result.hits = hits;
+  result.misses = misses;
+  result.evictions = evictions;
+  return result;
+}
@@ -0,0 +1,108 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+struct TextureInfo {
+  uvec2 size;
+  TexturePtr tex;
+};
+
+/**
+ * Keeps loaded textures under a budget of GPU memory, evicting the least
+ * recently used ones when it's exceeded.
+ *
+ * Textures are looked up by name with acquire(), which counts as a use and
+ * calls the loader when the texture isn't resident, whether it was never
+ * loaded or was evicted since.  Loaders go back to the resource, and so
+ * through the archive and the decoded image cache, so a reload costs an
+ * upload rather than a decode.
+ *
+ * Code that keeps the pointer from acquire() and binds it frame after frame
+ * should call touch() where it binds, so the use order follows drawing
+ * rather than loading.  Code that asks again every frame, like the skybox
+ * and floor in GlUtils, needn't.
+ *
+ * A texture someone else still holds a pointer to can't be freed, so it is
+ * never evicted, though it counts against the budget.  Long lived holders,
+ * such as function statics or members kept for a whole run, pin their
+ * textures for good; prefer asking again on use.  The budget defaults to
+ * DEFAULT_BUDGET, or ORIA_TEXTURE_BUDGET_MB megabytes if set.
+ *
+ * Must only be used on the thread owning the context.
+ */
+class TextureResidency {
+public:
+  static const size_t DEFAULT_BUDGET = 512 * 1024 * 1024;
+
+  typedef std::function<TextureInfo()> Loader;
+
+  struct Stats {
+    size_t residentBytes{ 0 };
+    size_t residentCount{ 0 };
+    size_t budgetBytes{ 0 };
+    size_t hits{ 0 };
+    size_t misses{ 0 };
+    size_t evictions{ 0 };
+
+    float hitRate() const {
+      return (hits + misses) ? (float)hits / (float)(hits + misses) : 0.0f;
+    }
+  };
+
+  static TextureResidency & instance();
+  // The GPU memory used by every level (and face) of the texture
+  static size_t textureBytes(GLenum target, const TexturePtr & texture);
+
+  // The resident texture for the name, loaded if it isn't.  Target is the
+  // texture's type, GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.
+  TextureInfo acquire(const std::string & name, GLenum target, Loader loader);
+  // Counts as a use of the texture, if it's one of ours
+  void touch(const TexturePtr & texture);
+  bool isResident(const std::string & name) const;
+  void evict(const std::string & name);
+  void clear();
+
+  void setBudget(size_t bytes);
+  size_t getBudget() const {
+    return budget;
+  }
+  Stats getStats() const;
+
+private:
+  struct Entry {
+    TextureInfo info;
+    size_t bytes{ 0 };
+    // Position in the use order
+    std::list<std::string>::iterator used;
+  };
+
+  TextureResidency();
+  void trim();
+
+  std::unordered_map<std::string, Entry> entries;
+  // Entry names by texture object, for touch()
+  std::unordered_map<GLuint, std::string> textureNames;
+  // Most recently used at the front
+  std::list<std::string> useOrder;
+  size_t budget{ DEFAULT_BUDGET };
+  size_t residentBytes{ 0 };
+  size_t hits{ 0 };
+  size_t misses{ 0 };
+  size_t evictions{ 0 };
+};
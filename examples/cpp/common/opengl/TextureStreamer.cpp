@@ -0,0 +1,293 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#include "Common.h"
+
+const size_t TextureStreamer::RING_SIZE;
+const size_t TextureStreamer::REGION_ALIGNMENT;
+
+TextureStreamer & TextureStreamer::instance() {
+  static TextureStreamer INSTANCE;
+  static bool registeredShutdown = false;
+  if (!registeredShutdown) {
+    Platform::addShutdownHook([&]{
+      for (Block & block : INSTANCE.blocks) {
+        if (block.fence) {
+          glDeleteSync(block.fence);
+        }
+      }
+      INSTANCE.blocks.clear();
+      if (INSTANCE.buffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, INSTANCE.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &INSTANCE.buffer);
+        INSTANCE.buffer = 0;
+        INSTANCE.mapped = nullptr;
+      }
+      INSTANCE.supported = -1;
+    });
+    registeredShutdown = true;
+  }
+  return INSTANCE;
+}
+
+bool TextureStreamer::hasImmutableStorage() {
+  return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+}
+
+GLsizei TextureStreamer::mipLevels(const uvec2 & size) {
+  GLsizei levels = 1;
+  for (unsigned int extent = std::max(size.x, size.y); extent > 1; extent >>= 1) {
+    ++levels;
+  }
+  return levels;
+}
+
+GLenum TextureStreamer::sizedFormat(GLenum internalFormat) {
+  switch (internalFormat) {
+  case GL_RED:
+    return GL_R8;
+  case GL_RG:
+    return GL_RG8;
+  case GL_RGB:
+    return GL_RGB8;
+  case GL_RGBA:
+    return GL_RGBA8;
+  default:
+    return internalFormat;
+  }
+}
+
+void TextureStreamer::allocate(GLenum target, GLsizei levels, GLenum internalFormat, const uvec2 & size) {
+  if (hasImmutableStorage()) {
+    glTexStorage2D(target, levels, sizedFormat(internalFormat), size.x, size.y);
+    return;
+  }
+
+  bool cubemap = (GL_TEXTURE_CUBE_MAP == target);
+  for (GLsizei level = 0; level < levels; ++level) {
+    GLsizei width = std::max(1u, size.x >> level);
+    GLsizei height = std::max(1u, size.y >> level);
+    for (int face = 0; face < (cubemap ? 6 : 1); ++face) {
+      GLenum faceTarget = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+      glTexImage2D(faceTarget, level, sizedFormat(internalFormat), width, height, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+size_t TextureStreamer::bytesPerPixel(GLenum format, GLenum type) {
+  switch (type) {
+  case GL_UNSIGNED_BYTE_3_3_2:
+  case GL_UNSIGNED_BYTE_2_3_3_REV:
+    return 1;
+  case GL_UNSIGNED_SHORT_5_6_5:
+  case GL_UNSIGNED_SHORT_5_6_5_REV:
+  case GL_UNSIGNED_SHORT_4_4_4_4:
+  case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+  case GL_UNSIGNED_SHORT_5_5_5_1:
+  case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+    return 2;
+  case GL_UNSIGNED_INT_8_8_8_8:
+  case GL_UNSIGNED_INT_8_8_8_8_REV:
+  case GL_UNSIGNED_INT_10_10_10_2:
+  case GL_UNSIGNED_INT_2_10_10_10_REV:
+    return 4;
+  }
+
+  size_t componentSize = 0;
+  switch (type) {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    componentSize = 1;
+    break;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+  case GL_HALF_FLOAT:
+    componentSize = 2;
+    break;
+  case GL_INT:
+  case GL_UNSIGNED_INT:
+  case GL_FLOAT:
+    componentSize = 4;
+    break;
+  }
+
+  switch (format) {
+  case GL_RED:
+  case GL_GREEN:
+  case GL_BLUE:
+  case GL_ALPHA:
+    return componentSize;
+  case GL_RG:
+    return componentSize * 2;
+  case GL_RGB:
+  case GL_BGR:
+    return componentSize * 3;
+  case GL_RGBA:
+  case GL_BGRA:
+    return componentSize * 4;
+  default:
+    // Unknown, so never staged through the ring
+    return 0;
+  }
+}
+
+bool TextureStreamer::isSupported() {
+  if (supported < 0) {
+    supported = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) && initialize();
+    if (!supported) {
+      SAY("Persistent pixel buffers unavailable, textures upload from client memory");
+    }
+  }
+  return supported > 0;
+}
+
+bool TextureStreamer::initialize() {
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, RING_SIZE, nullptr, flags);
+  mapped = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, RING_SIZE, flags));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (!mapped) {
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    return false;
+  }
+  return true;
+}
+
+TextureStreamer::Region TextureStreamer::reserve(size_t size) {
+  Region result;
+  if (!mapped || 0 == size) {
+    return result;
+  }
+  size = (size + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+  if (size > RING_SIZE) {
+    return result;
+  }
+
+  size_t offset;
+  if (blocks.empty()) {
+    offset = head = 0;
+  } else {
+    size_t tail = blocks.front().offset;
+    if (head > tail) {
+      if (head + size <= RING_SIZE) {
+        offset = head;
+      } else if (size <= tail) {
+        // Wrap, the end of the ring is reclaimed along with the front block
+        offset = 0;
+      } else {
+        return result;
+      }
+    } else if (head < tail && head + size <= tail) {
+      offset = head;
+    } else {
+      // Full
+      return result;
+    }
+  }
+
+  Block block;
+  block.offset = offset;
+  block.size = size;
+  result.id = firstId + blocks.size();
+  blocks.push_back(block);
+  head = offset + size;
+
+  result.data = mapped + offset;
+  result.offset = offset;
+  result.size = size;
+  return result;
+}
+
+void TextureStreamer::finishBlock(uint64_t id, GLsync fence) {
+  if (id < firstId || id >= firstId + blocks.size()) {
+    FAIL("Unknown texture streaming region %d", (int)id);
+  }
+  Block & block = blocks[(size_t)(id - firstId)];
+  block.fence = fence;
+  block.done = true;
+}
+
+void TextureStreamer::retire() {
+  while (!blocks.empty() && blocks.front().done) {
+    Block & block = blocks.front();
+    if (block.fence) {
+      GLenum status = glClientWaitSync(block.fence, 0, 0);
+      if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status) {
+        break;
+      }
+      glDeleteSync(block.fence);
+    }
+    blocks.pop_front();
+    ++firstId;
+  }
+  if (blocks.empty()) {
+    head = 0;
+  }
+}
+
+void TextureStreamer::subImage2D(GLenum target, GLint level, const uvec2 & size, GLenum format, GLenum type, const Region & region) {
+  PROFILE_ZONE("TextureStreamer::subImage2D");
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(target, level, 0, 0, size.x, size.y, format, type, (const void *)region.offset);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  finishBlock(region.id, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void TextureStreamer::subImage2D(GLenum target, GLint level, const uvec2 & size, GLenum format, GLenum type, const void * pixels) {
+  size_t bytes = (size_t)size.x * size.y * bytesPerPixel(format, type);
+  Region region;
+  if (bytes && isSupported()) {
+    retire();
+    region = reserve(bytes);
+  }
+  if (!region.valid()) {
+    PROFILE_ZONE("TextureStreamer::fallback");
+    ++fallbacks;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(target, level, 0, 0, size.x, size.y, format, type, pixels);
+    return;
+  }
+  memcpy(region.data, pixels, bytes);
+  subImage2D(target, level, size, format, type, region);
+}
+
+void TextureStreamer::stream(TexturePtr & texture, const uvec2 & size, GLenum internalFormat, GLenum format, GLenum type, const void * pixels) {
+  GLint width = 0, height = 0;
+  if (texture) {
+    glBindTexture(GL_TEXTURE_2D, oglplus::GetName(*texture));
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+  }
+  if (!texture || (GLint)size.x != width || (GLint)size.y != height) {
+    texture = TexturePtr(new oglplus::Texture());
+    glBindTexture(GL_TEXTURE_2D, oglplus::GetName(*texture));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    allocate(GL_TEXTURE_2D, 1, internalFormat, size);
+  }
+  subImage2D(GL_TEXTURE_2D, 0, size, format, type, pixels);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
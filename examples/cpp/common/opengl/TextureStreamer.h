@@ -0,0 +1,115 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Streams pixel data into textures through a ring of pixel buffer memory,
+ * so an upload is a copy into mapped memory and an asynchronous transfer
+ * instead of a synchronous Image2D call.
+ *
+ * The ring is one buffer, mapped persistently for the life of the context
+ * (GL 4.4 or ARB_buffer_storage).  Space is handed out in FIFO order and
+ * recycled once the fence placed after the upload that read it has
+ * signaled, so nothing is overwritten while the GPU may still be reading
+ * it.  When the ring is unsupported or full the upload falls back to a
+ * plain glTexSubImage2D from client memory.
+ *
+ * Must only be used on the thread owning the context.  Decoders hand over
+ * whole images rather than writing into the ring themselves, as the
+ * decoded cache needs a copy in client memory either way.
+ */
+class TextureStreamer {
+public:
+  static const size_t RING_SIZE = 64 * 1024 * 1024;
+  // Keeps every region suitably aligned for any pixel type
+  static const size_t REGION_ALIGNMENT = 256;
+
+  // The streamer for the rendering context of this process
+  static TextureStreamer & instance();
+
+  // True if textures get immutable storage (GL 4.2 or ARB_texture_storage)
+  static bool hasImmutableStorage();
+  // Levels in a full mip chain for a base level of the given size
+  static GLsizei mipLevels(const uvec2 & size);
+  // The sized equivalent of an unsized internal format, which immutable
+  // storage requires
+  static GLenum sizedFormat(GLenum internalFormat);
+  // Allocates storage for the texture bound to target, immutable if
+  // possible.  Cubemap targets allocate all six faces.
+  static void allocate(GLenum target, GLsizei levels, GLenum internalFormat, const uvec2 & size);
+
+  // False if persistently mapped buffers aren't available, in which case
+  // uploads read straight from client memory
+  bool isSupported();
+
+  // Copies the pixels into the ring, then uploads them into the texture
+  // bound to target
+  void subImage2D(GLenum target, GLint level, const uvec2 & size, GLenum format, GLenum type, const void * pixels);
+
+  // Replaces the whole contents of a texture that is updated every frame,
+  // like a video feed.  The texture is recreated with immutable storage and
+  // linear filtering whenever the size changes.
+  void stream(TexturePtr & texture, const uvec2 & size, GLenum internalFormat, GLenum format, GLenum type, const void * pixels);
+
+  // Recycles the regions the GPU has finished with.  Called by every
+  // upload.
+  void retire();
+
+  size_t getFallbackCount() const {
+    return fallbacks;
+  }
+
+private:
+  // Space in the ring, valid until it is uploaded
+  struct Region {
+    uint8_t * data{ nullptr };
+    size_t offset{ 0 };
+    size_t size{ 0 };
+    uint64_t id{ 0 };
+
+    bool valid() const {
+      return nullptr != data;
+    }
+  };
+
+  struct Block {
+    size_t offset{ 0 };
+    size_t size{ 0 };
+    GLsync fence{ nullptr };
+    // Uploaded, so only the fence still holds it
+    bool done{ false };
+  };
+
+  TextureStreamer() {}
+  bool initialize();
+  Region reserve(size_t size);
+  // The region can't be used afterwards
+  void subImage2D(GLenum target, GLint level, const uvec2 & size, GLenum format, GLenum type, const Region & region);
+  void finishBlock(uint64_t id, GLsync fence);
+  static size_t bytesPerPixel(GLenum format, GLenum type);
+
+  int supported{ -1 };
+  GLuint buffer{ 0 };
+  uint8_t * mapped{ nullptr };
+  std::deque<Block> blocks;
+  // The id of blocks.front()
+  uint64_t firstId{ 0 };
+  size_t head{ 0 };
+  size_t fallbacks{ 0 };
+};
@@ -25,103 +25,184 @@
 #include <oglplus/images/png.hpp>
 #endif
 
-struct TextureInfo {
-  uvec2 size;
-  TexturePtr tex;
-};
-typedef std::map<Resource, TextureInfo> TextureMap;
-typedef TextureMap::iterator TextureMapItr;
-
 namespace oria {
 
-  ImagePtr loadImage(const std::vector<uint8_t> & data, bool flip) {
+  // Layout of a decoded image in the DecodedCache, followed by the pixels
+  struct CachedImage {
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t format;
+    uint32_t internalFormat;
+  };
+
+  ImagePtr loadCachedImage(const ResourceView & blob) {
+    using namespace oglplus;
+    if (blob.size() < sizeof(CachedImage)) {
+      return ImagePtr();
+    }
+    const CachedImage & header = *reinterpret_cast<const CachedImage *>(blob.data());
+    size_t size = (size_t)header.width * header.height * header.channels;
+    if (blob.size() != sizeof(CachedImage) + size) {
+      return ImagePtr();
+    }
+    return ImagePtr(new images::Image(header.width, header.height, 1, header.channels,
+      blob.data() + sizeof(CachedImage), static_cast<PixelDataFormat>(header.format),
+      static_cast<PixelDataInternalFormat>(header.internalFormat)));
+  }
+
+  void storeCachedImage(uint64_t key, const ImagePtr & image) {
+    using namespace oglplus;
+    if (image->Type() != PixelDataType::UnsignedByte) {
+      return;
+    }
+    CachedImage header;
+    header.width = image->Width();
+    header.height = image->Height();
+    header.channels = image->Channels();
+    header.format = (uint32_t)image->Format();
+    header.internalFormat = (uint32_t)image->InternalFormat();
+    size_t size = (size_t)header.width * header.height * header.channels;
+    DecodedCache::instance().store(key, {
+      ResourceView(&header, sizeof(header)),
+      ResourceView(image->RawData(), size)
+    });
+  }
+
+  ImagePtr decodeImage(const ResourceView & data, bool flip) {
     using namespace oglplus;
 #ifdef HAVE_OPENCV
-    cv::Mat image = cv::imdecode(data, cv::IMREAD_COLOR);
+    // Wraps the encoded bytes without copying them
+    cv::Mat encoded(1, (int)data.size(), CV_8UC1, const_cast<uint8_t *>(data.data()));
+    // Alpha is kept, as it is by the PNG decoder and the TextureCompressor
+    cv::Mat image = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+    if (image.depth() != CV_8U) {
+      image.convertTo(image, CV_8U, 1.0 / 256);
+    }
+    if (1 == image.channels()) {
+      cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+    } else if (2 == image.channels()) {
+      // Gray and alpha, which cvtColor has no conversion for
+      cv::Mat bgra(image.rows, image.cols, CV_8UC4);
+      const int fromTo[] = { 0, 0, 0, 1, 0, 2, 1, 3 };
+      cv::mixChannels(&image, 1, &bgra, 1, fromTo, 4);
+      image = bgra;
+    }
+    bool alpha = 4 == image.channels();
     if (flip) {
-      cv::flip(image, image, 0);
+      ImageKernels::flipRows(image.data, image.step, image.cols * image.channels(), image.rows);
     }
-    ImagePtr result(new images::Image(image.cols, image.rows, 1, 3, image.data,
-      PixelDataFormat::BGR, PixelDataInternalFormat::RGBA8));
+    ImagePtr result(new images::Image(image.cols, image.rows, 1, image.channels(), image.data,
+      alpha ? PixelDataFormat::BGRA : PixelDataFormat::BGR, PixelDataInternalFormat::RGBA8));
     return result;
 #else
-    std::stringstream stream(std::string((const char*)&data[0], data.size()));
+    ResourceStream stream(data);
     return ImagePtr(new images::PNGImage(stream));
 #endif
   }
 
-  ImagePtr loadImage(Resource res, bool flip) {
-    return loadImage(Platform::getResourceByteVector(res), flip);
-  }
+  ImagePtr loadImage(const ResourceView & data, bool flip) {
+    PROFILE_ZONE("loadImage");
+    DecodedCache & cache = DecodedCache::instance();
+    if (!cache.isEnabled()) {
+      return decodeImage(data, flip);
+    }
 
-  TextureMap & getTextureMap() {
-    static TextureMap map;
-    static bool registeredShutdown = false;
-    if (!registeredShutdown) {
-      Platform::addShutdownHook([&]{
-        map.clear();
-      });
-      registeredShutdown = true;
+#ifdef HAVE_OPENCV
+    // The decoders produce different pixel formats
+    const char * options = flip ? "image opencv alpha flip" : "image opencv alpha";
+#else
+    const char * options = flip ? "image png flip" : "image png";
+#endif
+    uint64_t key = DecodedCache::key(data, options);
+    ImagePtr result = loadCachedImage(cache.find(key));
+    if (!result) {
+      result = decodeImage(data, flip);
+      storeCachedImage(key, result);
     }
+    return result;
+  }
 
-    return map;
+  ImagePtr loadImage(const std::vector<uint8_t> & data, bool flip) {
+    return loadImage(ResourceView(data.data(), data.size()), flip);
   }
 
-  template <typename T, typename F>
-  T loadOrPopulate(std::map<Resource, T> & map, Resource resource, F loader) {
-    if (!map.count(resource)) {
-      map[resource] = loader();
-    }
-    return map[resource];
+  ImagePtr loadImage(Resource res, bool flip) {
+    PROFILE_ZONE("loadImage", Resources::getResourcePath(res));
+    return loadImage(Platform::getResourceView(res), flip);
   }
 
-  TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data) {
-    using namespace oglplus;
-    TexturePtr texture(new Texture());
-    Context::Bound(TextureTarget::_2D, *texture)
-      .MagFilter(TextureMagFilter::Linear)
-      .MinFilter(TextureMinFilter::Linear);
-    ImagePtr image = loadImage(data);
-    // FIXME detect alignment properly, test on both OpenCV and LibPNG
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    Texture::Image2D(TextureTarget::_2D, *image);
-    return texture;
+  // Resource textures live in the residency manager, which may evict them
+  // and call the loader again later
+  template <typename F>
+  TextureInfo loadOrPopulate(GLenum target, Resource resource, F loader) {
+    return TextureResidency::instance().acquire(Resources::getResourcePath(resource), target, loader);
   }
 
-  TextureInfo load2dTextureInternal(const std::vector<uint8_t> & data) {
+  TextureInfo load2dTextureInternal(const ImagePtr & image, bool mipmap = false) {
+    PROFILE_ZONE("load2dTexture");
     using namespace oglplus;
     TextureInfo result;
     result.tex = TexturePtr(new Texture());
     Context::Bound(TextureTarget::_2D, *result.tex)
       .MagFilter(TextureMagFilter::Linear)
-      .MinFilter(TextureMinFilter::Linear);
-    ImagePtr image = loadImage(data);
+      .MinFilter(mipmap ? TextureMinFilter::LinearMipmapLinear : TextureMinFilter::Linear);
     result.size.x = image->Width();
     result.size.y = image->Height();
-    // FIXME detect alignment properly, test on both OpenCV and LibPNG
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    Texture::Image2D(TextureTarget::_2D, *image);
+    // Immutable storage can't grow levels later, so only textures that will
+    // be mipmapped pay for the chain
+    TextureStreamer::allocate(GL_TEXTURE_2D, mipmap ? TextureStreamer::mipLevels(result.size) : 1,
+      (GLenum)image->InternalFormat(), result.size);
+    TextureStreamer::instance().subImage2D(GL_TEXTURE_2D, 0, result.size,
+      (GLenum)image->Format(), (GLenum)image->Type(), image->RawData());
+    if (mipmap) {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
     return result;
   }
 
-  TexturePtr load2dTexture(const std::vector<uint8_t> & data, uvec2 & outSize) {
+  TextureInfo load2dTextureInternal(const ResourceView & data) {
+    return load2dTextureInternal(loadImage(data));
+  }
+
+  TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data) {
+    return load2dTextureInternal(loadImage(data)).tex;
+  }
+
+  TexturePtr load2dTexture(const ResourceView & data, uvec2 & outSize) {
     TextureInfo texInfo = load2dTextureInternal(data);
     outSize = texInfo.size;
     return texInfo.tex;
   }
 
+  TexturePtr load2dTexture(const std::vector<uint8_t> & data, uvec2 & outSize) {
+    return load2dTexture(ResourceView(data.data(), data.size()), outSize);
+  }
+
   TexturePtr load2dTexture(const std::vector<uint8_t> & data) {
     uvec2 size;
     return load2dTexture(data, size);
   }
 
-  TexturePtr load2dTexture(Resource resource, uvec2 & outSize) {
-    const TextureInfo & texInfo = loadOrPopulate(getTextureMap(), resource, [&] {
-      return load2dTextureInternal(Platform::getResourceByteVector(resource));
+  TexturePtr load2dTexture(Resource resource, uvec2 & outSize, bool mipmap) {
+    TextureInfo texInfo = loadOrPopulate(GL_TEXTURE_2D, resource, [&] {
+      // Prefer the compressed, pre-mipmapped build of the image
+      TextureInfo result;
+      ResourceView ktx = Platform::getDerivedResourceView(resource, ".ktx");
+      if (!ktx.empty()) {
+        result.tex = loadKtxTexture(ktx, result.size);
+      }
+      if (!result.tex) {
+        result = load2dTextureInternal(loadImage(Platform::getResourceView(resource)), mipmap);
+      }
+      return result;
     });
     outSize = texInfo.size;
     return texInfo.tex;
+  }
 
+  TexturePtr load2dTexture(Resource resource, uvec2 & outSize) {
+    return load2dTexture(resource, outSize, false);
   }
 
   TexturePtr load2dTexture(Resource resource) {
@@ -129,7 +210,14 @@ namespace oria {
     return load2dTexture(resource, size);
   }
 
-  TexturePtr loadCubemapTexture(std::function<ImagePtr(int)> dataLoader) {
+  TexturePtr load2dTexture(Resource resource, const ImagePtr & image) {
+    return loadOrPopulate(GL_TEXTURE_2D, resource, [&] {
+      return load2dTextureInternal(image);
+    }).tex;
+  }
+
+  TexturePtr uploadCubemap(const std::vector<ImagePtr> & faces) {
+    PROFILE_ZONE("loadCubemapTexture");
     using namespace oglplus;
     TexturePtr result = TexturePtr(new Texture());
     Context::Bound(TextureTarget::CubeMap, *result)
@@ -139,28 +227,106 @@ namespace oria {
       .WrapT(TextureWrap::ClampToEdge)
       .WrapR(TextureWrap::ClampToEdge);
 
-    glm::uvec2 size;
+    bool allocated = false;
     for (int i = 0; i < 6; ++i) {
-      ImagePtr image = dataLoader(i);
+      const ImagePtr & image = faces.at(i);
       if (!image) {
         continue;
       }
-      Texture::Image2D(Texture::CubeMapFace(i), *image);
+      glm::uvec2 size(image->Width(), image->Height());
+      if (!allocated) {
+        TextureStreamer::allocate(GL_TEXTURE_CUBE_MAP, 1, (GLenum)image->InternalFormat(), size);
+        allocated = true;
+      }
+      TextureStreamer::instance().subImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, size,
+        (GLenum)image->Format(), (GLenum)image->Type(), image->RawData());
+    }
+    return result;
+  }
+
+  std::vector<ImagePtr> loadCubemapImages(const std::vector<CubemapLoader> & loaders) {
+    PROFILE_ZONE("loadCubemapImages");
+    std::vector<ImagePtr> faces(loaders.size() * 6);
+    AssetLoader::instance().parallelFor(faces.size(), [&](size_t i) {
+      faces[i] = loaders[i / 6]((int)(i % 6));
+    });
+    return faces;
+  }
+
+  std::vector<TexturePtr> loadCubemapTextures(const std::vector<CubemapLoader> & loaders) {
+    std::vector<ImagePtr> faces = loadCubemapImages(loaders);
+    std::vector<TexturePtr> result;
+    for (size_t i = 0; i < loaders.size(); ++i) {
+      result.push_back(uploadCubemap(std::vector<ImagePtr>(faces.begin() + i * 6, faces.begin() + (i + 1) * 6)));
     }
     return result;
   }
 
+  TexturePtr loadCubemapTexture(CubemapLoader dataLoader) {
+    return loadCubemapTextures({ dataLoader }).at(0);
+  }
+
+  static int DEFAULT_RESOURCE_ORDER[] = {
+    1, 0, 3, 2, 5, 4
+  };
+
+  // The offset from the first resource of the one uploaded to a face, or -1
+  // if resourceOrder leaves the face out.  The image and KTX paths both
+  // use it, so a cubemap comes out the same whichever one loads it.
+  static int cubemapFaceResource(const int resourceOrder[6], int face) {
+    for (int j = 0; j < 6; ++j) {
+      if (resourceOrder[j] == face) {
+        return resourceOrder[j];
+      }
+    }
+    return -1;
+  }
+
+  // The tool only writes flipped faces, one KTX beside each face's resource
+  static std::vector<ResourceView> compressedCubemapFaces(Resource firstResource, const int resourceOrder[6], bool flip) {
+    std::vector<ResourceView> faces;
+    for (int i = 0; flip && i < 6; ++i) {
+      int offset = cubemapFaceResource(resourceOrder, i);
+      if (offset < 0) {
+        return std::vector<ResourceView>();
+      }
+      ResourceView face = Platform::getDerivedResourceView(static_cast<Resource>(firstResource + offset), ".ktx");
+      if (face.empty()) {
+        return std::vector<ResourceView>();
+      }
+      faces.push_back(face);
+    }
+    return faces;
+  }
+
+  bool hasCompressedCubemap(Resource firstResource, bool flip) {
+    return !compressedCubemapFaces(firstResource, DEFAULT_RESOURCE_ORDER, flip).empty();
+  }
+
+  static TexturePtr loadCompressedCubemap(Resource firstResource, const int resourceOrder[6], bool flip) {
+    std::vector<ResourceView> faces = compressedCubemapFaces(firstResource, resourceOrder, flip);
+    return faces.empty() ? TexturePtr() : loadKtxCubemap(faces);
+  }
+
+  static CubemapLoader resourceLoader(Resource firstResource, bool flip) {
+    return [=](int i) {
+      return loadImage(static_cast<Resource>(firstResource + i), flip);
+    };
+  }
+
   TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip) {
-    const TextureInfo & texInfo = loadOrPopulate(getTextureMap(), firstResource, [&] {
+    TextureInfo texInfo = loadOrPopulate(GL_TEXTURE_CUBE_MAP, firstResource, [&] {
       TextureInfo result;
+      result.tex = loadCompressedCubemap(firstResource, resourceOrder, flip);
+      if (result.tex) {
+        return result;
+      }
       result.tex = loadCubemapTexture([&](int i) {
-        Resource imageRes = NO_RESOURCE;
-        for (int j = 0; j < 6; ++j) {
-          if (resourceOrder[j] == i) {
-            return loadImage(static_cast<Resource>(firstResource + resourceOrder[j]), flip);
-          }
+        int offset = cubemapFaceResource(resourceOrder, i);
+        if (offset < 0) {
+          return ImagePtr();
         }
-        return ImagePtr();
+        return loadImage(static_cast<Resource>(firstResource + offset), flip);
       });
       return result;
     });
@@ -168,10 +334,54 @@ namespace oria {
   }
 
   TexturePtr loadCubemapTexture(Resource firstResource, bool flip) {
-    static int RESOURCE_ORDER[] = {
-      1, 0, 3, 2, 5, 4
-    };
-    return loadCubemapTexture(firstResource, RESOURCE_ORDER, flip);
+    return loadCubemapTexture(firstResource, DEFAULT_RESOURCE_ORDER, flip);
+  }
+
+  std::vector<TexturePtr> loadCubemapTextures(const std::vector<Resource> & firstResources, bool flip) {
+    // Holding on to the textures keeps them from being evicted by the
+    // ones loaded after them
+    std::map<Resource, TexturePtr> held;
+    std::vector<Resource> missing;
+    std::vector<CubemapLoader> loaders;
+    for (Resource firstResource : firstResources) {
+      if (held.count(firstResource) || missing.end() != std::find(missing.begin(), missing.end(), firstResource)) {
+        continue;
+      }
+      if (TextureResidency::instance().isResident(Resources::getResourcePath(firstResource)) ||
+          hasCompressedCubemap(firstResource, flip)) {
+        held[firstResource] = loadCubemapTexture(firstResource, flip);
+      } else {
+        missing.push_back(firstResource);
+        loaders.push_back(resourceLoader(firstResource, flip));
+      }
+    }
+
+    std::vector<TexturePtr> loaded = loadCubemapTextures(loaders);
+    for (size_t i = 0; i < missing.size(); ++i) {
+      held[missing[i]] = loadOrPopulate(GL_TEXTURE_CUBE_MAP, missing[i], [&] {
+        TextureInfo result;
+        result.tex = loaded[i];
+        return result;
+      }).tex;
+    }
+
+    std::vector<TexturePtr> result;
+    for (Resource firstResource : firstResources) {
+      result.push_back(held[firstResource]);
+    }
+    return result;
+  }
+
+  std::vector<ImagePtr> loadCubemapImages(Resource firstResource, bool flip) {
+    return loadCubemapImages(std::vector<CubemapLoader>{ resourceLoader(firstResource, flip) });
+  }
+
+  TexturePtr loadCubemapTexture(Resource firstResource, const std::vector<ImagePtr> & faces) {
+    return loadOrPopulate(GL_TEXTURE_CUBE_MAP, firstResource, [&] {
+      TextureInfo result;
+      result.tex = uploadCubemap(faces);
+      return result;
+    }).tex;
   }
 
 }
@@ -23,15 +23,40 @@ typedef std::shared_ptr<oglplus::Texture> TexturePtr;
 typedef std::shared_ptr<oglplus::images::Image> ImagePtr;
 
 namespace oria {
+  ImagePtr loadImage(const ResourceView & data, bool flip = true);
   ImagePtr loadImage(const std::vector<uint8_t> & data, bool flip = true);
   TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data);
   TexturePtr load2dTexture(const std::vector<uint8_t> & data);
   TexturePtr load2dTexture(const std::vector<uint8_t> & data, uvec2 & outSize);
-  TexturePtr loadCubemapTexture(std::function<ImagePtr(int)> dataLoader);
+  TexturePtr load2dTexture(const ResourceView & data, uvec2 & outSize);
+  // Returns the image for a cubemap face.  Faces are decoded in parallel,
+  // so a loader is called from several threads at once.
+  typedef std::function<ImagePtr(int)> CubemapLoader;
+  TexturePtr loadCubemapTexture(CubemapLoader dataLoader);
+  // Decodes the faces of all the cubemaps at once, then uploads them in
+  // order.  Must be called on the thread owning the context.
+  std::vector<TexturePtr> loadCubemapTextures(const std::vector<CubemapLoader> & loaders);
+  // Only decodes, six faces per loader.  Safe on any thread.
+  std::vector<ImagePtr> loadCubemapImages(const std::vector<CubemapLoader> & loaders);
 
   ImagePtr loadImage(Resource resource, bool flip = true);
   TexturePtr load2dTexture(Resource resource);
   TexturePtr load2dTexture(Resource resource, uvec2 & outSize);
+  // With a full mip chain and a mipmapped filter.  The KTX builds carry
+  // their own chain, images without one have it generated.
+  TexturePtr load2dTexture(Resource resource, uvec2 & outSize, bool mipmap);
   TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip = true);
   TexturePtr loadCubemapTexture(Resource firstResource, bool flip = true);
+  std::vector<TexturePtr> loadCubemapTextures(const std::vector<Resource> & firstResources, bool flip = true);
+  // The resource loaders above use the KTX files built by TextureCompressor
+  // when there are any, which need no decoding
+  bool hasCompressedCubemap(Resource firstResource, bool flip = true);
+
+  // Decoding and uploading as separate steps, so the decoding can happen on
+  // another thread.  The upload overloads fill the same cache as the
+  // resource based loaders above, and return the cached texture if the
+  // resource was already loaded.
+  std::vector<ImagePtr> loadCubemapImages(Resource firstResource, bool flip = true);
+  TexturePtr load2dTexture(Resource resource, const ImagePtr & image);
+  TexturePtr loadCubemapTexture(Resource firstResource, const std::vector<ImagePtr> & faces);
 }
@@ -93,6 +93,11 @@ namespace ovr {
     return result;
   }
 
+  // Stable names for each eye, suitable for timing and profiling labels
+  inline const char * eyeName(ovrEyeType eye) {
+    return ovrEye_Left == eye ? "left eye" : "right eye";
+  }
+
   GLFWwindow * createRiftRenderingWindow(ovrHmd hmd, glm::uvec2 & outSize, glm::ivec2 & outPosition);
 }
 
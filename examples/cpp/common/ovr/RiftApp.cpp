@@ -108,13 +108,16 @@ void RiftApp::applyEyePoseAndOffset(const glm::mat4 & eyePose, const glm::vec3 &
 }
 
 void RiftApp::draw() {
+  PROFILE_ZONE("RiftApp::draw");
   ovrHmd_BeginFrame(hmd, getFrame());
   MatrixStack & mv = Stacks::modelview();
   MatrixStack & pr = Stacks::projection();
   
   ovrHmd_GetEyePoses(hmd, getFrame(), eyeOffsets, eyePoses, nullptr);
+  LodSelector::instance().beginFrame();
   for (int i = 0; i < 2; ++i) {
     ovrEyeType eye = currentEye = hmd->EyeRenderOrder[i];
+    LodSelector::instance().beginEye(eyeTextures[eye].Header.RenderViewport.Size.h);
     Stacks::withPush(pr, mv, [&]{
       const ovrEyeRenderDesc & erd = eyeRenderDescs[eye];
       // Set up the per-eye projection matrix
@@ -129,10 +132,15 @@ void RiftApp::draw() {
         // Apply the head pose
         glm::mat4 eyePose = ovr::toGlm(eyePoses[eye]);
         applyEyePoseAndOffset(eyePose, glm::vec3(0));
+        FrameUniforms::instance().setView(mv.top());
       }
 
       // Render the scene to an offscreen buffer
+      FrameTimeline::Scope phase(getTimeline(), ovr::eyeName(eye));
+      GPU_ZONE(ovr::eyeName(eye));
       eyeFramebuffers[eye]->Bind();
+      PROFILE_ZONE("renderScene");
+      GPU_ZONE("scene");
       renderScene();
     });
   }
@@ -140,7 +148,11 @@ void RiftApp::draw() {
   oglplus::DefaultFramebuffer().Bind(oglplus::Framebuffer::Target::Draw);
 
 #if 1
-  ovrHmd_EndFrame(hmd, eyePoses, eyeTextures);
+  {
+    FrameTimeline::Scope phase(getTimeline(), "EndFrame");
+    GPU_ZONE("distortion");
+    ovrHmd_EndFrame(hmd, eyePoses, eyeTextures);
+  }
 #else
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   static gl::GeometryPtr geometry = GlUtils::getQuadGeometry(1.0, 1.5f);
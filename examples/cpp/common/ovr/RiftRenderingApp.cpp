@@ -64,18 +64,22 @@ RiftRenderingApp::RiftRenderingApp() {
 RiftRenderingApp::~RiftRenderingApp() {
 }
 
-static RateCounter rateCounter;
-
 void RiftRenderingApp::drawRiftFrame() {
   ++frameCount;
+  timeline.beginFrame(frameCount);
+  GpuTimer::instance().beginFrame(frameCount);
   ovrHmd_BeginFrame(hmd, frameCount);
   MatrixStack & mv = Stacks::modelview();
   MatrixStack & pr = Stacks::projection();
 
-  perFrameRender();
+  {
+    FrameTimeline::Scope phase(timeline, "perFrameRender");
+    perFrameRender();
+  }
   
   ovrPosef fetchPoses[2];
   ovrHmd_GetEyePoses(hmd, frameCount, eyeOffsets, fetchPoses, nullptr);
+  LodSelector::instance().beginFrame();
   for (int i = 0; i < 2; ++i) {
     ovrEyeType eye = currentEye = hmd->EyeRenderOrder[i];
     // Force us to alternate eyes if we aren't keeping up with the required framerate
@@ -87,6 +91,7 @@ void RiftRenderingApp::drawRiftFrame() {
     eyePoses[eye] = fetchPoses[eye];
 
     lastEyeRendered = eye;
+    LodSelector::instance().beginEye(eyeTextures[eye].Header.RenderViewport.Size.h);
     Stacks::withPush(pr, mv, [&] {
       // Set up the per-eye projection matrix
       pr.top() = projections[eye];
@@ -95,9 +100,13 @@ void RiftRenderingApp::drawRiftFrame() {
       // Apply the head pose
       glm::mat4 eyePose = ovr::toGlm(eyePoses[eye]);
       mv.preMultiply(glm::inverse(eyePose));
+      FrameUniforms::instance().setView(mv.top());
 
       // Render the scene to an offscreen buffer
+      FrameTimeline::Scope phase(timeline, ovr::eyeName(eye));
+      GPU_ZONE(ovr::eyeName(eye));
       eyeFramebuffers[eye]->Bind();
+      GPU_ZONE("scene");
       perEyeRender();
     });
     
@@ -106,18 +115,24 @@ void RiftRenderingApp::drawRiftFrame() {
     }
   }
 
-  if (endFrameLock) {
-    endFrameLock->lock();
-  }
-  ovrHmd_EndFrame(hmd, eyePoses, eyeTextures);
-  if (endFrameLock) {
-    endFrameLock->unlock();
+  {
+    FrameTimeline::Scope phase(timeline, "EndFrame");
+    GPU_ZONE("distortion");
+    if (endFrameLock) {
+      endFrameLock->lock();
+    }
+    ovrHmd_EndFrame(hmd, eyePoses, eyeTextures);
+    if (endFrameLock) {
+      endFrameLock->unlock();
+    }
   }
-  rateCounter.increment();
-  if (rateCounter.elapsed() > 2.0f) {
-    float fps = rateCounter.getRate();
+  GpuTimer::instance().endFrame();
+  timeline.endFrame();
+  frameStats.increment();
+  if (frameStats.elapsed() > 2.0f) {
+    float fps = frameStats.getRate();
     updateFps(fps);
-    rateCounter.reset();
+    frameStats.reset();
   }
 }
 
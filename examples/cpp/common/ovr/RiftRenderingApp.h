@@ -23,6 +23,8 @@ class RiftRenderingApp : public RiftManagerApp {
   ovrEyeType currentEye{ovrEye_Count};
   FramebufferWrapperPtr eyeFramebuffers[2];
   unsigned int frameCount{ 0 };
+  FrameTimeline timeline;
+  FrameStatistics frameStats;
 
 protected:
   ovrPosef eyePoses[2];
@@ -48,6 +50,16 @@ protected:
     return eyePoses[currentEye];
   }
 
+  const FrameTimeline & getTimeline() const {
+    return timeline;
+  }
+
+  // Frame interval statistics for the current reporting window, valid
+  // during updateFps()
+  const FrameStatistics & getFrameStatistics() const {
+    return frameStats;
+  }
+
   virtual void updateFps(float fps) { }
   virtual void initializeRiftRendering();
   virtual void drawRiftFrame() final;
@@ -162,7 +162,7 @@ public:
 
 
   void distortionThread() {
-    Platform::setThreadPriority(Platform::HIGH);
+    ThreadPlacement::apply(ThreadPlacement::DISTORTION);
     // Make the shared context current
     glfwMakeContextCurrent(getWindow());
 
@@ -190,8 +190,10 @@ public:
     ovrPosef renderPoses[2];
     ovrHmd_GetEyePoses(hmd, distortionFrameIndex, hmdToEyeOffsets, renderPoses, nullptr);
 
+    LodSelector::instance().beginFrame();
     for (int i = 0; i < 2; ++i) {
       ovrEyeType eye = hmd->EyeRenderOrder[i];
+      LodSelector::instance().beginEye(eyeTextures[eye].Header.RenderViewport.Size.h);
       MatrixStack & mv = Stacks::modelview();
       Stacks::projection().top() = eyeProjections[eye];
       Stacks::withPush(mv, [&]{
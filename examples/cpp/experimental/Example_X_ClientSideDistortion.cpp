@@ -22,6 +22,9 @@ class ClientSideDistortionExample : public RiftGlfwApp {
   float       ipd = OVR_DEFAULT_IPD;
   float       eyeHeight = OVR_DEFAULT_EYE_HEIGHT;
   ProgramPtr  distortionProgram;
+  UniformHandle<vec2> uvScaleUniform;
+  UniformHandle<vec2> uvOffsetUniform;
+  UniformHandle<GLuint> rightEyeUniform;
 
 public:
   ClientSideDistortionExample() {
@@ -42,6 +45,9 @@ public:
       Resource::SHADERS_DISTORTION_VS,
       Resource::SHADERS_DISTORTION_FS
     );
+    uvScaleUniform = UniformHandle<vec2>(distortionProgram, "EyeToSourceUVScale");
+    uvOffsetUniform = UniformHandle<vec2>(distortionProgram, "EyeToSourceUVOffset");
+    rightEyeUniform = UniformHandle<GLuint>(distortionProgram, "RightEye");
 
     for_each_eye([&](ovrEyeType eye){
       eyeArgs[eye] = EyeArgPtr(new EyeArg());
@@ -108,9 +114,11 @@ public:
 
     ovrFrameTiming timing = ovrHmd_BeginFrameTiming(hmd, frameIndex);
 
+    LodSelector::instance().beginFrame();
     for (int i = 0; i < 2; ++i) {
       const ovrEyeType eye = hmd->EyeRenderOrder[i];
       EyeArg & eyeArg = *eyeArgs[eye];
+      LodSelector::instance().beginEye(eyeArg.frameBuffer.size.y);
       // Set up the per-eye projection matrix
       Stacks::projection().top() = eyeArg.projection;
       
@@ -131,9 +139,9 @@ public:
 //    float mix = (sin(ovr_GetTimeInSeconds() * TWO_PI / 10.0f) + 1.0f) / 2.0f;
     for_each_eye([&](ovrEyeType eye) {
       const EyeArg & eyeArg = *eyeArgs[eye];
-      Uniform<vec2>(*distortionProgram, "EyeToSourceUVScale").Set(eyeArg.scale);
-      Uniform<vec2>(*distortionProgram, "EyeToSourceUVOffset").Set(eyeArg.offset);
-      Uniform<GLuint>(*distortionProgram, "RightEye").Set(ovrEye_Left == eye ? 0 : 1);
+      uvScaleUniform.set(eyeArg.scale);
+      uvOffsetUniform.set(eyeArg.offset);
+      rightEyeUniform.set(ovrEye_Left == eye ? 0 : 1);
 //      Uniform<GLfloat>(*distortionProgram, "DistortionWeight").Set(mix);
       eyeArg.frameBuffer.color->Bind(Texture::Target::_2D);
       eyeArg.meshVao.Bind();
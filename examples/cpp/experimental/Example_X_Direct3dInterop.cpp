@@ -421,9 +421,11 @@ public:
         if (!wglDXLockObjectsNV(gl_handleD3D, 2, gl_handles)) {
             FAIL("Could not lock objects");
         }
+        LodSelector::instance().beginFrame();
         for (int i = 0; i < 2; ++i) {
             ovrEyeType eye = hmd->EyeRenderOrder[i];
             EyeArgs & eyeArgs = perEyeArgs[eye];
+            LodSelector::instance().beginEye(textures[eye].Header.RenderViewport.Size.h);
             Stacks::projection().top() = eyeArgs.projection;
             Stacks::projection().scale(glm::vec3(1, -1, 1));
 
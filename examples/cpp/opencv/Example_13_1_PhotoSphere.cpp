@@ -14,7 +14,7 @@ public:
 
   void drawSphere() {
     static ProgramPtr program = oria::loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
-    static ShapeWrapperPtr geometry = oria::loadShape({ "Position", "TexCoord" }, Resource::MESHES_SPHERE_CTM, program);
+    static MeshPtr geometry = oria::loadMesh({ "Position", "TexCoord" }, Resource::MESHES_SPHERE_CTM, program);
     static TexturePtr t = loadAndPositionPhotoSphereImage(Resource::IMAGES_PANO_20140620_160351_JPG);
     Platform::addShutdownHook([]{
       program.reset();
@@ -72,8 +72,6 @@ public:
     });
     auto v = Platform::getResourceByteVector(res);
     cv::Mat mat = cv::imdecode(v, CV_LOAD_IMAGE_COLOR);
-    cv::cvtColor(mat, mat, CV_BGR2RGB);
-    //cv::flip(mat, mat, 0);
     Context::Bound(TextureTarget::_2D, *texture)
       .MagFilter(TextureMagFilter::Linear)
       .MinFilter(TextureMinFilter::Linear);
@@ -84,7 +82,8 @@ public:
       uchar *embedded = (uchar*)malloc(fullPanoSize.x * fullPanoSize.y * 3);
       insetImage(fullPanoSize, croppedImageSize, croppedImagePos, mat, embedded);
       Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(images::Image(fullPanoSize.x, fullPanoSize.y, 1, 3, embedded));
+        .Image2D(images::Image(fullPanoSize.x, fullPanoSize.y, 1, 3, embedded,
+          PixelDataFormat::BGR, PixelDataInternalFormat::RGB8));
       free(embedded);
     }
     else {
@@ -92,7 +91,8 @@ public:
       texture->Bind(Texture::Target::_2D);
       Context::PixelStore(PixelStorageMode::UnpackAlignment, 1);
       Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(images::Image(mat.cols, mat.rows, 1, 3, mat.datastart));
+        .Image2D(images::Image(mat.cols, mat.rows, 1, 3, mat.datastart,
+          PixelDataFormat::BGR, PixelDataInternalFormat::RGB8));
     }
 
     return texture;
@@ -102,12 +102,23 @@ public:
    * Embed the image in mat into a larger frame.
    */
   static void insetImage(glm::uvec2 &fullPanoSize, glm::uvec2 &croppedImageSize, glm::uvec2 &croppedImagePos, cv::Mat &mat, uchar *out) {
-    memset(out, 84, fullPanoSize.x * fullPanoSize.y * 3);
-    for (unsigned int y = 0; y < croppedImageSize.y; y++) {
-      int srcRow = y * croppedImageSize.x * 3;
-      int destRow = (croppedImagePos.y + y) * (fullPanoSize.x * 3);
-      memcpy(out + destRow + croppedImagePos.x, mat.datastart + srcRow, croppedImageSize.x * 3);
-    }
+    const uchar BORDER = 84;
+    size_t stride = fullPanoSize.x * 3;
+    // The EXIF fields aren't trusted to describe an image that fits, so
+    // whatever lies outside the frame is cut off
+    unsigned x = std::min(croppedImagePos.x, fullPanoSize.x);
+    unsigned y = std::min(croppedImagePos.y, fullPanoSize.y);
+    size_t left = x * 3;
+    size_t width = std::min(std::min(croppedImageSize.x, (unsigned)mat.cols), fullPanoSize.x - x) * 3;
+    size_t right = stride - left - width;
+    size_t top = y;
+    size_t rows = std::min(std::min(croppedImageSize.y, (unsigned)mat.rows), fullPanoSize.y - y);
+    // Only the border around the image needs filling
+    ImageKernels::fill(out, stride, stride, top, BORDER);
+    ImageKernels::fill(out + top * stride, stride, left, rows, BORDER);
+    ImageKernels::blit(mat.data, mat.step, out + top * stride + left, stride, width, rows);
+    ImageKernels::fill(out + top * stride + left + width, stride, right, rows, BORDER);
+    ImageKernels::fill(out + (top + rows) * stride, stride, stride, fullPanoSize.y - top - rows, BORDER);
   }
 
   static bool parseExifData(const std::string & exifData, glm::uvec2 &fullPanoSize, glm::uvec2 &croppedImageSize, glm::uvec2 &croppedImagePos) {
@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include <opencv2/opencv.hpp>
+#include "CaptureFrames.h"
 #include <thread>
 #include <mutex>
 
@@ -56,10 +57,20 @@ public:
   }
 
   void captureLoop() {
+    ThreadPlacement::apply(ThreadPlacement::CAPTURE);
     CaptureData captured;
+    cv::Mat raw;
+    CaptureFrames frames;
     while (!stopped) {
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
+      PROFILE_ZONE("capture");
+      {
+        PROFILE_ZONE("read");
+        videoCapture.read(raw);
+      }
+      {
+        PROFILE_ZONE("convert");
+        captured.image = frames.convert(raw);
+      }
       set(captured);
     }
   }
@@ -98,12 +109,9 @@ public:
   virtual void update() {
     CaptureData captureData;
     if (captureHandler.get(captureData)) {
-      using namespace oglplus;
-      Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(0, PixelDataInternalFormat::RGBA8, 
-          captureData.image.cols, captureData.image.rows, 0, 
-          PixelDataFormat::BGR, PixelDataType::UnsignedByte, 
-          captureData.image.data);
+      TextureStreamer::instance().stream(texture,
+        uvec2(captureData.image.cols, captureData.image.rows),
+        GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, captureData.image.data);
     }
   }
 
@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include <opencv2/opencv.hpp>
+#include "CaptureFrames.h"
 #include <thread>
 #include <mutex>
 
@@ -61,14 +62,24 @@ public:
   }
 
   void captureLoop() {
+    ThreadPlacement::apply(ThreadPlacement::CAPTURE);
     CaptureData captured;
+    cv::Mat raw;
+    CaptureFrames frames;
     while (!stopped) {
+      PROFILE_ZONE("capture");
       float captureTime = ovr_GetTimeInSeconds();
       ovrTrackingState tracking = ovrHmd_GetTrackingState(hmd, captureTime);
       captured.pose = tracking.HeadPose.ThePose;
 
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
+      {
+        PROFILE_ZONE("read");
+        videoCapture.read(raw);
+      }
+      {
+        PROFILE_ZONE("convert");
+        captured.image = frames.convert(raw);
+      }
       set(captured);
     }
   }
@@ -107,12 +118,9 @@ public:
 
   virtual void update() {
     if (captureHandler.get(captureData)) {
-      using namespace oglplus;
-      Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(0, PixelDataInternalFormat::RGBA8,
-        captureData.image.cols, captureData.image.rows, 0,
-        PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-        captureData.image.data);
+      TextureStreamer::instance().stream(texture,
+        uvec2(captureData.image.cols, captureData.image.rows),
+        GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, captureData.image.data);
     }
   }
 
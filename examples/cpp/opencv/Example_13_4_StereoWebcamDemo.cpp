@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include <opencv2/opencv.hpp>
+#include "CaptureFrames.h"
 #include <thread>
 #include <mutex>
 
@@ -72,14 +73,24 @@ public:
   }
 
   void captureLoop() {
+    ThreadPlacement::apply(ThreadPlacement::CAPTURE);
     CaptureData captured;
+    cv::Mat raw;
+    CaptureFrames frames;
     while (!stopped) {
+      PROFILE_ZONE("capture");
       float captureTime = ovr_GetTimeInSeconds();
       ovrTrackingState tracking = ovrHmd_GetTrackingState(hmd, captureTime);
       captured.pose = tracking.HeadPose.ThePose;
 
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
+      {
+        PROFILE_ZONE("read");
+        videoCapture.read(raw);
+      }
+      {
+        PROFILE_ZONE("convert");
+        captured.image = frames.convert(raw);
+      }
       set(captured);
     }
   }
@@ -126,12 +137,9 @@ public:
   virtual void update() {
     for (int i = 0; i < 2; i++) {
       if (captureHandler[i].get(captureData[i])) {
-        using namespace oglplus;
-        Context::Bound(TextureTarget::_2D, *texture[i])
-          .Image2D(0, PixelDataInternalFormat::RGBA8,
-          captureData[i].image.cols, captureData[i].image.rows, 0,
-          PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-          captureData[i].image.data);
+        TextureStreamer::instance().stream(texture[i],
+          uvec2(captureData[i].image.cols, captureData[i].image.rows),
+          GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, captureData[i].image.data);
       }
     }
   }
@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include <opencv2/opencv.hpp>
+#include "CaptureFrames.h"
 #include <thread>
 #include <mutex>
 
@@ -26,8 +27,7 @@ private:
   bool changed{ false };
   bool stop{ false };
 
-  float firstCapture{ -1 };
-  int captures{ -1 };
+  FrameStatistics captureStats;
   float cps{ -1 };
 
   T result;
@@ -39,10 +39,8 @@ protected:
   }
 
   void setResult(const T & newResult) {
-    if (0 == ++captures) {
-      firstCapture = Platform::elapsedSeconds();
-    }
     lock_guard guard(mutex);
+    captureStats.increment();
     result = newResult;
     changed = true;
   }
@@ -50,19 +48,19 @@ protected:
 public:
 
   float getCapturesPerSecond() {
-    if (-1 == captures) {
-      return 0;
+    lock_guard guard(mutex);
+    if (!captureStats.getCount()) {
+      return cps > 0 ? cps : 0;
     }
 
-    float elapsed = Platform::elapsedSeconds() - firstCapture;
-    if (elapsed > 2.0f) {
-      cps = (float)captures / elapsed;
-      captures = -1;
+    if (captureStats.elapsed() > 2.0f) {
+      cps = captureStats.getRate();
+      captureStats.reset();
     }
     if (cps > 0) {
       return cps;
     }
-    return (float)captures / elapsed;
+    return captureStats.getRate();
   }
 
   void startCapture() {
@@ -134,7 +132,11 @@ public:
   }
   
   virtual void captureLoop() {
+    ThreadPlacement::apply(ThreadPlacement::CAPTURE);
+    cv::Mat raw;
+    CaptureFrames frames;
     while (!isStopped()) {
+      PROFILE_ZONE("capture");
       CaptureData captured;
       float captureTime = 
         ovr_GetTimeInSeconds() - CAMERA_LATENCY;
@@ -142,16 +144,25 @@ public:
         ovrHmd_GetTrackingState(hmd, captureTime);
       captured.pose = tracking.HeadPose.ThePose;
 
-      if (!videoCapture.grab() ||
-          !videoCapture.retrieve(captured.image)) {
-        FAIL("Failed video capture");
+      {
+        PROFILE_ZONE("read");
+        if (!videoCapture.grab() ||
+            !videoCapture.retrieve(raw)) {
+          FAIL("Failed video capture");
+        }
       }
 
       if (hasCalibration) {
-        remap(captured.image.clone(), captured.image, distortionMap, cv::Mat(), cv::INTER_LINEAR);
+        PROFILE_ZONE("remap");
+        cv::Mat undistorted;
+        remap(raw, undistorted, distortionMap, cv::Mat(), cv::INTER_LINEAR);
+        raw = undistorted;
       }
 
-      cv::flip(captured.image.clone(), captured.image, 0);
+      {
+        PROFILE_ZONE("convert");
+        captured.image = frames.convert(raw);
+      }
       setResult(captured);
     }
   }
@@ -200,13 +211,9 @@ void initGl() {
 
 virtual void update() {
   if (captureHandler.getResult(captureData)) {
-    using namespace oglplus;
-    Context::Bound(TextureTarget::_2D, *texture)
-      .Image2D(0, PixelDataInternalFormat::RGBA8,
-             captureData.image.cols, captureData.image.rows, 0,
-             PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-             captureData.image.data);
-    DefaultTexture().Bind(TextureTarget::_2D);
+    TextureStreamer::instance().stream(texture,
+      uvec2(captureData.image.cols, captureData.image.rows),
+      GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, captureData.image.data);
   }
 }
 
@@ -232,8 +239,10 @@ virtual void renderScene() {
 
   std::string message = Platform::format(
     "OpenGL FPS: %0.2f\n"
+    "GPU frame: %0.2fms\n"
     "Vidcap FPS: %0.2f\n",
-    fps, captureHandler.getCapturesPerSecond());
+    fps, (float)GpuTimer::instance().getLastFrame().duration() / 1e6f,
+    captureHandler.getCapturesPerSecond());
   GlfwApp::renderStringAt(message, glm::vec2(-0.5f, 0.5f));
 }
 };
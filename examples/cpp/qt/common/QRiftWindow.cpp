@@ -46,6 +46,10 @@ inline QRect getSecondaryScreenGeometry(const uvec2 & size) {
 }
 
 QRiftWindow::QRiftWindow() {
+  // Built on the GUI thread, which from here on only runs the event loop
+  // and the offscreen UI.  Before the render thread starts, which places
+  // itself.
+  ThreadPlacement::apply(ThreadPlacement::UI);
   setSurfaceType(QSurface::OpenGLSurface);
 
   QSurfaceFormat format;
@@ -109,7 +113,6 @@ void QRiftWindow::start() {
   m_context->doneCurrent();
   m_context->moveToThread(&renderThread);
   renderThread.start();
-  renderThread.setPriority(QThread::HighestPriority);
 }
 
 // Should only be called from the primary thread
@@ -146,6 +149,8 @@ void QRiftWindow::drawFrame() {
 void QRiftWindow::renderLoop() {
   m_context->makeCurrent(this);
   setup();
+  // Only now, so the threads started while setting up don't inherit it
+  ThreadPlacement::apply(ThreadPlacement::RENDER);
 
   while (!shuttingDown) {
     if (QCoreApplication::hasPendingEvents())
@@ -153,10 +158,12 @@ void QRiftWindow::renderLoop() {
     tasks.drainTaskQueue();
 
     m_context->makeCurrent(this);
+    PROFILE_ZONE("frame");
+    AssetLoader::instance().processUploads();
     drawFrame();
 #ifndef USE_RIFT
     m_context->swapBuffers(this);
-    static RateCounter rateCounter;
+    static FrameStatistics rateCounter;
     rateCounter.increment();
     if (rateCounter.elapsed() > 1.0f) {
       float fps = rateCounter.getRate();
@@ -2,4 +2,5 @@
 #include "Common.h"
 #include "QtUtils.h"
 #include "QRiftWindow.h"
+#include "ShaderCompiler.h"
 #include "GlslEditor.h"
@@ -448,11 +448,18 @@ static ImagePtr loadImageWithAlpha(const std::vector<uint8_t> & data, bool flip)
   using namespace oglplus;
 #ifdef HAVE_OPENCV
   cv::Mat image = cv::imdecode(data, cv::IMREAD_UNCHANGED);
-  if (flip) {
-    cv::flip(image, image, 0);
+  if (image.channels() != 3 && image.channels() != 4) {
+    image = cv::imdecode(data, cv::IMREAD_COLOR);
   }
-  ImagePtr result(new images::Image(image.cols, image.rows, 1, 4, image.data,
-    PixelDataFormat::BGRA, PixelDataInternalFormat::RGBA8));
+  // Expanded to RGBA and flipped in a single pass
+  cv::Mat rgba(image.rows, image.cols, CV_8UC4);
+  if (4 == image.channels()) {
+    ImageKernels::bgraToRgba(image.data, image.step, rgba.data, rgba.step, image.cols, image.rows, flip);
+  } else {
+    ImageKernels::bgrToRgba(image.data, image.step, rgba.data, rgba.step, image.cols, image.rows, flip);
+  }
+  ImagePtr result(new images::Image(rgba.cols, rgba.rows, 1, 4, rgba.data,
+    PixelDataFormat::RGBA, PixelDataInternalFormat::RGBA8));
   return result;
 #else
   std::stringstream stream(std::string((const char*)&data[0], data.size()));
@@ -460,26 +467,27 @@ static ImagePtr loadImageWithAlpha(const std::vector<uint8_t> & data, bool flip)
 #endif
 }
 
-TexturePtr loadCursor(Resource res) {
+TextureAtlas::Region loadCursor(Resource res) {
   using namespace oglplus;
-  TexturePtr texture(new Texture());
-  Context::Bound(TextureTarget::_2D, *texture)
-    .MagFilter(TextureMagFilter::Linear)
-    .MinFilter(TextureMinFilter::Linear);
-
   ImagePtr image = loadImageWithAlpha(Platform::getResourceByteVector(res), true);
-  // FIXME detect alignment properly, test on both OpenCV and LibPNG
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  Texture::Storage2D(TextureTarget::_2D, 1, PixelDataInternalFormat::RGBA8, image->Width() * 2, image->Height() * 2);
-  {
-    size_t size = image->Width() * 2 * image->Height() * 2 * 4;
-    uint8_t * empty = new uint8_t[size]; memset(empty, 0, size);
-    images::Image blank(image->Width() * 2, image->Height() * 2, 1, 4, empty);
-    Texture::SubImage2D(TextureTarget::_2D, blank, 0, 0);
+  // The sprite sits in one quadrant of a transparent square twice its size,
+  // so that the hotspot is the centre of the plane it's drawn on
+  uvec2 size(image->Width(), image->Height());
+  uvec2 paddedSize = size * 2u;
+  size_t stride = paddedSize.x * 4;
+  std::vector<uint8_t> rgba(stride * paddedSize.y, 0);
+  const uint8_t * pixels = (const uint8_t *)image->RawData();
+  uint8_t * quadrant = rgba.data() + size.x * 4;
+  if (PixelDataFormat::RGBA == image->Format()) {
+    ImageKernels::blit(pixels, size.x * 4, quadrant, stride, size.x * 4, size.y);
+  } else {
+    ImageKernels::rgbToRgba(pixels, size.x * 3, quadrant, stride, size.x, size.y);
+  }
+  TextureAtlas::Region result = oria::addAtlasRegion(paddedSize, rgba.data());
+  if (!result.valid()) {
+    FAIL("Unable to pack %s into a texture atlas", Resources::getResourcePath(res).c_str());
   }
-  Texture::SubImage2D(TextureTarget::_2D, *image, image->Width(), 0);
-  DefaultTexture().Bind(TextureTarget::_2D);
-  return texture;
+  return result;
 }
 
 //void QOffscreenUi::deleteOldTextures(const std::vector<GLuint> & oldTextures) {
@@ -208,7 +208,9 @@ public:
 };
 
 
-TexturePtr loadCursor(Resource res);
+// The cursor sprite, packed into the shared texture atlas.  Draw it with
+// oria::loadAtlasProgram.
+TextureAtlas::Region loadCursor(Resource res);
 
 
 #ifdef OS_WIN
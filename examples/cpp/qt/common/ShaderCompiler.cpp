@@ -0,0 +1,173 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "QtCommon.h"
+
+#ifdef HAVE_QT
+
+ShaderCompiler::ShaderCompiler() {
+  QSurfaceFormat format;
+  format.setVersion(4, 3);
+  format.setProfile(QSurfaceFormat::OpenGLContextProfile::CoreProfile);
+  surface->setFormat(format);
+  surface->create();
+  thread.setLambda([&] { workerLoop(); });
+}
+
+ShaderCompiler::~ShaderCompiler() {
+  stop();
+  delete surface;
+}
+
+void ShaderCompiler::start(QOpenGLContext * shareContext) {
+  if (running) {
+    return;
+  }
+  context = new QOpenGLContext;
+  context->setFormat(shareContext->format());
+  context->setShareContext(shareContext);
+  if (!context->create()) {
+    SAY_ERR("Unable to create a shared context, compiling shaders on the render thread");
+    delete context;
+    context = nullptr;
+    return;
+  }
+  context->moveToThread(&thread);
+  running = true;
+  thread.start();
+}
+
+void ShaderCompiler::stop() {
+  if (!running) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    running = false;
+  }
+  condition.notify_all();
+  thread.wait();
+  // Callbacks for programs that never made it are dropped
+  for (Finished & done : finished) {
+    glDeleteSync(done.fence);
+  }
+  finished.clear();
+}
+
+void ShaderCompiler::compile(const std::string & vertexSource, const std::string & fragmentSource, Callback callback, bool cacheBinary) {
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    request.vertexSource = vertexSource;
+    request.fragmentSource = fragmentSource;
+    request.callback = callback;
+    request.cacheBinary = cacheBinary;
+    pending = true;
+  }
+  condition.notify_one();
+}
+
+void ShaderCompiler::poll() {
+  std::list<Finished> ready;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    // In order, so an older program never replaces a newer one
+    while (!finished.empty()) {
+      GLenum status = glClientWaitSync(finished.front().fence, 0, 0);
+      if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status) {
+        break;
+      }
+      glDeleteSync(finished.front().fence);
+      ready.splice(ready.end(), finished, finished.begin());
+    }
+  }
+  for (const Finished & done : ready) {
+    done.callback(done.result);
+  }
+}
+
+ShaderCompiler::Result ShaderCompiler::build(const Request & request) {
+  using namespace oglplus;
+  PROFILE_ZONE("ShaderCompiler::build");
+  Result result;
+  uint64_t key = oria::programBinaryKey(
+    ResourceView(request.vertexSource.data(), request.vertexSource.size()),
+    ResourceView(request.fragmentSource.data(), request.fragmentSource.size()));
+  if (oria::loadProgramBinary(result.program, key)) {
+    return result;
+  }
+  try {
+    if (!lastVertexShader || request.vertexSource != lastVertexSource) {
+      lastVertexShader.reset();
+      VertexShaderPtr vertexShader(new VertexShader());
+      vertexShader->Source(request.vertexSource.c_str());
+      vertexShader->Compile();
+      lastVertexShader = vertexShader;
+      lastVertexSource = request.vertexSource;
+    }
+    FragmentShader fragmentShader;
+    fragmentShader.Source(request.fragmentSource.c_str());
+    fragmentShader.Compile();
+    ProgramPtr program(new Program());
+    program->AttachShader(*lastVertexShader);
+    program->AttachShader(fragmentShader);
+    if (request.cacheBinary) {
+      oria::prepareProgramBinary(program);
+    }
+    program->Link();
+    if (request.cacheBinary) {
+      oria::storeProgramBinary(program, key);
+    }
+    result.program = program;
+  } catch (ProgramBuildError & err) {
+    result.log = err.Log();
+  }
+  return result;
+}
+
+void ShaderCompiler::workerLoop() {
+  ThreadPlacement::apply(ThreadPlacement::LOADER);
+  context->makeCurrent(surface);
+  while (true) {
+    Request next;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [&] { return pending || !running; });
+      if (!running) {
+        break;
+      }
+      next = request;
+      pending = false;
+    }
+
+    Finished done;
+    done.result = build(next);
+    done.callback = next.callback;
+    done.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Without a flush the fence might never reach the GPU
+    glFlush();
+    std::lock_guard<std::mutex> guard(mutex);
+    finished.push_back(done);
+  }
+  lastVertexShader.reset();
+  context->doneCurrent();
+  delete context;
+  context = nullptr;
+}
+
+#endif
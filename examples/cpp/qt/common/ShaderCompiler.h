@@ -0,0 +1,95 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Compiles and links programs on a worker thread with its own GL context,
+ * sharing objects with the render context, so a slow driver never stalls
+ * a frame.
+ *
+ * The worker fences every program it finishes.  The render thread calls
+ * poll() once a frame, and a result's callback runs there once its fence
+ * has signalled, so the program is complete by the time it's used.  Only
+ * the newest request waits for the worker: one replaced before the worker
+ * got to it is dropped unanswered, since only the latest edit matters.
+ *
+ * Construct on the GUI thread, which has to create the worker's surface.
+ * Start only after the render thread has compiled a program of its own, so
+ * the lazily initialized driver state in Shaders.cpp already exists.
+ */
+class ShaderCompiler {
+public:
+  struct Result {
+    // Null if compiling or linking failed
+    ProgramPtr program;
+    std::string log;
+  };
+  typedef std::function<void(const Result &)> Callback;
+
+  ShaderCompiler();
+  ~ShaderCompiler();
+
+  // Render thread, with the context to share current
+  void start(QOpenGLContext * shareContext);
+  void stop();
+
+  bool isRunning() const {
+    return running;
+  }
+
+  // Any thread.  Pass cacheBinary false for sources that are unlikely to
+  // come back, like the one being edited, so each keystroke doesn't leave
+  // another program binary in the decoded cache.
+  void compile(const std::string & vertexSource, const std::string & fragmentSource, Callback callback, bool cacheBinary = true);
+  // Render thread, once a frame
+  void poll();
+
+private:
+  struct Request {
+    std::string vertexSource;
+    std::string fragmentSource;
+    Callback callback;
+    bool cacheBinary{ true };
+  };
+
+  struct Finished {
+    Result result;
+    GLsync fence;
+    Callback callback;
+  };
+
+  void workerLoop();
+  Result build(const Request & request);
+
+  QOffscreenSurface * surface{ new QOffscreenSurface };
+  QOpenGLContext * context{ nullptr };
+  LambdaThread thread;
+  std::atomic<bool> running{ false };
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool pending{ false };
+  Request request;
+  std::list<Finished> finished;
+
+  // Worker only, the vertex shader rarely changes between requests
+  std::string lastVertexSource;
+  VertexShaderPtr lastVertexShader;
+};
@@ -98,10 +98,12 @@ MainWindow::MainWindow() {
         uiProgram.reset();
         uiShape.reset();
         uiFramebuffer.reset();
-        mouseTexture.reset();
+        mouseRegion = TextureAtlas::Region();
+        mouseProgram.reset();
         mouseShape.reset();
         uiFramebuffer.reset();
         planeProgram.reset();
+        planeUvMultiplier = UniformHandle<vec2>();
         plane.reset();
     });
 }
@@ -131,9 +133,11 @@ void MainWindow::setup() {
         Resource::SHADERS_TEXTURED_VS,
         Resource::SHADERS_TEXTURED_FS);
     plane = oria::loadPlane(planeProgram, 1.0);
+    planeUvMultiplier = UniformHandle<vec2>(planeProgram, "UvMultiplier");
 
-    mouseTexture = loadCursor(Resource::IMAGES_CURSOR_PNG);
-    mouseShape = oria::loadPlane(uiProgram, UI_INVERSE_ASPECT);
+    mouseRegion = loadCursor(Resource::IMAGES_CURSOR_PNG);
+    mouseProgram = oria::loadAtlasProgram();
+    mouseShape = oria::loadPlane(mouseProgram, UI_INVERSE_ASPECT);
 
     uiFramebuffer = FramebufferWrapperPtr(new FramebufferWrapper());
     uiFramebuffer->init(UI_SIZE);
@@ -396,8 +400,7 @@ void MainWindow::onChannelTextureChanged(const int & channelIndex, const int & c
 
 void MainWindow::onShaderSourceChanged(const QString & shaderSource) {
     queueRenderThreadTask([&, shaderSource] {
-        renderer.setShaderSourceInternal(shaderSource);
-        renderer.updateUniforms();
+        renderer.setShaderSourceAsync(shaderSource);
     });
 }
 
@@ -579,8 +582,7 @@ void MainWindow::perFrameRender() {
                     QSizeF mp = uiWindow->getMousePosition().load();
                     mv.translate(vec3(mp.width(), mp.height(), 0.0f));
                     mv.scale(vec3(0.1f));
-                    mouseTexture->Bind(Texture::Target::_2D);
-                    oria::renderGeometry(mouseShape, uiProgram);
+                    oria::renderGeometry(mouseShape, mouseProgram, mouseRegion);
                 });
             });
             lastUiSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
@@ -630,7 +632,7 @@ void MainWindow::perEyeRender() {
         // In VR mode, we want to cover the entire surface
         Stacks::withIdentity([&] {
             oria::renderGeometry(plane, planeProgram, LambdaList({ [&] {
-                Uniform<vec2>(*planeProgram, "UvMultiplier").Set(vec2(texRes));
+                planeUvMultiplier.set(vec2(texRes));
             } }));
         });
 #ifdef USE_RIFT
@@ -651,7 +653,7 @@ void MainWindow::perEyeRender() {
                 mv.translate(trans);
                 mv.scale(scale);
                 oria::renderGeometry(plane, planeProgram, LambdaList({ [&] {
-                    Uniform<vec2>(*planeProgram, "UvMultiplier").Set(vec2(texRes));
+                    planeUvMultiplier.set(vec2(texRes));
                 } }));
                 oria::renderGeometry(plane, planeProgram);
             });
@@ -78,7 +78,9 @@ class MainWindow : public QRiftWindow {
   // GLSL and geometry for the UI
   ProgramPtr uiProgram;
   ShapeWrapperPtr uiShape;
-  TexturePtr mouseTexture;
+  // The cursor comes from the shared atlas
+  TextureAtlas::Region mouseRegion;
+  ProgramPtr mouseProgram;
   ShapeWrapperPtr mouseShape;
 
   // For easy compositing the UI texture and the mouse texture
@@ -86,6 +88,7 @@ class MainWindow : public QRiftWindow {
 
   // Geometry and shader for rendering the possibly low res shader to the main framebuffer
   ProgramPtr planeProgram;
+  UniformHandle<vec2> planeUvMultiplier;
   ShapeWrapperPtr plane;
 
   // Measure the FPS for use in dynamic scaling
@@ -30,11 +30,14 @@ void Renderer::setup(QOpenGLContext * context) {
     setShaderSourceInternal(readFileToString(":/shaders/default.fs"));
     assert(shadertoyProgram);
     skybox = oria::loadSkybox(shadertoyProgram);
+    compiler.start(context);
 
     Platform::addShutdownHook([&] {
-        textureCache.clear();
+        compiler.stop();
+        presets.clear();
         shadertoyProgram.reset();
         vertexShader.reset();
+        vertexSource.clear();
         fragmentShader.reset();
         skybox.reset();
     });
@@ -48,8 +51,14 @@ void Renderer::initTextureCache() {
         QString path = TEXTURES.at(i);
         QString fileName = path.split("/").back();
         qDebug() << "Loading texture from " << path;
-        TextureData & cacheEntry = textureCache[path];
-        cacheEntry.tex = oria::load2dTexture(readFileToVector(":" + path), cacheEntry.size);
+        Preset & preset = presets[path];
+        preset.target = GL_TEXTURE_2D;
+        preset.loader = [=] {
+            TextureData result;
+            result.tex = oria::load2dTexture(readFileToVector(":" + path), result.size);
+            return result;
+        };
+        loadTexture(path);
         canonicalPathMap["qrc:" + path] = path;
 
         // Backward compatibility
@@ -66,19 +75,51 @@ void Renderer::initTextureCache() {
         }
     }
 
+    // Decode the faces of every preset cubemap at once
+    std::vector<oria::CubemapLoader> loaders;
+    for (int i = 0; i < CUBEMAPS.size(); ++i) {
+        QString pathTemplate = CUBEMAPS.at(i);
+        loaders.push_back([=](int face) {
+            QString texturePath = pathTemplate.arg(face);
+            return oria::loadImage(readFileToVector(":" + texturePath), false);
+        });
+    }
+    std::vector<ImagePtr> faces = oria::loadCubemapImages(loaders);
+
     for (int i = 0; i < CUBEMAPS.size(); ++i) {
         QString pathTemplate = CUBEMAPS.at(i);
         QString path = pathTemplate.arg(0);
         QString fileName = path.split("/").back();
         qDebug() << "Processing path " << path;
-        TextureData & cacheEntry = textureCache[path];
-        cacheEntry.tex = oria::loadCubemapTexture([&](int i) {
-            QString texturePath = pathTemplate.arg(i);
-            ImagePtr image = oria::loadImage(readFileToVector(":" + texturePath), false);
-            if (image) {
-                cacheEntry.size = uvec2(image->Width(), image->Height());
+        Preset & preset = presets[path];
+        preset.target = GL_TEXTURE_CUBE_MAP;
+        oria::CubemapLoader faceLoader = loaders[i];
+        preset.loader = [=] {
+            TextureData result;
+            ImagePtr first;
+            result.tex = oria::loadCubemapTexture([&](int face) {
+                ImagePtr image = faceLoader(face);
+                if (0 == face) {
+                    first = image;
+                }
+                return image;
+            });
+            if (first) {
+                result.size = uvec2(first->Width(), first->Height());
+            }
+            return result;
+        };
+        // Uploading the faces decoded above the first time
+        TextureResidency::instance().acquire(residencyName(path), GL_TEXTURE_CUBE_MAP, [&] {
+            TextureData result;
+            result.tex = oria::loadCubemapTexture([&](int face) {
+                return faces[i * 6 + face];
+            });
+            const ImagePtr & first = faces[i * 6];
+            if (first) {
+                result.size = uvec2(first->Width(), first->Height());
             }
-            return image;
+            return result;
         });
         canonicalPathMap["qrc:" + path] = path;
 
@@ -101,6 +142,7 @@ void Renderer::initTextureCache() {
 }
 
 void Renderer::render() {
+    compiler.poll();
     Context::Clear().ColorBuffer();
     if (!shadertoyProgram) {
         return;
@@ -120,101 +162,143 @@ void Renderer::render() {
 
 void Renderer::updateUniforms() {
     using namespace shadertoy;
-    typedef std::map<std::string, GLuint> Map;
-    Map activeUniforms = oria::getActiveUniforms(shadertoyProgram);
+    UniformTable::Pointer uniforms = UniformTable::forProgram(shadertoyProgram);
     shadertoyProgram->Bind();
     //    UNIFORM_DATE;
     for (int i = 0; i < 4; ++i) {
-        const char * uniformName = shadertoy::UNIFORM_CHANNELS[i];
-        if (activeUniforms.count(uniformName)) {
-            context->functions()->glUniform1i(activeUniforms[uniformName], i);
-        }
+        UniformHandle<GLint>(uniforms, uniforms->find(UNIFORM_CHANNELS[i])).set(i);
         if (channels[i].texture) {
-            if (activeUniforms.count(UNIFORM_CHANNEL_RESOLUTIONS[i])) {
-                Uniform<vec3>(*shadertoyProgram, UNIFORM_CHANNEL_RESOLUTIONS[i]).Set(channels[i].resolution);
-            }
-
+            UniformHandle<vec3>(uniforms, uniforms->find(UNIFORM_CHANNEL_RESOLUTIONS[i])).set(channels[i].resolution);
         }
     }
     NoProgram().Bind();
 
+    // The handles are resolved here, once per compile, not on every frame
     uniformLambdas.clear();
-    if (activeUniforms.count(UNIFORM_GLOBALTIME)) {
-        uniformLambdas.push_back([&] {
-            Uniform<GLfloat>(*shadertoyProgram, UNIFORM_GLOBALTIME).Set(Platform::elapsedSeconds() - startTime);
+    UniformHandle<GLfloat> globalTime(uniforms, uniforms->find(UNIFORM_GLOBALTIME));
+    if (globalTime.isActive()) {
+        uniformLambdas.push_back([=]() mutable {
+            globalTime.set(Platform::elapsedSeconds() - startTime);
         });
     }
 
-    if (activeUniforms.count(UNIFORM_RESOLUTION)) {
-        uniformLambdas.push_back([&] {
-            vec3 res = vec3(resolution, 0);
-            Uniform<vec3>(*shadertoyProgram, UNIFORM_RESOLUTION).Set(res);
+    UniformHandle<vec3> resolutionHandle(uniforms, uniforms->find(UNIFORM_RESOLUTION));
+    if (resolutionHandle.isActive()) {
+        uniformLambdas.push_back([=]() mutable {
+            resolutionHandle.set(vec3(resolution, 0));
         });
     }
 
 #ifdef USE_RIFT
-    if (activeUniforms.count(shadertoy::UNIFORM_POSITION)) {
-        uniformLambdas.push_back([&] {
-            Uniform<vec3>(*shadertoyProgram, shadertoy::UNIFORM_POSITION).Set(position);
+    UniformHandle<vec3> positionHandle(uniforms, uniforms->find(shadertoy::UNIFORM_POSITION));
+    if (positionHandle.isActive()) {
+        uniformLambdas.push_back([=]() mutable {
+            positionHandle.set(position);
         });
     }
 #endif
 
     for (int i = 0; i < 4; ++i) {
-        if (activeUniforms.count(UNIFORM_CHANNELS[i]) && channels[i].texture) {
+        if (uniforms->find(UNIFORM_CHANNELS[i]) >= 0 && channels[i].texture) {
             uniformLambdas.push_back([=] {
                 if (this->channels[i].texture) {
                     Texture::Active(i);
                     this->channels[i].texture->Bind(channels[i].target);
+                    TextureResidency::instance().touch(this->channels[i].texture);
                 }
             });
         }
     }
 }
 
-bool Renderer::setShaderSourceInternal(QString source) {
+bool Renderer::buildFragmentSource(QString source, QByteArray & result, QString & error) const {
+    QString header = shadertoy::SHADER_HEADER;
+    for (int i = 0; i < 4; ++i) {
+        const Channel & channel = channels[i];
+        QString line; line.sprintf("uniform sampler%s iChannel%d;\n",
+            channel.target == Texture::Target::CubeMap ? "Cube" : "2D", i);
+        header += line;
+    }
+    header += shadertoy::LINE_NUMBER_HEADER;
+    source.replace(QRegExp("\\t"), "  ");
+    source.insert(0, header);
+    // Shadertoy shaders are written against GLSL ES 1.0, so map its names
+    // onto the core profile ones with the preprocessor rather than rewriting
+    // the text, which also rewrote the names inside comments
+    static const ShaderPreprocessor::Defines COMPATIBILITY({
+        { "gl_FragColor", "FragColor" },
+        { "texture2D", "texture" },
+        { "textureCube", "texture" },
+    });
+    // Typed source doesn't get to read files, so an #include is an error
+    ShaderPreprocessor preprocessor(ShaderPreprocessor::noIncludes());
+    std::string expanded;
+    if (!preprocessor.process("shadertoy.fs", source.toLocal8Bit().toStdString(),
+            expanded, COMPATIBILITY)) {
+        error = QString(preprocessor.getError().c_str());
+        return false;
+    }
+    result = QByteArray(expanded.data(), (int)expanded.size());
+    return true;
+}
+
+void Renderer::installProgram(ProgramPtr & program) {
+    position = vec3();
+    shadertoyProgram.swap(program);
+    if (!skybox) {
+        skybox = oria::loadSkybox(shadertoyProgram);
+    }
+    updateUniforms();
+    startTime = Platform::elapsedSeconds();
+    emit compileSuccess();
+}
+
+bool Renderer::setShaderSourceInternal(QString source, bool cacheBinary) {
+    // Anything still compiling in the background is out of date
+    ++shaderGeneration;
+    QByteArray qb;
+    QString error;
+    if (!buildFragmentSource(source, qb, error)) {
+        emit compileError(error);
+        return false;
+    }
     try {
-        position = vec3();
-        if (!vertexShader) {
-            QString vertexShaderSource = readFileToString(":/shaders/default.vs").toLocal8Bit().constData();
-            vertexShader = VertexShaderPtr(new VertexShader());
-            vertexShader->Source(vertexShaderSource.toLocal8Bit().constData());
-            vertexShader->Compile();
+        if (vertexSource.isEmpty()) {
+            vertexSource = readFileToString(":/shaders/default.vs").toLocal8Bit();
         }
 
-        QString header = shadertoy::SHADER_HEADER;
-        for (int i = 0; i < 4; ++i) {
-            const Channel & channel = channels[i];
-            QString line; line.sprintf("uniform sampler%s iChannel%d;\n",
-                channel.target == Texture::Target::CubeMap ? "Cube" : "2D", i);
-            header += line;
-        }
-        header += shadertoy::LINE_NUMBER_HEADER;
         FragmentShaderPtr newFragmentShader(new FragmentShader());
-        source.
-            replace(QRegExp("\\t"), "  ").
-            replace(QRegExp("\\bgl_FragColor\\b"), "FragColor").
-            replace(QRegExp("\\btexture2D\\b"), "texture").
-            replace(QRegExp("\\btextureCube\\b"), "texture");
-        source.insert(0, header);
-        QByteArray qb = source.toLocal8Bit();
-        GLchar * fragmentSource = (GLchar*)qb.data();
-        StrCRef src(fragmentSource);
-        newFragmentShader->Source(GLSLSource(src));
-        newFragmentShader->Compile();
-        ProgramPtr result(new Program());
-        result->AttachShader(*vertexShader);
-        result->AttachShader(*newFragmentShader);
-
-        result->Link();
-        shadertoyProgram.swap(result);
-        if (!skybox) {
-            skybox = oria::loadSkybox(shadertoyProgram);
+        // Browsing presets mostly revisits shaders we've linked before
+        uint64_t key = oria::programBinaryKey(
+            ResourceView(vertexSource.constData(), vertexSource.size()),
+            ResourceView(qb.constData(), qb.size()));
+        ProgramPtr result;
+        if (oria::loadProgramBinary(result, key)) {
+            newFragmentShader.reset();
+        } else {
+            if (!vertexShader) {
+                vertexShader = VertexShaderPtr(new VertexShader());
+                vertexShader->Source(vertexSource.constData());
+                vertexShader->Compile();
+            }
+            GLchar * fragmentSource = (GLchar*)qb.data();
+            StrCRef src(fragmentSource);
+            newFragmentShader->Source(GLSLSource(src));
+            newFragmentShader->Compile();
+            result = ProgramPtr(new Program());
+            result->AttachShader(*vertexShader);
+            result->AttachShader(*newFragmentShader);
+
+            if (cacheBinary) {
+                oria::prepareProgramBinary(result);
+            }
+            result->Link();
+            if (cacheBinary) {
+                oria::storeProgramBinary(result, key);
+            }
         }
         fragmentShader.swap(newFragmentShader);
-        updateUniforms();
-        startTime = Platform::elapsedSeconds();
-        emit compileSuccess();
+        installProgram(result);
     } catch (ProgramBuildError & err) {
         emit compileError(QString(err.Log().c_str()));
         return false;
@@ -222,22 +306,63 @@ bool Renderer::setShaderSourceInternal(QString source) {
     return true;
 }
 
+void Renderer::setShaderSourceAsync(QString source) {
+    if (!compiler.isRunning()) {
+        setShaderSourceInternal(source, false);
+        return;
+    }
+    QByteArray qb;
+    QString error;
+    if (!buildFragmentSource(source, qb, error)) {
+        ++shaderGeneration;
+        emit compileError(error);
+        return;
+    }
+    unsigned int generation = ++shaderGeneration;
+    compiler.compile(
+        std::string(vertexSource.constData(), vertexSource.size()),
+        std::string(qb.constData(), qb.size()),
+        [this, generation](const ShaderCompiler::Result & result) {
+            if (generation != shaderGeneration) {
+                return;
+            }
+            if (!result.program) {
+                emit compileError(QString(result.log.c_str()));
+                return;
+            }
+            ProgramPtr program = result.program;
+            fragmentShader.reset();
+            installProgram(program);
+        }, false);
+}
+
+std::string Renderer::residencyName(const QString & path) {
+    return "shadertoy:" + path.toStdString();
+}
+
 Renderer::TextureData Renderer::loadTexture(QString source) {
     qDebug() << "Looking for texture " << source;
     while (canonicalPathMap.count(source)) {
         source = canonicalPathMap[source];
     }
 
-    if (!textureCache.count(source)) {
+    // Evicted textures come back through the same loaders
+    PresetMap::const_iterator preset = presets.find(source);
+    if (preset != presets.end()) {
+        return TextureResidency::instance().acquire(residencyName(source),
+            preset->second.target, preset->second.loader);
+    }
+    return TextureResidency::instance().acquire(residencyName(source), GL_TEXTURE_2D, [&] {
         qWarning() << "Texture " << source << " not found, loading";
+        TextureData result;
         std::vector<uint8_t> textureData = readFileToVector(source);
         if (!textureData.empty()) {
-            textureCache[source].tex = oria::load2dTexture(textureData, textureCache[source].size);
+            result.tex = oria::load2dTexture(textureData, result.size);
         } else {
             qWarning() << "Could not load texture";
         }
-    }
-    return textureCache[source];
+        return result;
+    });
 }
 
 void Renderer::setChannelTextureInternal(int channel, shadertoy::ChannelInputType type, const QString & textureSource) {
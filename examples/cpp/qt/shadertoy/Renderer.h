@@ -27,15 +27,17 @@ protected:
         TexturePtr texture;
         vec3 resolution;
     };
-    struct TextureData {
-        TexturePtr tex;
-        uvec2 size;
+    typedef TextureInfo TextureData;
+    // How to load the built in textures again if they get evicted
+    struct Preset {
+        GLenum target;
+        TextureResidency::Loader loader;
     };
 
-    typedef std::map<QString, TextureData> TextureMap;
+    typedef std::map<QString, Preset> PresetMap;
     typedef std::map<QString, QString> CanonicalPathMap;
     CanonicalPathMap canonicalPathMap;
-    TextureMap textureCache;
+    PresetMap presets;
 
     QOpenGLContext * context;
 
@@ -61,14 +63,24 @@ protected:
     // Geometry for the skybox used to render the scene
     ShapeWrapperPtr skybox;
     // A vertex shader shader, constant throughout the application lifetime
+    QByteArray vertexSource;
     VertexShaderPtr vertexShader;
     // The fragment shader used to render the shadertoy effect, as loaded
     // from a preset or created or edited by the user
     FragmentShaderPtr fragmentShader;
     // The compiled shadertoy program
     ProgramPtr shadertoyProgram;
+    // Compiles edits without stalling the render thread
+    ShaderCompiler compiler;
+    // Bumped by every new source, so stale background results are ignored
+    unsigned int shaderGeneration{ 0 };
 
     void initTextureCache();
+    // The fragment source with the shadertoy header and GLSL 3.3 fixups.
+    // Returns false with the reason in error if it can't be preprocessed.
+    bool buildFragmentSource(QString source, QByteArray & result, QString & error) const;
+    void installProgram(ProgramPtr & program);
+    static std::string residencyName(const QString & path);
 
 public:
     void setup(QOpenGLContext * context);
@@ -94,7 +106,12 @@ public:
         return texturePath;
     }
 
-    virtual bool setShaderSourceInternal(QString source);
+    // Edited sources skip the program binary cache, presets go through it
+    virtual bool setShaderSourceInternal(QString source, bool cacheBinary = true);
+    // Keeps rendering the current program until the new one has linked.
+    // Render thread only, like the rest.  Meant for the editor, so the
+    // program binary is never written to the decoded cache.
+    void setShaderSourceAsync(QString source);
     virtual TextureData loadTexture(QString source);
     virtual void setChannelTextureInternal(int channel, shadertoy::ChannelInputType type, const QString & textureSource);
     virtual void setShaderInternal(const shadertoy::Shader & shader);
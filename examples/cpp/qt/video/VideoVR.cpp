@@ -93,7 +93,9 @@ class MainWindow : public QRiftWindow {
     // GLSL and geometry for the UI
     ProgramPtr uiProgram;
     ShapeWrapperPtr uiShape;
-    TexturePtr mouseTexture;
+    // The cursor comes from the shared atlas
+    TextureAtlas::Region mouseRegion;
+    ProgramPtr mouseProgram;
     ShapeWrapperPtr mouseShape;
 
     // For easy compositing the UI texture and the mouse texture
@@ -101,6 +103,7 @@ class MainWindow : public QRiftWindow {
 
     // Geometry and shader for rendering the possibly low res shader to the main framebuffer
     ProgramPtr planeProgram;
+    UniformHandle<vec2> planeUvMultiplier;
     ShapeWrapperPtr plane;
 
     // Measure the FPS for use in dynamic scaling
@@ -141,10 +144,12 @@ public:
             uiProgram.reset();
             uiShape.reset();
             uiFramebuffer.reset();
-            mouseTexture.reset();
+            mouseRegion = TextureAtlas::Region();
+            mouseProgram.reset();
             mouseShape.reset();
             uiFramebuffer.reset();
             planeProgram.reset();
+            planeUvMultiplier = UniformHandle<vec2>();
             plane.reset();
         });
     }
@@ -170,9 +175,11 @@ private:
             Resource::SHADERS_TEXTURED_VS,
             Resource::SHADERS_TEXTURED_FS);
         plane = oria::loadPlane(planeProgram, 1.0);
+        planeUvMultiplier = UniformHandle<vec2>(planeProgram, "UvMultiplier");
 
-        mouseTexture = loadCursor(Resource::IMAGES_CURSOR_PNG);
-        mouseShape = oria::loadPlane(uiProgram, UI_INVERSE_ASPECT);
+        mouseRegion = loadCursor(Resource::IMAGES_CURSOR_PNG);
+        mouseProgram = oria::loadAtlasProgram();
+        mouseShape = oria::loadPlane(mouseProgram, UI_INVERSE_ASPECT);
 
         uiFramebuffer = FramebufferWrapperPtr(new FramebufferWrapper());
         uiFramebuffer->init(UI_SIZE);
@@ -413,8 +420,7 @@ private:
                         vec2 mp(size.width(), size.height());
                         mv.translate(vec3(mp, 0.0f));
                         mv.scale(vec3(0.1f));
-                        mouseTexture->Bind(Texture::Target::_2D);
-                        oria::renderGeometry(mouseShape, uiProgram);
+                        oria::renderGeometry(mouseShape, mouseProgram, mouseRegion);
                     });
                 });
                 lastUiSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
@@ -460,7 +466,7 @@ private:
             // In VR mode, we want to cover the entire surface
             Stacks::withIdentity([&] {
                 oria::renderGeometry(plane, planeProgram, LambdaList({ [&] {
-                    Uniform<vec2>(*planeProgram, "UvMultiplier").Set(vec2(texRes));
+                    planeUvMultiplier.set(vec2(texRes));
                 } }));
             });
 #ifdef USE_RIFT
@@ -481,7 +487,7 @@ private:
                     mv.translate(trans);
                     mv.scale(scale);
                     oria::renderGeometry(plane, planeProgram, LambdaList({ [&] {
-                        Uniform<vec2>(*planeProgram, "UvMultiplier").Set(vec2(texRes));
+                        planeUvMultiplier.set(vec2(texRes));
                     } }));
                     oria::renderGeometry(plane, planeProgram);
                 });
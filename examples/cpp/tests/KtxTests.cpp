@@ -0,0 +1,209 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+// Parsing of the KTX containers TextureCompressor writes, and the software
+// BC1 and BC3 decoder used when the context can't sample them.
+
+#include "Common.h"
+#include "Testing.h"
+
+using namespace oria;
+
+static void appendU32(std::vector<uint8_t> & out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back((uint8_t)(value >> (8 * i)));
+  }
+}
+
+// A compressed container with the images in level then face order, each
+// level's faces the same size
+static std::vector<uint8_t> makeKtx(GLenum internalFormat, const uvec2 & size, uint32_t faces,
+    const std::vector<std::vector<uint8_t>> & images, uint32_t arrayElements = 0) {
+  static const uint8_t IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+  };
+  std::vector<uint8_t> result(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+  uint32_t levels = (uint32_t)images.size() / faces;
+  uint32_t header[13] = {
+    0x04030201, 0, 1, 0, internalFormat, GL_RGBA, size.x, size.y, 0, arrayElements, faces, levels,
+    // Key and value data, which the parser has to skip
+    8
+  };
+  for (uint32_t value : header) {
+    appendU32(result, value);
+  }
+  result.insert(result.end(), 8, 0xEE);
+  for (uint32_t level = 0; level < levels; ++level) {
+    appendU32(result, (uint32_t)images[level * faces].size());
+    for (uint32_t face = 0; face < faces; ++face) {
+      const std::vector<uint8_t> & image = images[level * faces + face];
+      result.insert(result.end(), image.begin(), image.end());
+      while (result.size() % 4) {
+        result.push_back(0);
+      }
+    }
+  }
+  return result;
+}
+
+static ResourceView view(const std::vector<uint8_t> & bytes) {
+  return ResourceView(bytes.data(), bytes.size());
+}
+
+// Red and blue endpoints in RGB565, two bits of index per pixel
+static const uint16_t RED = 0xF800;
+static const uint16_t BLUE = 0x001F;
+
+static std::vector<uint8_t> bc1Block(uint16_t c0, uint16_t c1, uint32_t indices) {
+  std::vector<uint8_t> result = {
+    (uint8_t)c0, (uint8_t)(c0 >> 8), (uint8_t)c1, (uint8_t)(c1 >> 8)
+  };
+  appendU32(result, indices);
+  return result;
+}
+
+static std::vector<uint8_t> bc3Block(uint8_t a0, uint8_t a1, uint64_t alphaIndices, uint16_t c0, uint16_t c1, uint32_t indices) {
+  std::vector<uint8_t> result = { a0, a1 };
+  for (int i = 0; i < 6; ++i) {
+    result.push_back((uint8_t)(alphaIndices >> (8 * i)));
+  }
+  std::vector<uint8_t> colors = bc1Block(c0, c1, indices);
+  result.insert(result.end(), colors.begin(), colors.end());
+  return result;
+}
+
+static bool pixelIs(const std::vector<uint8_t> & rgba, size_t pixel, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  const uint8_t * p = &rgba[pixel * 4];
+  return p[0] == r && p[1] == g && p[2] == b && p[3] == a;
+}
+
+int main() {
+  return Testing::runTests({
+    { "parses levels past the key and value data", [] {
+      std::vector<uint8_t> level0 = bc1Block(RED, BLUE, 0), level1 = bc1Block(BLUE, RED, 0);
+      level0.insert(level0.end(), level0.begin(), level0.end());
+      std::vector<uint8_t> file = makeKtx(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(8, 4), 1, { level0, level1 });
+      KtxImage image;
+      CHECK(parseKtx(view(file), image));
+      CHECK(image.isCompressed());
+      CHECK(GL_COMPRESSED_RGB_S3TC_DXT1_EXT == image.internalFormat);
+      CHECK(uvec2(8, 4) == image.size);
+      CHECK(1 == image.faces);
+      CHECK(2 == image.levelCount);
+      CHECK(uvec2(4, 2) == image.levelSize(1));
+      CHECK(16 == image.level(0).size());
+      CHECK(0 == memcmp(image.level(0).data(), level0.data(), level0.size()));
+      CHECK(8 == image.level(1).size());
+      CHECK(0 == memcmp(image.level(1).data(), level1.data(), level1.size()));
+    } },
+    { "parses cubemap faces in order", [] {
+      std::vector<std::vector<uint8_t>> faces;
+      for (uint16_t face = 0; face < 6; ++face) {
+        faces.push_back(bc1Block(face, face, face));
+      }
+      std::vector<uint8_t> file = makeKtx(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(4, 4), 6, faces);
+      KtxImage image;
+      CHECK(parseKtx(view(file), image));
+      CHECK(6 == image.faces);
+      CHECK(1 == image.levelCount);
+      for (uint32_t face = 0; face < 6; ++face) {
+        CHECK(0 == memcmp(image.level(0, face).data(), faces[face].data(), 8));
+      }
+    } },
+    { "rejects damaged and unsupported containers", [] {
+      std::vector<uint8_t> good = makeKtx(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(4, 4), 1, { bc1Block(RED, BLUE, 0) });
+      KtxImage image;
+      CHECK(parseKtx(view(good), image));
+
+      std::vector<uint8_t> identifier = good;
+      identifier[1] = 'X';
+      CHECK(!parseKtx(view(identifier), image));
+
+      std::vector<uint8_t> endianness = good;
+      std::swap(endianness[12], endianness[15]);
+      CHECK(!parseKtx(view(endianness), image));
+
+      for (size_t size = 0; size < good.size(); size += 7) {
+        CHECK(!parseKtx(ResourceView(good.data(), size), image));
+      }
+      CHECK(!parseKtx(ResourceView(good.data(), good.size() - 1), image));
+
+      std::vector<uint8_t> array = makeKtx(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(4, 4), 1, { bc1Block(RED, BLUE, 0) }, 2);
+      CHECK(!parseKtx(view(array), image));
+    } },
+    { "decodes BC1 in four color mode", [] {
+      // Pixels 0 to 3 pick each palette entry in turn, the rest the first
+      std::vector<uint8_t> block = bc1Block(RED, BLUE, 0 | 1 << 2 | 2 << 4 | 3 << 6);
+      std::vector<uint8_t> rgba;
+      CHECK(decompressBlocks(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(4, 4), view(block), rgba));
+      CHECK(64 == rgba.size());
+      CHECK(pixelIs(rgba, 0, 255, 0, 0, 255));
+      CHECK(pixelIs(rgba, 1, 0, 0, 255, 255));
+      CHECK(pixelIs(rgba, 2, 170, 0, 85, 255));
+      CHECK(pixelIs(rgba, 3, 85, 0, 170, 255));
+      CHECK(pixelIs(rgba, 15, 255, 0, 0, 255));
+    } },
+    { "decodes BC1 in three color mode with transparent black", [] {
+      // The first endpoint not above the second selects this mode
+      std::vector<uint8_t> block = bc1Block(BLUE, RED, 2 | 3 << 2);
+      std::vector<uint8_t> rgba;
+      CHECK(decompressBlocks(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, uvec2(4, 4), view(block), rgba));
+      CHECK(pixelIs(rgba, 0, 127, 0, 127, 255));
+      CHECK(pixelIs(rgba, 1, 0, 0, 0, 0));
+      CHECK(pixelIs(rgba, 2, 0, 0, 255, 255));
+    } },
+    { "decodes only the pixels inside a partial block", [] {
+      // The second row of the block is pixels 4 to 7
+      std::vector<uint8_t> block = bc1Block(RED, BLUE, 1 << 8);
+      std::vector<uint8_t> rgba;
+      CHECK(decompressBlocks(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(2, 3), view(block), rgba));
+      CHECK(2 * 3 * 4 == rgba.size());
+      CHECK(pixelIs(rgba, 0, 255, 0, 0, 255));
+      CHECK(pixelIs(rgba, 2, 0, 0, 255, 255));
+      CHECK(pixelIs(rgba, 3, 255, 0, 0, 255));
+    } },
+    { "decodes BC3 alpha in both modes", [] {
+      // Eight interpolated values when the first endpoint is larger
+      uint64_t alphaIndices = 0 | 1 << 3 | 2 << 6 | 7 << 9;
+      std::vector<uint8_t> blocks = bc3Block(255, 0, alphaIndices, BLUE, RED, 1);
+      // Otherwise six, plus fully transparent and fully opaque
+      std::vector<uint8_t> second = bc3Block(0, 255, 6 | 7 << 3 | 2 << 6, BLUE, RED, 1);
+      blocks.insert(blocks.end(), second.begin(), second.end());
+      std::vector<uint8_t> rgba;
+      CHECK(decompressBlocks(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, uvec2(8, 4), view(blocks), rgba));
+      CHECK(rgba[0 * 4 + 3] == 255);
+      CHECK(rgba[1 * 4 + 3] == 0);
+      CHECK(rgba[2 * 4 + 3] == 218);
+      CHECK(rgba[3 * 4 + 3] == 36);
+      CHECK(rgba[4 * 4 + 3] == 0);
+      CHECK(rgba[5 * 4 + 3] == 255);
+      CHECK(rgba[6 * 4 + 3] == 51);
+      // BC3 colors always use four colors, whatever the endpoint order
+      CHECK(pixelIs(rgba, 0, 255, 0, 0, 255));
+      CHECK(pixelIs(rgba, 1, 0, 0, 255, 0));
+      CHECK(pixelIs(rgba, 4, 255, 0, 0, 0));
+    } },
+    { "refuses other formats and short data", [] {
+      std::vector<uint8_t> block = bc1Block(RED, BLUE, 0);
+      std::vector<uint8_t> rgba;
+      CHECK(!decompressBlocks(GL_COMPRESSED_RGBA_BPTC_UNORM, uvec2(4, 4), view(block), rgba));
+      CHECK(!decompressBlocks(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, uvec2(8, 4), view(block), rgba));
+      CHECK(!decompressBlocks(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, uvec2(4, 4), view(block), rgba));
+    } },
+  });
+}
@@ -0,0 +1,142 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+// The mesh file format MeshConverter writes and the examples map, which
+// must read back exactly what was written and refuse anything damaged.
+
+#include "Common.h"
+#include "Testing.h"
+
+// A quad with normals and two materials, with two levels of detail
+static MeshData makeQuad() {
+  MeshData mesh;
+  mesh.hasNormals = true;
+  mesh.hasMaterials = true;
+  mesh.vertexCount = 4;
+  std::vector<float> vertices;
+  for (uint32_t i = 0; i < mesh.vertexCount; ++i) {
+    float position[3] = { (float)(i & 1), (float)(i >> 1), 0.5f * i };
+    float normal[3] = { 0, 0, 1 };
+    vertices.insert(vertices.end(), position, position + 3);
+    vertices.insert(vertices.end(), normal, normal + 3);
+    vertices.push_back((float)(i / 2));
+  }
+  const uint8_t * bytes = reinterpret_cast<const uint8_t *>(vertices.data());
+  mesh.vertices = ResourceView::adopt(std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(float)));
+  mesh.setIndices({ 0, 1, 2, 2, 1, 3 });
+  MeshData::Material red, blue;
+  red.name = "red";
+  red.diffuse = vec4(1, 0, 0, 1);
+  blue.name = "blue";
+  blue.diffuse = vec4(0, 0, 1, 0.5f);
+  mesh.materials = { red, blue };
+  MeshData::Lod full = { 0, 6, 0.0f }, half = { 0, 3, 0.25f };
+  mesh.lods = { full, half };
+  mesh.boundsMin = vec3(0, 0, 0);
+  mesh.boundsMax = vec3(1, 1, 1.5f);
+  return mesh;
+}
+
+static bool sameBytes(const ResourceView & a, const ResourceView & b) {
+  return a.size() == b.size() && 0 == memcmp(a.data(), b.data(), a.size());
+}
+
+int main() {
+  return Testing::runTests({
+    { "reads back everything it wrote", [] {
+      MeshData mesh = makeQuad();
+      std::vector<uint8_t> file = mesh.toFile();
+      MeshDataPtr read = MeshData::fromFile(ResourceView(file.data(), file.size()));
+      if (!CHECK(nullptr != read)) {
+        return;
+      }
+      CHECK(4 == read->vertexCount);
+      CHECK(6 == read->indexCount);
+      CHECK(read->hasNormals && !read->hasTexCoords && read->hasMaterials);
+      CHECK(GL_UNSIGNED_SHORT == read->indexType);
+      CHECK(mesh.stride() == read->stride());
+      CHECK(sameBytes(mesh.vertices, read->vertices));
+      CHECK(sameBytes(mesh.indices, read->indices));
+      CHECK(mesh.getIndices() == read->getIndices());
+      CHECK(mesh.boundsMin == read->boundsMin && mesh.boundsMax == read->boundsMax);
+      CHECK(2 == read->materials.size());
+      CHECK(read->materials.size() == 2 && "red" == read->materials[0].name && "blue" == read->materials[1].name);
+      CHECK(read->materials.size() == 2 && vec4(0, 0, 1, 0.5f) == read->materials[1].diffuse);
+      CHECK(2 == read->lods.size());
+      CHECK(read->lods.size() == 2 && 3 == read->lods[1].indexCount && 0.25f == read->lods[1].error);
+      // The vertices are mapped straight into buffers, so they stay aligned
+      CHECK(0 == (read->vertices.data() - file.data()) % 16);
+      CHECK(0 == (read->indices.data() - file.data()) % 16);
+    } },
+    { "keeps 32 bit indices for large meshes", [] {
+      MeshData mesh;
+      mesh.vertexCount = 0x10001;
+      mesh.vertices = ResourceView::adopt(std::vector<uint8_t>(mesh.stride() * mesh.vertexCount, 0));
+      std::vector<uint32_t> indices = { 0, 0x10000, 1 };
+      mesh.setIndices(indices);
+      CHECK(GL_UNSIGNED_INT == mesh.indexType);
+      std::vector<uint8_t> file = mesh.toFile();
+      MeshDataPtr read = MeshData::fromFile(ResourceView(file.data(), file.size()));
+      CHECK(read && GL_UNSIGNED_INT == read->indexType && indices == read->getIndices());
+    } },
+    { "refuses truncated files", [] {
+      std::vector<uint8_t> file = makeQuad().toFile();
+      for (size_t size = 0; size < file.size(); ++size) {
+        if (!CHECK(!MeshData::fromFile(ResourceView(file.data(), size)))) {
+          std::cerr << "Accepted " << size << " of " << file.size() << " bytes" << std::endl;
+          break;
+        }
+      }
+    } },
+    { "refuses other formats, versions and bad levels", [] {
+      std::vector<uint8_t> file = makeQuad().toFile();
+      CHECK(nullptr != MeshData::fromFile(ResourceView(file.data(), file.size())));
+
+      std::vector<uint8_t> magic = file;
+      magic[0] = 'X';
+      CHECK(!MeshData::fromFile(ResourceView(magic.data(), magic.size())));
+
+      std::vector<uint8_t> version = file;
+      reinterpret_cast<MeshData::FileHeader *>(version.data())->version = MeshData::VERSION + 1;
+      CHECK(!MeshData::fromFile(ResourceView(version.data(), version.size())));
+
+      // A level running past the end of the indices
+      std::vector<uint8_t> lod = file;
+      size_t lodsOffset = sizeof(MeshData::FileHeader) + 2 * sizeof(MeshData::FileMaterial);
+      reinterpret_cast<MeshData::FileLod *>(lod.data() + lodsOffset)[1].indexCount = 7;
+      CHECK(!MeshData::fromFile(ResourceView(lod.data(), lod.size())));
+
+      // Offsets that overlap
+      std::vector<uint8_t> overlap = file;
+      MeshData::FileHeader & header = *reinterpret_cast<MeshData::FileHeader *>(overlap.data());
+      header.indexOffset = header.vertexOffset;
+      CHECK(!MeshData::fromFile(ResourceView(overlap.data(), overlap.size())));
+    } },
+    { "fails on material names too long to store", [] {
+      MeshData mesh = makeQuad();
+      mesh.materials[0].name = std::string(MeshData::MAX_MATERIAL_NAME + 1, 'x');
+      bool failed = false;
+      try {
+        mesh.toFile();
+      } catch (const std::exception &) {
+        failed = true;
+      }
+      CHECK(failed);
+    } },
+  });
+}
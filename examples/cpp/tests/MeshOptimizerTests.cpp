@@ -0,0 +1,160 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+// The invariants MeshOptimizer has to keep while it reorders a mesh: the
+// same triangles come out, with better vertex cache use.
+
+#include "Common.h"
+#include "Testing.h"
+#include <random>
+
+typedef std::array<float, 3> Position;
+typedef std::array<Position, 3> Triangle;
+
+// A size by size grid of quads in the XY plane, with positions only
+static MeshData makeGrid(int size, std::vector<uint32_t> & indices) {
+  MeshData mesh;
+  mesh.vertexCount = (size + 1) * (size + 1);
+  std::vector<float> vertices;
+  for (int y = 0; y <= size; ++y) {
+    for (int x = 0; x <= size; ++x) {
+      vertices.insert(vertices.end(), { (float)x, (float)y, 0.0f });
+    }
+  }
+  const uint8_t * bytes = reinterpret_cast<const uint8_t *>(vertices.data());
+  mesh.vertices = ResourceView::adopt(std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(float)));
+  indices.clear();
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      uint32_t corner = y * (size + 1) + x;
+      uint32_t above = corner + size + 1;
+      indices.insert(indices.end(), { corner, corner + 1, above, above, corner + 1, above + 1 });
+    }
+  }
+  return mesh;
+}
+
+static void shuffleTriangles(std::vector<uint32_t> & indices) {
+  std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+  memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32_t));
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+  memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32_t));
+}
+
+// The triangles by position, keeping their winding, so renumbered vertices
+// still compare equal
+static std::vector<Triangle> triangles(const MeshData & mesh, const std::vector<uint32_t> & indices) {
+  const float * positions = reinterpret_cast<const float *>(mesh.vertices.data());
+  size_t floats = mesh.stride() / sizeof(float);
+  std::vector<Triangle> result;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Triangle triangle;
+    for (int corner = 0; corner < 3; ++corner) {
+      const float * position = positions + indices[i + corner] * floats;
+      triangle[corner] = { { position[0], position[1], position[2] } };
+    }
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    result.push_back(triangle);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+static bool inFirstUseOrder(const std::vector<uint32_t> & indices, uint32_t vertexCount) {
+  uint32_t next = 0;
+  for (uint32_t index : indices) {
+    if (index > next) {
+      return false;
+    }
+    if (index == next) {
+      ++next;
+    }
+  }
+  return next == vertexCount;
+}
+
+int main() {
+  return Testing::runTests({
+    { "counts every vertex of unshared triangles", [] {
+      std::vector<uint32_t> indices(3 * 100);
+      for (uint32_t i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+      }
+      CHECK(3.0f == MeshOptimizer::acmr(indices, indices.size()));
+      CHECK(0.0f == MeshOptimizer::acmr({}, 0));
+    } },
+    { "reorders triangles for the cache without changing them", [] {
+      std::vector<uint32_t> indices;
+      MeshData mesh = makeGrid(32, indices);
+      shuffleTriangles(indices);
+      float before = MeshOptimizer::acmr(indices, mesh.vertexCount);
+      std::vector<uint32_t> ordered = MeshOptimizer::orderTriangles(indices, mesh.vertexCount);
+      float after = MeshOptimizer::acmr(ordered, mesh.vertexCount);
+      CHECK(after < before);
+      // 0.5 is the ideal, and a shuffled grid is close to 3
+      CHECK(after < 0.8f);
+      CHECK(triangles(mesh, indices) == triangles(mesh, ordered));
+    } },
+    { "merges identical vertices and drops degenerate triangles", [] {
+      // Two quads, each with its own copy of the shared edge, and a
+      // triangle that collapses once the copies merge
+      MeshData mesh;
+      mesh.vertexCount = 8;
+      std::vector<float> vertices = {
+        0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0,
+        1, 0, 0, 2, 0, 0, 1, 1, 0, 2, 1, 0,
+      };
+      const uint8_t * bytes = reinterpret_cast<const uint8_t *>(vertices.data());
+      mesh.vertices = ResourceView::adopt(std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(float)));
+      std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 4, 5, 6, 6, 5, 7, 1, 4, 3 };
+      std::vector<Triangle> before = triangles(mesh, std::vector<uint32_t>(indices.begin(), indices.begin() + 12));
+      MeshOptimizer::deduplicate(mesh, indices);
+      CHECK(6 == mesh.vertexCount);
+      CHECK(6 * mesh.stride() == mesh.vertices.size());
+      CHECK(12 == indices.size());
+      CHECK(before == triangles(mesh, indices));
+    } },
+    { "numbers vertices by first use and drops unused ones", [] {
+      std::vector<uint32_t> indices;
+      MeshData mesh = makeGrid(8, indices);
+      // Leave the last row of vertices unused
+      indices.resize(indices.size() - 6 * 8);
+      shuffleTriangles(indices);
+      std::vector<Triangle> before = triangles(mesh, indices);
+      MeshOptimizer::orderVertices(mesh, indices);
+      CHECK(9 * 8 == mesh.vertexCount);
+      CHECK(inFirstUseOrder(indices, mesh.vertexCount));
+      CHECK(before == triangles(mesh, indices));
+    } },
+    { "reports what the whole pass did", [] {
+      std::vector<uint32_t> indices;
+      MeshData mesh = makeGrid(32, indices);
+      shuffleTriangles(indices);
+      std::vector<Triangle> before = triangles(mesh, indices);
+      MeshOptimizer::Stats stats = MeshOptimizer::optimize(mesh, indices);
+      std::vector<uint32_t> result = mesh.getIndices();
+      CHECK(GL_UNSIGNED_SHORT == mesh.indexType);
+      CHECK(33 * 33 == stats.verticesBefore && 33 * 33 == stats.verticesAfter);
+      CHECK(32 * 32 * 2 == stats.trianglesBefore && 32 * 32 * 2 == stats.trianglesAfter);
+      CHECK(stats.acmrAfter < stats.acmrBefore);
+      CHECK(stats.acmrAfter == MeshOptimizer::acmr(result, mesh.vertexCount));
+      CHECK(inFirstUseOrder(result, mesh.vertexCount));
+      CHECK(before == triangles(mesh, result));
+    } },
+  });
+}
@@ -0,0 +1,112 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+// The levels of detail MeshSimplifier builds: each smaller than the one
+// before, no more accurate, and all within the one index buffer.
+
+#include "Common.h"
+#include "Testing.h"
+
+// A size by size grid of quads with a bumpy height, so simplifying it
+// costs some accuracy, and its bounds
+static MeshData makeTerrain(int size) {
+  MeshData mesh;
+  mesh.vertexCount = (size + 1) * (size + 1);
+  std::vector<float> vertices;
+  for (int y = 0; y <= size; ++y) {
+    for (int x = 0; x <= size; ++x) {
+      vertices.insert(vertices.end(), { (float)x, (float)y, 2.0f * sinf(x * 0.3f) * cosf(y * 0.2f) });
+    }
+  }
+  const uint8_t * bytes = reinterpret_cast<const uint8_t *>(vertices.data());
+  mesh.vertices = ResourceView::adopt(std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(float)));
+  std::vector<uint32_t> indices;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      uint32_t corner = y * (size + 1) + x;
+      uint32_t above = corner + size + 1;
+      indices.insert(indices.end(), { corner, corner + 1, above, above, corner + 1, above + 1 });
+    }
+  }
+  mesh.setIndices(indices);
+  mesh.boundsMin = vec3(0, 0, -2);
+  mesh.boundsMax = vec3((float)size, (float)size, 2);
+  return mesh;
+}
+
+// The area of a level seen from above, which stays the same while the
+// border is kept and no triangle flips
+static float projectedArea(const MeshData & mesh, const std::vector<uint32_t> & indices, const MeshData::Lod & lod) {
+  const float * positions = reinterpret_cast<const float *>(mesh.vertices.data());
+  float area = 0;
+  for (uint32_t i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i += 3) {
+    const float * a = positions + indices[i] * 3;
+    const float * b = positions + indices[i + 1] * 3;
+    const float * c = positions + indices[i + 2] * 3;
+    area += 0.5f * ((b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]));
+  }
+  return area;
+}
+
+int main() {
+  return Testing::runTests({
+    { "builds smaller and coarser levels", [] {
+      MeshData mesh = makeTerrain(32);
+      std::vector<uint8_t> vertices(mesh.vertices.data(), mesh.vertices.data() + mesh.vertices.size());
+      uint32_t fullCount = mesh.indexCount;
+      MeshSimplifier::generateLods(mesh);
+      const std::vector<MeshData::Lod> & lods = mesh.lods;
+      if (!CHECK(lods.size() > 1)) {
+        return;
+      }
+      CHECK(lods.size() <= MeshSimplifier::MAX_LODS);
+      CHECK(0 == lods[0].indexOffset && fullCount == lods[0].indexCount && 0.0f == lods[0].error);
+      for (size_t i = 1; i < lods.size(); ++i) {
+        CHECK(lods[i].indexCount <= lods[i - 1].indexCount * (1.0f - MeshSimplifier::MIN_REDUCTION));
+        CHECK(lods[i].error >= lods[i - 1].error);
+        CHECK(lods[i].indexOffset == lods[i - 1].indexOffset + lods[i - 1].indexCount);
+      }
+      CHECK(lods.back().error > 0);
+      CHECK(lods.back().indexOffset + lods.back().indexCount == mesh.indexCount);
+      // Every level shares the untouched vertices
+      CHECK(vertices.size() == mesh.vertices.size() && 0 == memcmp(vertices.data(), mesh.vertices.data(), vertices.size()));
+    } },
+    { "keeps the outline and every triangle facing the same way", [] {
+      MeshData mesh = makeTerrain(32);
+      MeshSimplifier::generateLods(mesh);
+      std::vector<uint32_t> indices = mesh.getIndices();
+      bool valid = true;
+      for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        valid &= a < mesh.vertexCount && b < mesh.vertexCount && c < mesh.vertexCount;
+        valid &= a != b && b != c && c != a;
+      }
+      CHECK(valid);
+      for (const MeshData::Lod & lod : mesh.lods) {
+        CHECK(0 == lod.indexCount % 3);
+        CHECK(fabsf(projectedArea(mesh, indices, lod) - 32 * 32) < 0.01f);
+      }
+    } },
+    { "leaves small meshes with a single level", [] {
+      MeshData mesh = makeTerrain(5);
+      MeshSimplifier::generateLods(mesh);
+      CHECK(1 == mesh.lods.size());
+      CHECK(mesh.lods.size() == 1 && mesh.indexCount == mesh.lods[0].indexCount);
+    } },
+  });
+}
@@ -0,0 +1,134 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+// Include resolution, define injection and permutation expansion in the
+// shader preprocessor, which ShaderBaker and the runtime both go through.
+
+#include "Common.h"
+#include "Testing.h"
+
+typedef std::map<std::string, std::string> Files;
+
+static ShaderPreprocessor::Reader readerFor(const Files & files) {
+  return [=](const std::string & path, std::string & result) {
+    auto itr = files.find(path);
+    if (itr == files.end()) {
+      return false;
+    }
+    result = itr->second;
+    return true;
+  };
+}
+
+int main() {
+  return Testing::runTests({
+    { "injects defines after the version with line numbers kept", [] {
+      ShaderPreprocessor preprocessor(ShaderPreprocessor::noIncludes());
+      std::string result;
+      CHECK(preprocessor.process("shaders/Test.fs", "#version 330\nvoid main() {}\n", result, { { "LIT", "1" } }));
+      CHECK("#version 330\n#define LIT 1\n#line 2 0\nvoid main() {}\n" == result);
+      // Without a version the defines lead
+      CHECK(preprocessor.process("shaders/Test.fs", "void main() {}\n", result, { { "A", "1" }, { "B", "2" } }));
+      CHECK("#define A 1\n#define B 2\n#line 1 0\nvoid main() {}\n" == result);
+      // And without defines nothing changes
+      CHECK(preprocessor.process("shaders/Test.fs", "#version 330\r\nvoid main() {}\r\n", result));
+      CHECK("#version 330\nvoid main() {}\n" == result);
+    } },
+    { "resolves includes next to the file, then from the root, once each", [] {
+      Files files = {
+        { "shaders/Common.glsl", "#version 330\nuniform mat4 Projection;\n#include \"Shared.glsl\"\n" },
+        { "shaders/Shared.glsl", "uniform float Time;\n" },
+        { "Root.glsl", "uniform vec4 Color;\n" },
+      };
+      ShaderPreprocessor preprocessor(readerFor(files));
+      std::string result;
+      CHECK(preprocessor.process("shaders/Test.fs",
+        "#version 330\n#include \"Common.glsl\"\n  #  include <Root.glsl>\n#include \"Shared.glsl\"\nvoid main() {}\n",
+        result));
+      CHECK(
+        "#version 330\n"
+        "#line 1 1\n"
+        // An included #version is dropped, keeping the line count
+        "\n"
+        "uniform mat4 Projection;\n"
+        "#line 1 2\n"
+        "uniform float Time;\n"
+        "#line 4 1\n"
+        "#line 3 0\n"
+        "#line 1 3\n"
+        "uniform vec4 Color;\n"
+        "#line 4 0\n"
+        // Shared.glsl was already pulled in by Common.glsl
+        "\n"
+        "void main() {}\n" == result);
+      const std::vector<std::string> & used = preprocessor.getFiles();
+      CHECK(4 == used.size());
+      CHECK(used.size() == 4 && "shaders/Test.fs" == used[0] && "shaders/Common.glsl" == used[1] &&
+        "shaders/Shared.glsl" == used[2] && "Root.glsl" == used[3]);
+    } },
+    { "reports missing, malformed and runaway includes", [] {
+      Files files = { { "Loop.glsl", "#include \"Loop2.glsl\"\n" }, { "Loop2.glsl", "#include \"Loop3.glsl\"\n" } };
+      // Each include of a new name nests one deeper
+      for (int i = 3; i <= ShaderPreprocessor::MAX_DEPTH + 2; ++i) {
+        files[Platform::format("Loop%d.glsl", i)] = Platform::format("#include \"Loop%d.glsl\"\n", i + 1);
+      }
+      ShaderPreprocessor preprocessor(readerFor(files));
+      std::string result = "stale";
+      CHECK(!preprocessor.process("Test.fs", "#include \"Missing.glsl\"\n", result));
+      CHECK(result.empty());
+      CHECK(std::string::npos != preprocessor.getError().find("Missing.glsl"));
+      CHECK(!preprocessor.process("Test.fs", "void main() {}\n#include \"Unclosed.glsl\n", result));
+      CHECK(std::string::npos != preprocessor.getError().find("line 2"));
+      CHECK(!preprocessor.process("Test.fs", "#include \"Loop.glsl\"\n", result));
+      CHECK(std::string::npos != preprocessor.getError().find("nested"));
+      // The editor's reader refuses everything
+      ShaderPreprocessor editor(ShaderPreprocessor::noIncludes());
+      CHECK(!editor.process("Test.fs", "#include \"Loop.glsl\"\n", result));
+    } },
+    { "expands every permutation of the declared flags", [] {
+      std::string source =
+        "#version 330\n"
+        "#pragma permutation LIT INSTANCED\n"
+        "#pragma once\n"
+        "#pragma permutation LIT SKINNED\n"
+        "void main() {}\n";
+      std::vector<std::string> flags = ShaderPreprocessor::declaredFlags(source);
+      CHECK(3 == flags.size());
+      CHECK(flags.size() == 3 && "LIT" == flags[0] && "INSTANCED" == flags[1] && "SKINNED" == flags[2]);
+
+      std::vector<ShaderPreprocessor::Flags> permutations = ShaderPreprocessor::permutations(flags);
+      CHECK(8 == permutations.size());
+      CHECK(permutations[0].empty());
+      std::set<ShaderPreprocessor::Flags> distinct(permutations.begin(), permutations.end());
+      CHECK(permutations.size() == distinct.size());
+      CHECK(1 == ShaderPreprocessor::permutations(std::vector<std::string>()).size());
+
+      ShaderPreprocessor::Flags both = { "LIT", "INSTANCED" };
+      CHECK(".INSTANCED.LIT.glsl" == ShaderPreprocessor::extension(both));
+      CHECK(".glsl" == ShaderPreprocessor::extension(ShaderPreprocessor::Flags()));
+      ShaderPreprocessor::Defines defines = ShaderPreprocessor::definesFor(both);
+      CHECK(2 == defines.size() && "1" == defines["LIT"] && "1" == defines["INSTANCED"]);
+
+      // The declarations are blanked rather than removed, other pragmas kept
+      ShaderPreprocessor preprocessor(ShaderPreprocessor::noIncludes());
+      std::string result;
+      CHECK(preprocessor.process("shaders/Lit.vs", source, result, defines));
+      CHECK("#version 330\n#define INSTANCED 1\n#define LIT 1\n#line 2 0\n\n#pragma once\n\nvoid main() {}\n" == result);
+    } },
+  });
+}
@@ -0,0 +1,63 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+#pragma once
+
+/**
+ * Just enough of a harness for the tests in this directory.  Each test
+ * program runs a list of named cases with runTests() and returns what it
+ * returns, so ctest sees a failure as a nonzero exit.
+ *
+ * A failed CHECK is reported with its location and the case carries on,
+ * so one run shows every broken expectation.  An exception, including a
+ * FAIL, ends the case and counts as a failure.
+ */
+
+#define CHECK(expression) \
+  Testing::check((expression), #expression, __FILE__, __LINE__)
+
+namespace Testing {
+  typedef std::pair<const char *, std::function<void()>> Case;
+
+  inline int & failures() {
+    static int count = 0;
+    return count;
+  }
+
+  inline bool check(bool passed, const char * expression, const char * file, int line) {
+    if (!passed) {
+      ++failures();
+      std::cerr << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+    }
+    return passed;
+  }
+
+  inline int runTests(const std::vector<Case> & cases) {
+    for (const Case & test : cases) {
+      int before = failures();
+      try {
+        test.second();
+      } catch (const std::exception & error) {
+        ++failures();
+        std::cerr << test.first << " threw: " << error.what() << std::endl;
+      }
+      std::cout << (before == failures() ? "passed " : "FAILED ") << test.first << std::endl;
+    }
+    return failures() ? 1 : 0;
+  }
+}
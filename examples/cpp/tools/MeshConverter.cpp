@@ -0,0 +1,86 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+// Converts a CTM or OBJ mesh into the mesh file format, which the examples
+// map and draw from without parsing.  Decoding runs the MeshOptimizer, which
+// reports the vertex cache efficiency before and after, and builds the
+// levels of detail with the MeshSimplifier.  See MeshData in common/opengl/Mesh.h
+// for the layout.
+//
+// Usage: MeshConverter <input mesh> <output file>
+//
+// Material libraries named by an OBJ are looked for next to it.
+
+#include "Common.h"
+
+static bool readFile(const std::string & path, std::vector<uint8_t> & result) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  result.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input mesh> <output file>" << std::endl;
+    return 1;
+  }
+  std::string input = argv[1];
+  std::vector<uint8_t> data;
+  if (!readFile(input, data)) {
+    std::cerr << "Unable to read " << input << std::endl;
+    return 1;
+  }
+  // The build output has to come from the source, never a stale cache entry
+  DecodedCache::instance().setEnabled(false);
+
+  MeshDataPtr mesh;
+  try {
+    ResourceView view(data.data(), data.size());
+    if (Platform::hasExtension(input, ".obj")) {
+      std::string directory = input.substr(0, input.find_last_of("/\\") + 1);
+      mesh = MeshData::decodeObj(view, [&](const std::string & library) {
+        std::vector<uint8_t> libraryData;
+        if (!readFile(directory + library, libraryData)) {
+          std::cerr << "Unable to read material library " << directory + library << std::endl;
+          return ResourceView();
+        }
+        return ResourceView::adopt(std::move(libraryData));
+      });
+    } else {
+      mesh = MeshData::decodeCtm(view);
+    }
+  } catch (const std::exception & e) {
+    std::cerr << input << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::vector<uint8_t> file = mesh->toFile();
+  std::ofstream out(argv[2], std::ios::binary);
+  out.write(reinterpret_cast<const char *>(file.data()), file.size());
+  if (!out) {
+    std::cerr << "Unable to write " << argv[2] << std::endl;
+    return 1;
+  }
+  // The optimizer's report goes through the asynchronous log
+  Logger::instance().flush();
+  return 0;
+}
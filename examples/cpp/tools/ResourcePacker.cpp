@@ -0,0 +1,200 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+// Builds the packed resource archive read by common/ResourceArchive.  See
+// ResourceArchive.h for the layout.
+//
+// Usage: ResourcePacker <archive> <resource root> <list file> [[--raw] <root> <list file>]...
+//
+// Each list file names one resource per line, relative to its root.  Later
+// roots hold files built from the resources, like the compressed textures.
+// The files of a root marked --raw are never deflated, so that formats
+// meant to be used in place, like KTX and converted meshes, are read
+// straight from the mapped archive rather than inflated into a copy.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+static const char MAGIC[8] = { 'O', 'R', 'I', 'A', 'P', 'A', 'K', 0 };
+static const uint32_t VERSION = 1;
+static const size_t ALIGNMENT = 16;
+static const uint32_t COMPRESSED = 1;
+// Entries that don't shrink by at least this much are stored raw, so that
+// already compressed formats like PNG can be read in place
+static const double MIN_SAVING = 0.1;
+
+struct Entry {
+  std::string path;
+  uint32_t flags{ 0 };
+  uint64_t offset{ 0 };
+  uint64_t size{ 0 };
+  uint64_t hash{ 0 };
+  std::vector<uint8_t> stored;
+};
+
+static uint64_t fnv1a(const std::vector<uint8_t> & data) {
+  uint64_t result = 14695981039346656037ULL;
+  for (uint8_t byte : data) {
+    result ^= byte;
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+template <typename T>
+static void put(std::vector<uint8_t> & out, T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out.push_back((uint8_t)((uint64_t)value >> (8 * i)));
+  }
+}
+
+static bool readFile(const std::string & path, std::vector<uint8_t> & out) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool addEntries(const std::string & root, const char * listPath, bool raw,
+    std::vector<Entry> & entries, uint64_t & totalSize, uint64_t & totalStored) {
+  std::ifstream list(listPath);
+  if (!list) {
+    std::cerr << "Unable to read " << listPath << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(list, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.erase(line.size() - 1);
+    }
+    if (line.empty()) {
+      continue;
+    }
+    std::vector<uint8_t> data;
+    if (!readFile(root + "/" + line, data)) {
+      std::cerr << "Unable to read " << root << "/" << line << std::endl;
+      return false;
+    }
+
+    Entry entry;
+    entry.path = line;
+    entry.size = data.size();
+    entry.hash = fnv1a(data);
+    if (!raw && !data.empty()) {
+      uLongf compressedSize = compressBound((uLong)data.size());
+      std::vector<uint8_t> compressed(compressedSize);
+      if (Z_OK == compress2(compressed.data(), &compressedSize, data.data(), (uLong)data.size(), Z_BEST_COMPRESSION) &&
+          compressedSize < data.size() * (1.0 - MIN_SAVING)) {
+        compressed.resize(compressedSize);
+        entry.stored.swap(compressed);
+        entry.flags |= COMPRESSED;
+      }
+    }
+    if (!(entry.flags & COMPRESSED)) {
+      entry.stored.swap(data);
+    }
+    totalSize += entry.size;
+    totalStored += entry.stored.size();
+    entries.push_back(std::move(entry));
+  }
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  static const char * USAGE = " <archive> <resource root> <list file> [[--raw] <root> <list file>]...";
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << USAGE << std::endl;
+    return 1;
+  }
+  std::string archivePath = argv[1];
+
+  std::vector<Entry> entries;
+  uint64_t totalSize = 0, totalStored = 0;
+  for (int i = 2; i < argc; i += 2) {
+    bool raw = 0 == strcmp(argv[i], "--raw");
+    if (raw) {
+      ++i;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << "Usage: " << argv[0] << USAGE << std::endl;
+      return 1;
+    }
+    if (!addEntries(argv[i], argv[i + 1], raw, entries, totalSize, totalStored)) {
+      return 1;
+    }
+  }
+
+  // The index size doesn't depend on the offsets, so lay it out first
+  size_t indexSize = 0;
+  for (const Entry & entry : entries) {
+    indexSize += 2 + entry.path.size() + 4 + 8 + 8 + 8 + 8;
+  }
+  uint64_t offset = sizeof(MAGIC) + 4 + 4 + 8 + indexSize;
+  for (Entry & entry : entries) {
+    offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    entry.offset = offset;
+    offset += entry.stored.size();
+  }
+
+  std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+  put(header, VERSION);
+  put(header, (uint32_t)entries.size());
+  put(header, (uint64_t)indexSize);
+  for (const Entry & entry : entries) {
+    put(header, (uint16_t)entry.path.size());
+    header.insert(header.end(), entry.path.begin(), entry.path.end());
+    put(header, entry.flags);
+    put(header, entry.offset);
+    put(header, (uint64_t)entry.stored.size());
+    put(header, entry.size);
+    put(header, entry.hash);
+  }
+
+  std::ofstream out(archivePath.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Unable to write " << archivePath << std::endl;
+    return 1;
+  }
+  out.write((const char *)header.data(), header.size());
+  uint64_t written = header.size();
+  for (const Entry & entry : entries) {
+    static const char PADDING[ALIGNMENT] = { 0 };
+    out.write(PADDING, entry.offset - written);
+    out.write((const char *)entry.stored.data(), entry.stored.size());
+    written = entry.offset + entry.stored.size();
+  }
+  if (!out) {
+    std::cerr << "Failed writing " << archivePath << std::endl;
+    return 1;
+  }
+
+  std::cout << "Packed " << entries.size() << " resources, " << totalSize <<
+    " bytes stored as " << totalStored << " into " << archivePath << std::endl;
+  return 0;
+}
@@ -0,0 +1,117 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+// Expands the shaders at build time, so the examples don't preprocess them
+// at startup.  See ShaderPreprocessor.h.
+//
+// Usage: ShaderBaker <resource root> <list file> <output root> <output list>
+//
+// Every shader in the list is written out once per permutation of the
+// flags it declares, named like "shaders/Lit.vs.INSTANCED.LIT.glsl", and
+// the output list names each of them for ResourcePacker.  The build
+// creates the output directories.
+
+#include "Common.h"
+
+static bool isShader(const std::string & path) {
+  static const char * EXTENSIONS[] = { ".vs", ".fs", ".gs" };
+  for (const char * extension : EXTENSIONS) {
+    size_t length = strlen(extension);
+    if (path.size() > length && 0 == path.compare(path.size() - length, length, extension)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool readFile(const std::string & path, std::string & result) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  result = buffer.str();
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0] << " <resource root> <list file> <output root> <output list>" << std::endl;
+    return 1;
+  }
+  std::string root = std::string(argv[1]) + "/";
+  std::string outputRoot = std::string(argv[3]) + "/";
+  std::ifstream list(argv[2]);
+  if (!list) {
+    std::cerr << "Unable to read " << argv[2] << std::endl;
+    return 1;
+  }
+
+  ShaderPreprocessor preprocessor([&](const std::string & path, std::string & result) {
+    return readFile(root + path, result);
+  });
+  std::string outputList;
+  std::string path;
+  size_t shaders = 0, baked = 0;
+  try {
+    while (std::getline(list, path)) {
+      if (!path.empty() && '\r' == path.back()) {
+        path.pop_back();
+      }
+      if (!isShader(path)) {
+        continue;
+      }
+      std::string source;
+      if (!readFile(root + path, source)) {
+        std::cerr << "Unable to read " << root + path << std::endl;
+        return 1;
+      }
+      ++shaders;
+      for (const auto & flags : ShaderPreprocessor::permutations(ShaderPreprocessor::declaredFlags(source))) {
+        std::string name = path + ShaderPreprocessor::extension(flags);
+        std::string result;
+        if (!preprocessor.process(path, source, result, ShaderPreprocessor::definesFor(flags))) {
+          std::cerr << path << ": " << preprocessor.getError() << std::endl;
+          return 1;
+        }
+        std::ofstream out(outputRoot + name, std::ios::binary);
+        out.write(result.data(), result.size());
+        if (!out) {
+          std::cerr << "Unable to write " << outputRoot + name << std::endl;
+          return 1;
+        }
+        outputList += name + "\n";
+        ++baked;
+      }
+    }
+  } catch (const std::exception & e) {
+    std::cerr << path << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream out(argv[4], std::ios::binary);
+  out << outputList;
+  if (!out) {
+    std::cerr << "Unable to write " << argv[4] << std::endl;
+    return 1;
+  }
+  std::cout << "Baked " << baked << " permutations of " << shaders << " shaders" << std::endl;
+  return 0;
+}
@@ -0,0 +1,361 @@
+/************************************************************************************
+ 
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ 
+ ************************************************************************************/
+
+// Converts an image into a KTX texture with a full mip chain, block
+// compressed for the GPU.  Read at runtime by oria::loadKtxTexture.
+//
+// Usage: TextureCompressor <input image> <output ktx> [bc1|bc3|rgba]
+//
+// Without a format, images with any transparency are stored as BC3 and
+// everything else as BC1.  Rows are flipped to OpenGL's bottom-up order,
+// matching what oria::loadImage does for the source image.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_OPENCV
+#include <opencv2/opencv.hpp>
+#else
+#include <png.h>
+#endif
+
+static const uint8_t KTX_IDENTIFIER[12] = {
+  0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// Only the handful of GL enums the container needs
+static const uint32_t GL_UNSIGNED_BYTE_ = 0x1401;
+static const uint32_t GL_RGB_ = 0x1907;
+static const uint32_t GL_RGBA_ = 0x1908;
+static const uint32_t GL_RGBA8_ = 0x8058;
+static const uint32_t GL_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+static const uint32_t GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+enum Format {
+  AUTO,
+  BC1,
+  BC3,
+  RGBA,
+};
+
+struct Image {
+  uint32_t width{ 0 };
+  uint32_t height{ 0 };
+  // RGBA8, rows bottom up
+  std::vector<uint8_t> pixels;
+
+  const uint8_t * at(uint32_t x, uint32_t y) const {
+    x = std::min(x, width - 1);
+    y = std::min(y, height - 1);
+    return &pixels[(y * width + x) * 4];
+  }
+};
+
+static bool readImage(const std::string & path, Image & image) {
+#ifdef HAVE_OPENCV
+  // Decoded as oria::loadImage does, keeping alpha
+  cv::Mat mat = cv::imread(path, cv::IMREAD_UNCHANGED);
+  if (mat.empty()) {
+    return false;
+  }
+  if (mat.depth() != CV_8U) {
+    mat.convertTo(mat, CV_8U, 1.0 / 256);
+  }
+  cv::Mat rgba;
+  switch (mat.channels()) {
+  case 1:
+    cv::cvtColor(mat, rgba, cv::COLOR_GRAY2RGBA);
+    break;
+  case 2: {
+    // Gray and alpha, which cvtColor has no conversion for
+    rgba.create(mat.rows, mat.cols, CV_8UC4);
+    const int fromTo[] = { 0, 0, 0, 1, 0, 2, 1, 3 };
+    cv::mixChannels(&mat, 1, &rgba, 1, fromTo, 4);
+    break;
+  }
+  case 3:
+    cv::cvtColor(mat, rgba, cv::COLOR_BGR2RGBA);
+    break;
+  default:
+    cv::cvtColor(mat, rgba, cv::COLOR_BGRA2RGBA);
+    break;
+  }
+  cv::flip(rgba, rgba, 0);
+  image.width = rgba.cols;
+  image.height = rgba.rows;
+  image.pixels.assign(rgba.data, rgba.data + rgba.total() * 4);
+  return true;
+#else
+  png_image png;
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&png, path.c_str())) {
+    return false;
+  }
+  png.format = PNG_FORMAT_RGBA;
+  image.width = png.width;
+  image.height = png.height;
+  image.pixels.resize(PNG_IMAGE_SIZE(png));
+  // A negative stride reads the rows bottom up
+  if (!png_image_finish_read(&png, nullptr, image.pixels.data(), -(png_int_32)PNG_IMAGE_ROW_STRIDE(png), nullptr)) {
+    png_image_free(&png);
+    return false;
+  }
+  return true;
+#endif
+}
+
+static bool hasAlpha(const Image & image) {
+  for (size_t i = 3; i < image.pixels.size(); i += 4) {
+    if (image.pixels[i] != 255) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 2x2 box filter, clamping at the edges of odd sized levels
+static Image downsample(const Image & source) {
+  Image result;
+  result.width = std::max(1u, source.width / 2);
+  result.height = std::max(1u, source.height / 2);
+  result.pixels.resize(result.width * result.height * 4);
+  for (uint32_t y = 0; y < result.height; ++y) {
+    for (uint32_t x = 0; x < result.width; ++x) {
+      const uint8_t * a = source.at(x * 2, y * 2);
+      const uint8_t * b = source.at(x * 2 + 1, y * 2);
+      const uint8_t * c = source.at(x * 2, y * 2 + 1);
+      const uint8_t * d = source.at(x * 2 + 1, y * 2 + 1);
+      uint8_t * out = &result.pixels[(y * result.width + x) * 4];
+      for (int i = 0; i < 4; ++i) {
+        out[i] = (uint8_t)((a[i] + b[i] + c[i] + d[i] + 2) / 4);
+      }
+    }
+  }
+  return result;
+}
+
+static uint16_t to565(const int color[3]) {
+  return (uint16_t)(((color[0] * 31 + 127) / 255) << 11 |
+    ((color[1] * 63 + 127) / 255) << 5 |
+    ((color[2] * 31 + 127) / 255));
+}
+
+static void from565(uint16_t packed, int color[3]) {
+  int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+static void put16(uint8_t * out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+// Endpoints from the inset bounding box of the block's colors, always in
+// four color mode
+static void encodeColors(const uint8_t block[16][4], uint8_t out[8]) {
+  int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      lo[c] = std::min(lo[c], (int)block[i][c]);
+      hi[c] = std::max(hi[c], (int)block[i][c]);
+    }
+  }
+  for (int c = 0; c < 3; ++c) {
+    int inset = (hi[c] - lo[c]) / 16;
+    lo[c] += inset;
+    hi[c] -= inset;
+  }
+
+  uint16_t c0 = to565(hi), c1 = to565(lo);
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  put16(out, c0);
+  put16(out + 2, c1);
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    int palette[4][3];
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestDistance = INT32_MAX;
+      for (int p = 0; p < 4; ++p) {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c) {
+          int delta = block[i][c] - palette[p][c];
+          distance += delta * delta;
+        }
+        if (distance < bestDistance) {
+          best = p;
+          bestDistance = distance;
+        }
+      }
+      indices |= (uint32_t)best << (2 * i);
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    out[4 + i] = (uint8_t)(indices >> (8 * i));
+  }
+}
+
+// Eight level mode between the block's extreme alphas
+static void encodeAlpha(const uint8_t block[16][4], uint8_t out[8]) {
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    lo = std::min(lo, (int)block[i][3]);
+    hi = std::max(hi, (int)block[i][3]);
+  }
+  out[0] = (uint8_t)hi;
+  out[1] = (uint8_t)lo;
+  uint64_t indices = 0;
+  if (hi != lo) {
+    int palette[8] = { hi, lo };
+    for (int p = 1; p < 7; ++p) {
+      palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestDistance = 256;
+      for (int p = 0; p < 8; ++p) {
+        int distance = std::abs(block[i][3] - palette[p]);
+        if (distance < bestDistance) {
+          best = p;
+          bestDistance = distance;
+        }
+      }
+      indices |= (uint64_t)best << (3 * i);
+    }
+  }
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = (uint8_t)(indices >> (8 * i));
+  }
+}
+
+static std::vector<uint8_t> compress(const Image & image, Format format) {
+  std::vector<uint8_t> result;
+  if (RGBA == format) {
+    return image.pixels;
+  }
+  uint32_t blocksWide = (image.width + 3) / 4;
+  uint32_t blocksHigh = (image.height + 3) / 4;
+  size_t blockSize = (BC1 == format) ? 8 : 16;
+  result.resize(blocksWide * blocksHigh * blockSize);
+  uint8_t * out = result.data();
+  for (uint32_t by = 0; by < blocksHigh; ++by) {
+    for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+      uint8_t block[16][4];
+      for (int i = 0; i < 16; ++i) {
+        memcpy(block[i], image.at(bx * 4 + i % 4, by * 4 + i / 4), 4);
+      }
+      if (BC3 == format) {
+        encodeAlpha(block, out);
+        out += 8;
+      }
+      encodeColors(block, out);
+      out += 8;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+static void put(std::ofstream & out, T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out.put((char)(uint8_t)((uint64_t)value >> (8 * i)));
+  }
+}
+
+int main(int argc, char ** argv) {
+  if (argc < 3 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " <input image> <output ktx> [bc1|bc3|rgba]" << std::endl;
+    return 1;
+  }
+
+  Format format = AUTO;
+  if (argc == 4) {
+    std::string name = argv[3];
+    if (name == "bc1") {
+      format = BC1;
+    } else if (name == "bc3") {
+      format = BC3;
+    } else if (name == "rgba") {
+      format = RGBA;
+    } else {
+      std::cerr << "Unknown format " << name << std::endl;
+      return 1;
+    }
+  }
+
+  Image image;
+  if (!readImage(argv[1], image)) {
+    std::cerr << "Unable to read " << argv[1] << std::endl;
+    return 1;
+  }
+  if (AUTO == format) {
+    format = hasAlpha(image) ? BC3 : BC1;
+  }
+
+  std::vector<std::vector<uint8_t>> levels;
+  levels.push_back(compress(image, format));
+  for (Image level = image; level.width > 1 || level.height > 1; ) {
+    level = downsample(level);
+    levels.push_back(compress(level, format));
+  }
+
+  std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+  out.write((const char *)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+  put<uint32_t>(out, 0x04030201);
+  bool compressed = (RGBA != format);
+  put<uint32_t>(out, compressed ? 0 : GL_UNSIGNED_BYTE_);
+  put<uint32_t>(out, 1);
+  put<uint32_t>(out, compressed ? 0 : GL_RGBA_);
+  put<uint32_t>(out, BC1 == format ? GL_COMPRESSED_RGB_S3TC_DXT1 :
+    BC3 == format ? GL_COMPRESSED_RGBA_S3TC_DXT5 : GL_RGBA8_);
+  put<uint32_t>(out, BC1 == format ? GL_RGB_ : GL_RGBA_);
+  put<uint32_t>(out, image.width);
+  put<uint32_t>(out, image.height);
+  put<uint32_t>(out, 0);
+  put<uint32_t>(out, 0);
+  put<uint32_t>(out, 1);
+  put<uint32_t>(out, (uint32_t)levels.size());
+  put<uint32_t>(out, 0);
+  // Every level is a multiple of four bytes, so there's never any padding
+  for (const std::vector<uint8_t> & level : levels) {
+    put<uint32_t>(out, (uint32_t)level.size());
+    out.write((const char *)level.data(), level.size());
+  }
+  if (!out) {
+    std::cerr << "Unable to write " << argv[2] << std::endl;
+    return 1;
+  }
+  return 0;
+}